@@ -20,30 +20,31 @@ term
 	| '{' term '}'								#termTermRule
 	;
 
+// Binary operators, from the lowest precedence to the highest. Each level is a loop rather than a recursion, so
+// long chains give flat parse trees and the Listener groups their operators to the left.
+
 logical
-	: arithmetic					#logicalArithmeticRule
-	| arithmetic
-		op=(
-			'&&' |
-			'||' |
-			'==' |
-			'!=' |
-			'<=' |
-			'>=' |
-			'<' |
-			'>'
-		)
-		logical						#logicalOpRule
+	: conjunction (op+='||' conjunction)*
+	;
+
+conjunction
+	: equality (op+='&&' equality)*
+	;
+
+equality
+	: comparison (op+=('==' | '!=') comparison)*
+	;
+
+comparison
+	: arithmetic (op+=('<=' | '>=' | '<' | '>') arithmetic)*
 	;
 
 arithmetic
-	: factor								#arithmeticFactorRule
-	| factor op=('+' | '-') arithmetic		#arithmeticOpRule
+	: factor (op+=('+' | '-') factor)*
 	;
 
 factor
-	: apply									#factorApplyRule
-	| apply op=('*' | '/' | '%') factor		#factorOpRule
+	: apply (op+=('*' | '/' | '%') apply)*
 	;
 
 apply
@@ -0,0 +1,183 @@
+#ifndef RINHA_INTERPRETER_AOT_RUNTIME_H
+#define RINHA_INTERPRETER_AOT_RUNTIME_H
+
+#include "./Context.h"
+#include "./Environment.h"
+#include "./Exceptions.h"
+#include "./Nodes.h"
+#include "./Runtime.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <compare>
+#include <cstddef>
+#include <exception>
+#include <initializer_list>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <variant>
+#include <pthread.h>
+
+namespace rinha::interpreter
+{
+	// Support functions for the C++ code generated by CppGenerator. Header-only, so generated programs only need
+	// this directory and Boost in the include path.
+	class AotRuntime final
+	{
+	public:
+		// Native implementation of a function, receiving the closure being called and its arguments.
+		using Code = Value (*)(const FnValue& callee, Value* arguments);
+
+		// Generated functions use the native stack for recursion, so the program runs in a thread with a large one.
+		static constexpr std::size_t STACK_SIZE = std::size_t(1) << 30;
+
+	public:
+		// Entry point of generated programs, reporting errors like the interpreter's main.
+		static int main(Value (*run)(boost::local_shared_ptr<Environment> environment))
+		{
+			struct Program
+			{
+				Value (*run)(boost::local_shared_ptr<Environment> environment);
+				int status = 1;
+			} program{run};
+
+			const auto start = [](void* arg) -> void* {
+				const auto program = static_cast<Program*>(arg);
+
+				const auto environment = boost::make_local_shared<BufferedEnvironment>();
+
+				try
+				{
+					program->run(environment);
+					environment->flush();
+					program->status = 0;
+				}
+				catch (const std::exception& ex)
+				{
+					environment->flush();
+					std::cerr << "Error: " << ex.what() << std::endl;
+				}
+
+				return nullptr;
+			};
+
+			pthread_attr_t attr;
+			pthread_t thread;
+
+			if (pthread_attr_init(&attr) != 0 || pthread_attr_setstacksize(&attr, STACK_SIZE) != 0 ||
+				pthread_create(&thread, &attr, start, &program) != 0)
+			{
+				// Fall back to the main thread stack.
+				start(&program);
+			}
+			else
+				pthread_join(thread, nullptr);
+
+			pthread_attr_destroy(&attr);
+
+			return program.status;
+		}
+
+		template <BinaryOpNode::Op op>
+		static Value binaryOp(const Value& firstValue, const Value& secondValue)
+		{
+			if constexpr (op != BinaryOpNode::Op::AND && op != BinaryOpNode::Op::OR)
+			{
+				if (const auto firstInt = std::get_if<IntValue>(&firstValue),
+					secondInt = std::get_if<IntValue>(&secondValue);
+					firstInt && secondInt)
+				{
+					const auto first = firstInt->getValue();
+					const auto second = secondInt->getValue();
+
+					if constexpr (op == BinaryOpNode::Op::ADD)
+						return IntValue(first + second);
+					else if constexpr (op == BinaryOpNode::Op::SUB)
+						return IntValue(first - second);
+					else if constexpr (op == BinaryOpNode::Op::MUL)
+						return IntValue(first * second);
+					else if constexpr (op == BinaryOpNode::Op::DIV)
+						return IntValue(first / second);
+					else if constexpr (op == BinaryOpNode::Op::REM)
+						return IntValue(first % second);
+					else if constexpr (op == BinaryOpNode::Op::EQ)
+						return BoolValue(first == second);
+					else if constexpr (op == BinaryOpNode::Op::NEQ)
+						return BoolValue(first != second);
+					else if constexpr (op == BinaryOpNode::Op::LT)
+						return BoolValue(first < second);
+					else if constexpr (op == BinaryOpNode::Op::GT)
+						return BoolValue(first > second);
+					else if constexpr (op == BinaryOpNode::Op::LTE)
+						return BoolValue(first <= second);
+					else
+						return BoolValue(first >= second);
+				}
+			}
+
+			return Runtime::binaryOp(op, firstValue, secondValue);
+		}
+
+		static bool condition(const Value& value)
+		{
+			if (const auto valueBool = std::get_if<BoolValue>(&value))
+				return valueBool->getValue();
+
+			throw RinhaException("Invalid datatype in if.");
+		}
+
+		template <unsigned index>
+		static Value tupleIndex(const Value& value)
+		{
+			if (const auto tupleValue = std::get_if<TupleValue>(&value))
+				return index == 0 ? tupleValue->getFirst() : tupleValue->getSecond();
+
+			throw RinhaException("Invalid datatype in tuple function.");
+		}
+
+		static const Value& print(Environment& environment, const Value& value)
+		{
+			environment.print(value);
+			return value;
+		}
+
+		// Checks the callee before its arguments are evaluated, as the interpreter does.
+		static const FnValue& callee(const Value& value, std::size_t argumentCount)
+		{
+			const auto valueFn = std::get_if<FnValue>(&value);
+
+			if (!valueFn)
+				throw RinhaException("Cannot call a non-function.");
+
+			if (valueFn->getValue()->getParameters().size() != argumentCount)
+				throw RinhaException("Arguments and parameters count do not match.");
+
+			return *valueFn;
+		}
+
+		// Slot of an enclosing function's activation, `hops` (>= 1) levels out.
+		static std::optional<Value>& outerSlot(Context* outer, unsigned hops, unsigned index)
+		{
+			for (; hops > 1; --hops)
+				outer = outer->getOuter();
+
+			return outer->getSlots()[index];
+		}
+
+		// Returns the first assigned candidate slot.
+		static const Value& lookup(const char* name, std::initializer_list<const std::optional<Value>*> candidates)
+		{
+			for (const auto candidate : candidates)
+			{
+				if (*candidate)
+					return **candidate;
+			}
+
+			throw RinhaException("Variable '" + std::string(name) + "' does not exist.");
+		}
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_AOT_RUNTIME_H
@@ -0,0 +1,71 @@
+#include "./AutoExecutionStrategy.h"
+#include "./BytecodeExecutionStrategy.h"
+#include "./ClosureExecutionStrategy.h"
+#include "./Environment.h"
+#include "./JitExecutionStrategy.h"
+#include "./ParsedSource.h"
+#include "./RecursionAnalysis.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <sys/resource.h>
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
+
+// iostream
+using std::clog;
+
+// ostream
+using std::endl;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		// Conservative native stack use of each recursion level in the closure compiler (which the JIT falls back
+		// to), measured at about 700 bytes for simple bodies.
+		constexpr uint64_t NATIVE_BYTES_PER_LEVEL = 2048;
+
+		uint64_t getNativeStackSize()
+		{
+			rlimit limit;
+
+			if (getrlimit(RLIMIT_STACK, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY)
+				return UINT64_MAX;
+
+			return limit.rlim_cur;
+		}
+	}  // namespace
+
+	Value AutoExecutionStrategy::run(
+		local_shared_ptr<Environment> environment, local_shared_ptr<ParsedSource> parsedSource)
+	{
+		const RecursionAnalysis analysis(parsedSource->getTerm());
+		const auto depth = analysis.getEstimatedDepth();
+
+		// The bytecode VM keeps its frames in the heap, so it's used unless the native stack is known to be enough.
+		// Without an estimate it isn't: tree shapes are over-approximated (recursive calls in both branches of an if
+		// count as a tree), so even a "tree-shaped" recursion may be linear and deep.
+		const auto nativeStack = !analysis.isRecursive() ||
+			(depth && depth.value() * NATIVE_BYTES_PER_LEVEL <= getNativeStackSize() / 2);
+
+		if (const auto env = std::getenv("RINHA_AUTO_LOG"); env && strcmp(env, "1") == 0)
+		{
+			const auto strategy = !nativeStack ? "bytecode" : analysis.isRecursive() ? "jit" : "closure";
+			clog << "Execution strategy: " << strategy << " (" << analysis.describe() << ")" << endl;
+		}
+
+		if (!nativeStack)
+			return BytecodeExecutionStrategy().run(std::move(environment), std::move(parsedSource));
+		else if (analysis.isRecursive())
+			return JitExecutionStrategy().run(std::move(environment), std::move(parsedSource));
+		else
+			return ClosureExecutionStrategy().run(std::move(environment), std::move(parsedSource));
+	}
+}  // namespace rinha::interpreter
@@ -0,0 +1,17 @@
+#ifndef RINHA_INTERPRETER_AUTO_EXECUTION_STRATEGY_H
+#define RINHA_INTERPRETER_AUTO_EXECUTION_STRATEGY_H
+
+#include "./ExecutionStrategy.h"
+
+namespace rinha::interpreter
+{
+	// Picks the fastest strategy that is not expected to overflow the native stack, from a RecursionAnalysis.
+	class AutoExecutionStrategy final : public ExecutionStrategy
+	{
+	public:
+		Value run(boost::local_shared_ptr<Environment> environment,
+			boost::local_shared_ptr<ParsedSource> parsedSource) override;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_AUTO_EXECUTION_STRATEGY_H
@@ -0,0 +1,156 @@
+#include "./Bytecode.h"
+#include "./Nodes.h"
+#include "./ScopeAnalysis.h"
+#include <memory>
+#include <utility>
+
+// memory
+using std::make_unique;
+using std::unique_ptr;
+
+
+namespace rinha::interpreter
+{
+	static_assert(uint8_t(OpCode::OR) - uint8_t(OpCode::ADD) == uint8_t(BinaryOpNode::Op::OR));
+
+	unique_ptr<BytecodeProgram> BytecodeCompiler::compile(const TermNode* root)
+	{
+		auto program = make_unique<BytecodeProgram>();
+		program->scopeAnalysis = make_unique<ScopeAnalysis>(root);
+		program->functions.push_back({nullptr, &program->scopeAnalysis->getRootScope(), 0});
+
+		BytecodeCompiler compiler(*program);
+		compiler.pendingFunctions.emplace_back(0, root);
+
+		// Nested functions are queued while compiling their parents, so each body is emitted contiguously.
+		for (size_t i = 0; i < compiler.pendingFunctions.size(); ++i)
+		{
+			const auto [functionIndex, body] = compiler.pendingFunctions[i];
+			compiler.compileFunction(functionIndex, body);
+		}
+
+		return program;
+	}
+
+	void BytecodeCompiler::compileFunction(uint32_t functionIndex, const TermNode* body)
+	{
+		program.functions[functionIndex].entry = (uint32_t) program.code.size();
+		compileTerm(body);
+		emit(OpCode::RETURN);
+	}
+
+	void BytecodeCompiler::compileTerm(const TermNode* node)
+	{
+		switch (node->getType())
+		{
+			case TermNode::Type::LITERAL:
+				program.constants.push_back(static_cast<const LiteralNode*>(node)->value);
+				emit(OpCode::CONST, (uint32_t) program.constants.size() - 1);
+				break;
+
+			case TermNode::Type::TUPLE:
+			{
+				const auto tupleNode = static_cast<const TupleNode*>(node);
+				compileTerm(tupleNode->first);
+				compileTerm(tupleNode->second);
+				emit(OpCode::MAKE_TUPLE);
+				break;
+			}
+
+			case TermNode::Type::FN:
+			{
+				const auto fnNode = static_cast<const FnNode*>(node);
+				const auto functionIndex = (uint32_t) program.functions.size();
+
+				program.functions.push_back({fnNode, &program.scopeAnalysis->getScope(fnNode), 0});
+				program.functionIndexes[fnNode] = functionIndex;
+				pendingFunctions.emplace_back(functionIndex, fnNode->getBody());
+
+				emit(OpCode::MAKE_CLOSURE, functionIndex);
+				break;
+			}
+
+			case TermNode::Type::CALL:
+			{
+				const auto callNode = static_cast<const CallNode*>(node);
+				compileTerm(callNode->callee);
+
+				for (const auto argument : callNode->arguments)
+					compileTerm(argument);
+
+				program.callSites.push_back((uint32_t) callNode->arguments.size());
+				emit(OpCode::CALL, (uint32_t) program.callSites.size() - 1);
+				break;
+			}
+
+			case TermNode::Type::BINARY_OP:
+			{
+				const auto binaryOpNode = static_cast<const BinaryOpNode*>(node);
+				compileTerm(binaryOpNode->first);
+				compileTerm(binaryOpNode->second);
+				emit(OpCode(uint8_t(OpCode::ADD) + uint8_t(binaryOpNode->op)));
+				break;
+			}
+
+			case TermNode::Type::IF:
+			{
+				const auto ifNode = static_cast<const IfNode*>(node);
+				compileTerm(ifNode->condition);
+
+				const auto jumpToOtherwise = emit(OpCode::JUMP_IF_FALSE);
+				compileTerm(ifNode->then);
+
+				const auto jumpToEnd = emit(OpCode::JUMP);
+				program.code[jumpToOtherwise].operand = (uint32_t) program.code.size();
+				compileTerm(ifNode->otherwise);
+
+				program.code[jumpToEnd].operand = (uint32_t) program.code.size();
+				break;
+			}
+
+			case TermNode::Type::TUPLE_INDEX:
+			{
+				const auto tupleIndexNode = static_cast<const TupleIndexNode*>(node);
+				compileTerm(tupleIndexNode->arg);
+				emit(tupleIndexNode->index == 0 ? OpCode::TUPLE_FIRST : OpCode::TUPLE_SECOND);
+				break;
+			}
+
+			case TermNode::Type::VAR:
+			{
+				const auto varNode = static_cast<const VarNode*>(node);
+				const auto& candidates = program.scopeAnalysis->getCandidates(varNode);
+
+				if (candidates.size() == 1 && candidates[0].hops == 0)
+					emit(OpCode::LOAD_LOCAL, candidates[0].index);
+				else
+				{
+					program.references.push_back({&varNode->reference->name, candidates});
+					emit(OpCode::LOAD_VAR, (uint32_t) program.references.size() - 1);
+				}
+
+				break;
+			}
+
+			case TermNode::Type::LET:
+			{
+				const auto letNode = static_cast<const LetNode*>(node);
+				compileTerm(letNode->value);
+				emit(OpCode::STORE_LOCAL, program.scopeAnalysis->getLetSlot(letNode));
+				compileTerm(letNode->next);
+				break;
+			}
+
+			case TermNode::Type::PRINT:
+				compileTerm(static_cast<const PrintNode*>(node)->arg);
+				emit(OpCode::PRINT);
+				break;
+		}
+	}
+
+	uint32_t BytecodeCompiler::emit(OpCode opCode, uint32_t operand)
+	{
+		program.code.push_back({opCode, operand});
+		return (uint32_t) program.code.size() - 1;
+	}
+}  // namespace rinha::interpreter
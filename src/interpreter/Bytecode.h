@@ -0,0 +1,98 @@
+#ifndef RINHA_INTERPRETER_BYTECODE_H
+#define RINHA_INTERPRETER_BYTECODE_H
+
+#include "./Nodes.h"
+#include "./ScopeAnalysis.h"
+#include "./Values.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rinha::interpreter
+{
+	enum class OpCode : uint8_t
+	{
+		CONST,  // push constants[operand]
+		LOAD_LOCAL,  // push slot operand of the current frame
+		LOAD_VAR,  // push the first assigned candidate of references[operand]
+		STORE_LOCAL,  // pop into slot operand of the current frame
+		MAKE_TUPLE,
+		TUPLE_FIRST,
+		TUPLE_SECOND,
+		MAKE_CLOSURE,  // push a closure of functions[operand] capturing the current frame
+		CALL,  // call with callSites[operand] arguments above the callee
+		RETURN,
+		JUMP,  // jump to operand
+		JUMP_IF_FALSE,  // pop a BoolValue and jump to operand when it's false
+		PRINT,
+		ADD,
+		SUB,
+		MUL,
+		DIV,
+		REM,
+		EQ,
+		NEQ,
+		LT,
+		GT,
+		LTE,
+		GTE,
+		AND,
+		OR
+	};
+
+	struct Instruction final
+	{
+		OpCode opCode;
+		uint32_t operand;
+	};
+
+	struct BytecodeFunction final
+	{
+		const FnNode* node;
+		const Scope* scope;
+		uint32_t entry;
+	};
+
+	struct BytecodeReference final
+	{
+		const std::string* name;
+		std::vector<VarSlot> candidates;
+	};
+
+	class BytecodeProgram final
+	{
+	public:
+		std::unique_ptr<ScopeAnalysis> scopeAnalysis;
+		std::vector<Instruction> code;
+		std::vector<Value> constants;
+		std::vector<BytecodeFunction> functions;  // functions[0] is the root term
+		std::vector<BytecodeReference> references;
+		std::vector<uint32_t> callSites;  // argument count of each call
+		std::unordered_map<const FnNode*, uint32_t> functionIndexes;
+	};
+
+	class BytecodeCompiler final
+	{
+	public:
+		static std::unique_ptr<BytecodeProgram> compile(const TermNode* root);
+
+	private:
+		explicit BytecodeCompiler(BytecodeProgram& program)
+			: program(program)
+		{
+		}
+
+	private:
+		void compileFunction(uint32_t functionIndex, const TermNode* body);
+		void compileTerm(const TermNode* node);
+		uint32_t emit(OpCode opCode, uint32_t operand = 0);
+
+	private:
+		BytecodeProgram& program;
+		std::vector<std::pair<uint32_t, const TermNode*>> pendingFunctions;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_BYTECODE_H
@@ -0,0 +1,341 @@
+#include "./BytecodeExecutionStrategy.h"
+#include "./Bytecode.h"
+#include "./Context.h"
+#include "./Environment.h"
+#include "./Exceptions.h"
+#include "./ParsedSource.h"
+#include "./Runtime.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// optional
+using std::optional;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		class VirtualMachine final
+		{
+		private:
+			struct Frame final
+			{
+				const BytecodeFunction* function;
+				const Instruction* returnIp;
+				size_t localsBase;
+				// Set only for capturing functions, which keep their locals in a heap Context instead of localStack.
+				local_shared_ptr<Context> context;
+				local_shared_ptr<Context> outer;
+			};
+
+		public:
+			explicit VirtualMachine(const BytecodeProgram& program, local_shared_ptr<Environment> environment)
+				: program(program),
+				  environment(std::move(environment)),
+				  callCaches(program.callSites.size())
+			{
+			}
+
+		public:
+			Value run()
+			{
+				const auto& rootFunction = program.functions[0];
+				auto rootContext = make_local_shared<Context>(environment, rootFunction.scope->getSlotCount());
+				auto locals = rootContext->getSlots().data();
+
+				frames.push_back({&rootFunction, nullptr, 0, std::move(rootContext), {}});
+
+				const auto code = program.code.data();
+				auto ip = code + rootFunction.entry;
+
+				while (true)
+				{
+					const auto& instruction = *ip++;
+
+					switch (instruction.opCode)
+					{
+						case OpCode::CONST:
+							stack.push_back(program.constants[instruction.operand]);
+							break;
+
+						case OpCode::LOAD_LOCAL:
+						{
+							const auto& slot = locals[instruction.operand];
+
+							if (!slot)
+							{
+								throw RinhaException("Variable '" +
+									frames.back().function->scope->slotNames[instruction.operand] +
+									"' does not exist.");
+							}
+
+							stack.push_back(*slot);
+							break;
+						}
+
+						case OpCode::LOAD_VAR:
+							stack.push_back(loadReference(program.references[instruction.operand], locals));
+							break;
+
+						case OpCode::STORE_LOCAL:
+							locals[instruction.operand] = std::move(stack.back());
+							stack.pop_back();
+							break;
+
+						case OpCode::MAKE_TUPLE:
+						{
+							auto& first = stack[stack.size() - 2];
+							first = TupleValue(std::move(first), std::move(stack.back()));
+							stack.pop_back();
+							break;
+						}
+
+						case OpCode::TUPLE_FIRST:
+						case OpCode::TUPLE_SECOND:
+						{
+							auto& value = stack.back();
+
+							if (const auto tupleValue = std::get_if<TupleValue>(&value))
+							{
+								value = instruction.opCode == OpCode::TUPLE_FIRST ? tupleValue->getFirst()
+																				  : tupleValue->getSecond();
+							}
+							else
+								throw RinhaException("Invalid datatype in tuple function.");
+
+							break;
+						}
+
+						case OpCode::MAKE_CLOSURE:
+						{
+							assert(frames.back().context);
+							stack.push_back(FnValue(program.functions[instruction.operand].node, frames.back().context));
+							break;
+						}
+
+						case OpCode::CALL:
+						{
+							const auto argumentCount = program.callSites[instruction.operand];
+							const auto argumentsBase = stack.size() - argumentCount;
+							const auto calleeValueFn = std::get_if<FnValue>(&stack[argumentsBase - 1]);
+
+							if (!calleeValueFn)
+								throw RinhaException("Cannot call a non-function.");
+
+							const auto fnNode = calleeValueFn->getValue();
+
+							if (fnNode->getParameters().size() != argumentCount)
+								throw RinhaException("Arguments and parameters count do not match.");
+
+							// Call sites are almost always monomorphic, so cache the last callee's function.
+							auto& callCache = callCaches[instruction.operand];
+
+							if (callCache.first != fnNode)
+								callCache = {fnNode, &program.functions[program.functionIndexes.at(fnNode)]};
+
+							const auto function = callCache.second;
+							const auto scope = function->scope;
+
+							Frame frame{function, ip, localStack.size(), {}, calleeValueFn->getContext()};
+
+							if (scope->capturing)
+							{
+								frame.context = make_local_shared<Context>(frame.outer, scope->getSlotCount());
+								locals = frame.context->getSlots().data();
+							}
+							else
+							{
+								localStack.resize(frame.localsBase + scope->getSlotCount());
+								locals = localStack.data() + frame.localsBase;
+							}
+
+							for (unsigned i = 0; i < argumentCount; ++i)
+								locals[i] = std::move(stack[argumentsBase + i]);
+
+							for (const auto slot : scope->resetSlots)
+								locals[slot].reset();
+
+							stack.erase(stack.end() - argumentCount - 1, stack.end());
+							frames.push_back(std::move(frame));
+
+							ip = code + function->entry;
+							break;
+						}
+
+						case OpCode::RETURN:
+						{
+							if (frames.size() == 1)
+								return std::move(stack.back());
+
+							auto& frame = frames.back();
+							ip = frame.returnIp;
+							localStack.resize(frame.localsBase);
+							frames.pop_back();
+
+							auto& caller = frames.back();
+							locals = caller.context ? caller.context->getSlots().data()
+													: localStack.data() + caller.localsBase;
+							break;
+						}
+
+						case OpCode::JUMP:
+							ip = code + instruction.operand;
+							break;
+
+						case OpCode::JUMP_IF_FALSE:
+						{
+							const auto conditionValueBool = std::get_if<BoolValue>(&stack.back());
+
+							if (!conditionValueBool)
+								throw RinhaException("Invalid datatype in if.");
+
+							if (!conditionValueBool->getValue())
+								ip = code + instruction.operand;
+
+							stack.pop_back();
+							break;
+						}
+
+						case OpCode::PRINT:
+							environment->print(stack.back());
+							break;
+
+						case OpCode::ADD:
+							intBinaryOp(BinaryOpNode::Op::ADD, [](int32_t a, int32_t b) { return IntValue(a + b); });
+							break;
+
+						case OpCode::SUB:
+							intBinaryOp(BinaryOpNode::Op::SUB, [](int32_t a, int32_t b) { return IntValue(a - b); });
+							break;
+
+						case OpCode::MUL:
+							intBinaryOp(BinaryOpNode::Op::MUL, [](int32_t a, int32_t b) { return IntValue(a * b); });
+							break;
+
+						case OpCode::DIV:
+							intBinaryOp(BinaryOpNode::Op::DIV, [](int32_t a, int32_t b) { return IntValue(a / b); });
+							break;
+
+						case OpCode::REM:
+							intBinaryOp(BinaryOpNode::Op::REM, [](int32_t a, int32_t b) { return IntValue(a % b); });
+							break;
+
+						case OpCode::EQ:
+							intBinaryOp(BinaryOpNode::Op::EQ, [](int32_t a, int32_t b) { return BoolValue(a == b); });
+							break;
+
+						case OpCode::NEQ:
+							intBinaryOp(BinaryOpNode::Op::NEQ, [](int32_t a, int32_t b) { return BoolValue(a != b); });
+							break;
+
+						case OpCode::LT:
+							intBinaryOp(BinaryOpNode::Op::LT, [](int32_t a, int32_t b) { return BoolValue(a < b); });
+							break;
+
+						case OpCode::GT:
+							intBinaryOp(BinaryOpNode::Op::GT, [](int32_t a, int32_t b) { return BoolValue(a > b); });
+							break;
+
+						case OpCode::LTE:
+							intBinaryOp(BinaryOpNode::Op::LTE, [](int32_t a, int32_t b) { return BoolValue(a <= b); });
+							break;
+
+						case OpCode::GTE:
+							intBinaryOp(BinaryOpNode::Op::GTE, [](int32_t a, int32_t b) { return BoolValue(a >= b); });
+							break;
+
+						case OpCode::AND:
+						case OpCode::OR:
+						{
+							auto& first = stack[stack.size() - 2];
+							first = Runtime::binaryOp(BinaryOpNode::Op(uint8_t(instruction.opCode) - uint8_t(OpCode::ADD)),
+								first, stack.back());
+							stack.pop_back();
+							break;
+						}
+					}
+				}
+			}
+
+		private:
+			// Integer operands take the fast path; everything else goes through Runtime::binaryOp.
+			template <typename IntOp>
+			void intBinaryOp(BinaryOpNode::Op op, IntOp intOp)
+			{
+				auto& first = stack[stack.size() - 2];
+				const auto& second = stack.back();
+				const auto firstInt = std::get_if<IntValue>(&first);
+
+				if (const auto secondInt = std::get_if<IntValue>(&second); firstInt && secondInt)
+				{
+					first = intOp(firstInt->getValue(), secondInt->getValue());
+				}
+				else
+					first = Runtime::binaryOp(op, first, second);
+
+				stack.pop_back();
+			}
+
+			Value loadReference(const BytecodeReference& reference, const optional<Value>* locals) const
+			{
+				Context* context = nullptr;
+				unsigned contextHops = 0;
+
+				for (const auto& candidate : reference.candidates)
+				{
+					const optional<Value>* slot;
+
+					if (candidate.hops == 0)
+						slot = &locals[candidate.index];
+					else
+					{
+						if (!context)
+						{
+							context = frames.back().outer.get();
+							contextHops = 1;
+						}
+
+						for (; contextHops < candidate.hops; ++contextHops)
+							context = context->getOuter();
+
+						slot = &context->getSlots()[candidate.index];
+					}
+
+					if (*slot)
+						return **slot;
+				}
+
+				throw RinhaException("Variable '" + *reference.name + "' does not exist.");
+			}
+
+		private:
+			const BytecodeProgram& program;
+			local_shared_ptr<Environment> environment;
+			std::vector<Value> stack;
+			std::vector<optional<Value>> localStack;
+			std::vector<Frame> frames;
+			std::vector<std::pair<const FnNode*, const BytecodeFunction*>> callCaches;
+		};
+	}  // namespace
+
+	Value BytecodeExecutionStrategy::run(
+		local_shared_ptr<Environment> environment, local_shared_ptr<ParsedSource> parsedSource)
+	{
+		const auto program = BytecodeCompiler::compile(parsedSource->getTerm());
+
+		VirtualMachine virtualMachine(*program, std::move(environment));
+
+		return virtualMachine.run();
+	}
+}  // namespace rinha::interpreter
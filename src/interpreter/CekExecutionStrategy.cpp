@@ -0,0 +1,331 @@
+#include "./CekExecutionStrategy.h"
+#include "./Context.h"
+#include "./Environment.h"
+#include "./Exceptions.h"
+#include "./Nodes.h"
+#include "./ParsedSource.h"
+#include "./Runtime.h"
+#include "./ScopeAnalysis.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// vector
+using std::vector;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		// Control (the node being evaluated), environment (the current Context) and continuation (explicit stacks)
+		// machine. Nodes push their intermediate values to `values` and what's left to do with them to
+		// `continuations`, so evaluation never recurses in C++.
+		class CekMachine final
+		{
+		private:
+			enum class Step : uint8_t
+			{
+				EVAL,
+				TUPLE_SECOND,
+				TUPLE_MAKE,
+				CALL_CHECK,
+				CALL_ARGUMENT,
+				CALL_ENTER,
+				BINARY_OP_SECOND,
+				BINARY_OP_APPLY,
+				IF_BRANCH,
+				TUPLE_INDEX,
+				LET_BIND,
+				PRINT,
+				// Restores the caller's context, saved in `contexts`.
+				RETURN
+			};
+
+			struct Continuation final
+			{
+				const TermNode* node;
+				Step step;
+				unsigned index = 0;
+			};
+
+		public:
+			explicit CekMachine(const ScopeAnalysis& scopeAnalysis)
+				: scopeAnalysis(scopeAnalysis)
+			{
+			}
+
+		public:
+			Value run(local_shared_ptr<Context> rootContext, const TermNode* root)
+			{
+				context = std::move(rootContext);
+				continuations.push_back({root, Step::EVAL});
+
+				while (!continuations.empty())
+				{
+					const auto continuation = continuations.back();
+					continuations.pop_back();
+
+					switch (continuation.step)
+					{
+						case Step::EVAL:
+							eval(continuation.node);
+							break;
+
+						case Step::TUPLE_SECOND:
+							continuations.push_back({continuation.node, Step::TUPLE_MAKE});
+							continuations.push_back({static_cast<const TupleNode*>(continuation.node)->second, Step::EVAL});
+							break;
+
+						case Step::TUPLE_MAKE:
+						{
+							auto secondValue = pop();
+							auto firstValue = pop();
+							values.push_back(TupleValue(std::move(firstValue), std::move(secondValue)));
+							break;
+						}
+
+						case Step::CALL_CHECK:
+						{
+							const auto callNode = static_cast<const CallNode*>(continuation.node);
+							const auto calleeValueFn = std::get_if<FnValue>(&values.back());
+
+							if (!calleeValueFn)
+								throw RinhaException("Cannot call a non-function.");
+
+							if (calleeValueFn->getValue()->getParameters().size() != callNode->arguments.size())
+								throw RinhaException("Arguments and parameters count do not match.");
+
+							continuations.push_back({callNode, Step::CALL_ARGUMENT, 0});
+							break;
+						}
+
+						case Step::CALL_ARGUMENT:
+						{
+							const auto callNode = static_cast<const CallNode*>(continuation.node);
+
+							if (continuation.index < callNode->arguments.size())
+							{
+								continuations.push_back({callNode, Step::CALL_ARGUMENT, continuation.index + 1});
+								continuations.push_back({callNode->arguments[continuation.index], Step::EVAL});
+							}
+							else
+								continuations.push_back({callNode, Step::CALL_ENTER});
+
+							break;
+						}
+
+						case Step::CALL_ENTER:
+							enter(static_cast<const CallNode*>(continuation.node));
+							break;
+
+						case Step::BINARY_OP_SECOND:
+							continuations.push_back({continuation.node, Step::BINARY_OP_APPLY});
+							continuations.push_back(
+								{static_cast<const BinaryOpNode*>(continuation.node)->second, Step::EVAL});
+							break;
+
+						case Step::BINARY_OP_APPLY:
+						{
+							const auto secondValue = pop();
+							auto& firstValue = values.back();
+							firstValue = Runtime::binaryOp(
+								static_cast<const BinaryOpNode*>(continuation.node)->op, firstValue, secondValue);
+							break;
+						}
+
+						case Step::IF_BRANCH:
+						{
+							const auto ifNode = static_cast<const IfNode*>(continuation.node);
+							const auto conditionValue = pop();
+
+							if (const auto conditionValueBool = std::get_if<BoolValue>(&conditionValue))
+							{
+								continuations.push_back(
+									{conditionValueBool->getValue() ? ifNode->then : ifNode->otherwise, Step::EVAL});
+								break;
+							}
+
+							throw RinhaException("Invalid datatype in if.");
+						}
+
+						case Step::TUPLE_INDEX:
+						{
+							auto& value = values.back();
+
+							if (const auto valueTuple = std::get_if<TupleValue>(&value))
+							{
+								value = static_cast<const TupleIndexNode*>(continuation.node)->index == 0 ?
+									valueTuple->getFirst() :
+									valueTuple->getSecond();
+								break;
+							}
+
+							throw RinhaException("Invalid datatype in tuple function.");
+						}
+
+						case Step::LET_BIND:
+						{
+							const auto letNode = static_cast<const LetNode*>(continuation.node);
+							context->getSlots()[scopeAnalysis.getLetSlot(letNode)] = pop();
+							continuations.push_back({letNode->next, Step::EVAL});
+							break;
+						}
+
+						case Step::PRINT:
+							context->getEnvironment()->print(values.back());
+							break;
+
+						case Step::RETURN:
+							context = std::move(contexts.back());
+							contexts.pop_back();
+							break;
+					}
+				}
+
+				return pop();
+			}
+
+		private:
+			void eval(const TermNode* node)
+			{
+				switch (node->getType())
+				{
+					case TermNode::Type::LITERAL:
+						values.push_back(static_cast<const LiteralNode*>(node)->value);
+						break;
+
+					case TermNode::Type::TUPLE:
+						continuations.push_back({node, Step::TUPLE_SECOND});
+						continuations.push_back({static_cast<const TupleNode*>(node)->first, Step::EVAL});
+						break;
+
+					case TermNode::Type::FN:
+						values.push_back(FnValue(static_cast<const FnNode*>(node), context));
+						break;
+
+					case TermNode::Type::CALL:
+						continuations.push_back({node, Step::CALL_CHECK});
+						continuations.push_back({static_cast<const CallNode*>(node)->callee, Step::EVAL});
+						break;
+
+					case TermNode::Type::BINARY_OP:
+						continuations.push_back({node, Step::BINARY_OP_SECOND});
+						continuations.push_back({static_cast<const BinaryOpNode*>(node)->first, Step::EVAL});
+						break;
+
+					case TermNode::Type::IF:
+						continuations.push_back({node, Step::IF_BRANCH});
+						continuations.push_back({static_cast<const IfNode*>(node)->condition, Step::EVAL});
+						break;
+
+					case TermNode::Type::TUPLE_INDEX:
+						continuations.push_back({node, Step::TUPLE_INDEX});
+						continuations.push_back({static_cast<const TupleIndexNode*>(node)->arg, Step::EVAL});
+						break;
+
+					case TermNode::Type::VAR:
+						values.push_back(lookup(static_cast<const VarNode*>(node)));
+						break;
+
+					case TermNode::Type::LET:
+					{
+						const auto letNode = static_cast<const LetNode*>(node);
+						continuations.push_back({node, Step::LET_BIND});
+						continuations.push_back({letNode->value, Step::EVAL});
+						break;
+					}
+
+					case TermNode::Type::PRINT:
+						continuations.push_back({node, Step::PRINT});
+						continuations.push_back({static_cast<const PrintNode*>(node)->arg, Step::EVAL});
+						break;
+				}
+			}
+
+			// The callee and its arguments are on top of `values`.
+			void enter(const CallNode* node)
+			{
+				const auto argumentCount = node->arguments.size();
+				const auto arguments = values.end() - argumentCount;
+				const auto& callee = std::get<FnValue>(*(arguments - 1));
+				const auto fnNode = callee.getValue();
+				const auto& scope = scopeAnalysis.getScope(fnNode);
+
+				auto calleeContext = make_local_shared<Context>(callee.getContext(), scope.getSlotCount());
+				auto& slots = calleeContext->getSlots();
+
+				for (unsigned i = 0; i < argumentCount; ++i)
+					slots[i] = std::move(arguments[i]);
+
+				for (const auto slot : scope.resetSlots)
+					slots[slot].reset();
+
+				values.erase(arguments - 1, values.end());
+
+				// In tail position the caller's context is not needed anymore, so tail recursion runs in constant
+				// space.
+				if (continuations.empty() || continuations.back().step != Step::RETURN)
+				{
+					contexts.push_back(std::move(context));
+					continuations.push_back({nullptr, Step::RETURN});
+				}
+
+				context = std::move(calleeContext);
+				continuations.push_back({fnNode->getBody(), Step::EVAL});
+			}
+
+			Value lookup(const VarNode* node) const
+			{
+				Context* current = context.get();
+				unsigned currentHops = 0;
+
+				for (const auto& candidate : scopeAnalysis.getCandidates(node))
+				{
+					for (; currentHops < candidate.hops; ++currentHops)
+						current = current->getOuter();
+
+					if (const auto& slot = current->getSlots()[candidate.index])
+						return *slot;
+				}
+
+				throw RinhaException("Variable '" + node->reference->name + "' does not exist.");
+			}
+
+			Value pop()
+			{
+				auto value = std::move(values.back());
+				values.pop_back();
+				return value;
+			}
+
+		private:
+			const ScopeAnalysis& scopeAnalysis;
+			local_shared_ptr<Context> context;
+			vector<Value> values;
+			vector<Continuation> continuations;
+			vector<local_shared_ptr<Context>> contexts;
+		};
+	}  // namespace
+
+	Value CekExecutionStrategy::run(
+		local_shared_ptr<Environment> environment, local_shared_ptr<ParsedSource> parsedSource)
+	{
+		const auto term = parsedSource->getTerm();
+		const ScopeAnalysis scopeAnalysis(term);
+
+		CekMachine machine(scopeAnalysis);
+
+		return machine.run(
+			make_local_shared<Context>(environment, scopeAnalysis.getRootScope().getSlotCount()), term);
+	}
+}  // namespace rinha::interpreter
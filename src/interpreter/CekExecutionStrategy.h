@@ -0,0 +1,17 @@
+#ifndef RINHA_INTERPRETER_CEK_EXECUTION_STRATEGY_H
+#define RINHA_INTERPRETER_CEK_EXECUTION_STRATEGY_H
+
+#include "./ExecutionStrategy.h"
+
+namespace rinha::interpreter
+{
+	// Evaluates the AST with explicit stacks, using constant native stack regardless of the recursion depth.
+	class CekExecutionStrategy final : public ExecutionStrategy
+	{
+	public:
+		Value run(boost::local_shared_ptr<Environment> environment,
+			boost::local_shared_ptr<ParsedSource> parsedSource) override;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_CEK_EXECUTION_STRATEGY_H
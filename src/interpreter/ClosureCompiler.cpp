@@ -0,0 +1,704 @@
+#include "./ClosureCompiler.h"
+#include "./Context.h"
+#include "./Environment.h"
+#include "./Exceptions.h"
+#include "./Nodes.h"
+#include "./ResourceGovernor.h"
+#include "./Runtime.h"
+#include "./ScopeAnalysis.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// memory
+using std::make_unique;
+using std::unique_ptr;
+
+// optional
+using std::optional;
+
+// string
+using std::string;
+
+// vector
+using std::vector;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		using TermPtr = unique_ptr<const CompiledTerm>;
+
+		// Functions with up to this number of slots keep their locals in the native stack.
+		constexpr unsigned INLINE_LOCALS = 4;
+
+		constexpr bool hasIntFastPath(BinaryOpNode::Op op)
+		{
+			return op != BinaryOpNode::Op::AND && op != BinaryOpNode::Op::OR;
+		}
+
+		constexpr bool isComparison(BinaryOpNode::Op op)
+		{
+			return op >= BinaryOpNode::Op::EQ && op <= BinaryOpNode::Op::GTE;
+		}
+
+		template <BinaryOpNode::Op op>
+		bool compareInt(int32_t first, int32_t second)
+		{
+			if constexpr (op == BinaryOpNode::Op::EQ)
+				return first == second;
+			else if constexpr (op == BinaryOpNode::Op::NEQ)
+				return first != second;
+			else if constexpr (op == BinaryOpNode::Op::LT)
+				return first < second;
+			else if constexpr (op == BinaryOpNode::Op::GT)
+				return first > second;
+			else if constexpr (op == BinaryOpNode::Op::LTE)
+				return first <= second;
+			else
+			{
+				static_assert(op == BinaryOpNode::Op::GTE);
+				return first >= second;
+			}
+		}
+
+		template <BinaryOpNode::Op op>
+		Value applyInt(int32_t first, int32_t second)
+		{
+			if constexpr (op == BinaryOpNode::Op::ADD)
+				return IntValue(first + second);
+			else if constexpr (op == BinaryOpNode::Op::SUB)
+				return IntValue(first - second);
+			else if constexpr (op == BinaryOpNode::Op::MUL)
+				return IntValue(first * second);
+			else if constexpr (op == BinaryOpNode::Op::DIV)
+				return IntValue(first / second);
+			else if constexpr (op == BinaryOpNode::Op::REM)
+				return IntValue(first % second);
+			else
+				return BoolValue(compareInt<op>(first, second));
+		}
+
+		class LiteralTerm final : public CompiledTerm
+		{
+		public:
+			explicit LiteralTerm(const Value& value)
+				: value(value)
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				return value;
+			}
+
+		private:
+			const Value value;
+		};
+
+		class TupleTerm final : public CompiledTerm
+		{
+		public:
+			explicit TupleTerm(TermPtr first, TermPtr second)
+				: first(std::move(first)),
+				  second(std::move(second))
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				auto firstValue = first->evaluate(frame);
+				auto secondValue = second->evaluate(frame);
+				return TupleValue(std::move(firstValue), std::move(secondValue));
+			}
+
+		private:
+			const TermPtr first;
+			const TermPtr second;
+		};
+
+		class FnTerm final : public CompiledTerm
+		{
+		public:
+			explicit FnTerm(const FnNode* node)
+				: node(node)
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				assert(frame.context);
+				return FnValue(node, frame.context);
+			}
+
+		private:
+			const FnNode* const node;
+		};
+
+		// Activates a function and evaluates its body, with `assignArguments` filling the parameter slots.
+		template <typename AssignArguments>
+		Value invokeFunction(const CompiledFunction& function, const FnValue& callee, Environment* environment,
+			AssignArguments&& assignArguments)
+		{
+			const auto scope = function.scope;
+			const auto slotCount = scope->getSlotCount();
+
+			ClosureFrame calleeFrame{nullptr, {}, nullptr, environment};
+			optional<Value> inlineLocals[INLINE_LOCALS];
+			unique_ptr<optional<Value>[]> heapLocals;
+
+			if (scope->capturing)
+			{
+				calleeFrame.context = make_local_shared<Context>(callee.getContext(), slotCount, &scope->slotsByName);
+				calleeFrame.outer = calleeFrame.context->getOuter();
+				calleeFrame.locals = calleeFrame.context->getSlots().data();
+			}
+			else
+			{
+				calleeFrame.outer = callee.getContext().get();
+
+				if (slotCount <= INLINE_LOCALS)
+					calleeFrame.locals = inlineLocals;
+				else
+				{
+					heapLocals = make_unique<optional<Value>[]>(slotCount);
+					calleeFrame.locals = heapLocals.get();
+				}
+			}
+
+			assignArguments(calleeFrame.locals);
+
+			for (const auto slot : scope->resetSlots)
+				calleeFrame.locals[slot].reset();
+
+			if (function.native)
+			{
+				if (auto result = function.native->call(callee, calleeFrame.locals))
+					return std::move(result.value());
+			}
+
+			return function.body->evaluate(calleeFrame);
+		}
+
+		class CallTerm final : public CompiledTerm
+		{
+		public:
+			explicit CallTerm(const ClosureProgram& program, TermPtr callee, vector<TermPtr>&& arguments)
+				: program(program),
+				  callee(std::move(callee)),
+				  arguments(std::move(arguments))
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				// As in the tree walker, checked before the guard page is reached.
+				if ((std::uintptr_t) __builtin_frame_address(0) < program.stackLimit)
+					throw RinhaException("stack depth exceeded");
+
+				if (program.governor)
+					program.governor->check();
+
+				const auto calleeValue = callee->evaluate(frame);
+				const auto calleeValueFn = std::get_if<FnValue>(&calleeValue);
+
+				if (!calleeValueFn)
+					throw RinhaException("Cannot call a non-function.");
+
+				const auto fnNode = calleeValueFn->getValue();
+
+				if (fnNode->getParameters().size() != arguments.size())
+					throw RinhaException("Arguments and parameters count do not match.");
+
+				// Call sites are almost always monomorphic, so cache the last callee's function.
+				if (cachedNode != fnNode)
+				{
+					cachedFunction = &program.functions.at(fnNode);
+					cachedNode = fnNode;
+				}
+
+				return invokeFunction(*cachedFunction, *calleeValueFn, frame.environment, [&](optional<Value>* locals) {
+					for (unsigned i = 0; i < arguments.size(); ++i)
+						locals[i] = arguments[i]->evaluate(frame);
+				});
+			}
+
+		private:
+			const ClosureProgram& program;
+			const TermPtr callee;
+			const vector<TermPtr> arguments;
+			mutable const FnNode* cachedNode = nullptr;
+			mutable const CompiledFunction* cachedFunction = nullptr;
+		};
+
+		template <BinaryOpNode::Op op>
+		class BinaryOpTerm final : public CompiledTerm
+		{
+		public:
+			explicit BinaryOpTerm(TermPtr first, TermPtr second)
+				: first(std::move(first)),
+				  second(std::move(second))
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				const auto firstValue = first->evaluate(frame);
+				const auto secondValue = second->evaluate(frame);
+
+				if constexpr (hasIntFastPath(op))
+				{
+					const auto firstInt = std::get_if<IntValue>(&firstValue);
+
+					if (const auto secondInt = std::get_if<IntValue>(&secondValue); firstInt && secondInt)
+						return applyInt<op>(firstInt->getValue(), secondInt->getValue());
+				}
+
+				return Runtime::binaryOp(op, firstValue, secondValue);
+			}
+
+			bool evaluateCondition(ClosureFrame& frame) const override
+			{
+				if constexpr (isComparison(op))
+				{
+					const auto firstValue = first->evaluate(frame);
+					const auto secondValue = second->evaluate(frame);
+					const auto firstInt = std::get_if<IntValue>(&firstValue);
+
+					if (const auto secondInt = std::get_if<IntValue>(&secondValue); firstInt && secondInt)
+						return compareInt<op>(firstInt->getValue(), secondInt->getValue());
+
+					return std::get<BoolValue>(Runtime::binaryOp(op, firstValue, secondValue)).getValue();
+				}
+				else
+					return CompiledTerm::evaluateCondition(frame);
+			}
+
+		private:
+			const TermPtr first;
+			const TermPtr second;
+		};
+
+		// Binary operation whose second operand is an integer literal, like `n - 1` or `n < 2`.
+		template <BinaryOpNode::Op op>
+		class BinaryOpIntConstantTerm final : public CompiledTerm
+		{
+		public:
+			explicit BinaryOpIntConstantTerm(TermPtr first, int32_t second)
+				: first(std::move(first)),
+				  second(second)
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				const auto firstValue = first->evaluate(frame);
+
+				if constexpr (hasIntFastPath(op))
+				{
+					if (const auto firstInt = std::get_if<IntValue>(&firstValue))
+						return applyInt<op>(firstInt->getValue(), second);
+				}
+
+				return Runtime::binaryOp(op, firstValue, IntValue(second));
+			}
+
+			bool evaluateCondition(ClosureFrame& frame) const override
+			{
+				if constexpr (isComparison(op))
+				{
+					const auto firstValue = first->evaluate(frame);
+
+					if (const auto firstInt = std::get_if<IntValue>(&firstValue))
+						return compareInt<op>(firstInt->getValue(), second);
+
+					return std::get<BoolValue>(Runtime::binaryOp(op, firstValue, IntValue(second))).getValue();
+				}
+				else
+					return CompiledTerm::evaluateCondition(frame);
+			}
+
+		private:
+			const TermPtr first;
+			const int32_t second;
+		};
+
+		class IfTerm final : public CompiledTerm
+		{
+		public:
+			explicit IfTerm(TermPtr condition, TermPtr then, TermPtr otherwise)
+				: condition(std::move(condition)),
+				  then(std::move(then)),
+				  otherwise(std::move(otherwise))
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				return condition->evaluateCondition(frame) ? then->evaluate(frame) : otherwise->evaluate(frame);
+			}
+
+		private:
+			const TermPtr condition;
+			const TermPtr then;
+			const TermPtr otherwise;
+		};
+
+		template <unsigned index>
+		class TupleIndexTerm final : public CompiledTerm
+		{
+		public:
+			explicit TupleIndexTerm(TermPtr arg)
+				: arg(std::move(arg))
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				const auto value = arg->evaluate(frame);
+
+				if (const auto tupleValue = std::get_if<TupleValue>(&value))
+					return index == 0 ? tupleValue->getFirst() : tupleValue->getSecond();
+
+				throw RinhaException("Invalid datatype in tuple function.");
+			}
+
+		private:
+			const TermPtr arg;
+		};
+
+		class LocalVarTerm final : public CompiledTerm
+		{
+		public:
+			explicit LocalVarTerm(const string& name, unsigned slot)
+				: name(name),
+				  slot(slot)
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				if (const auto& value = frame.locals[slot])
+					return *value;
+
+				throw RinhaException("Variable '" + name + "' does not exist.");
+			}
+
+		private:
+			const string& name;
+			const unsigned slot;
+		};
+
+		// Variable with more than one candidate slot, or living in an outer context.
+		class VarTerm final : public CompiledTerm
+		{
+		public:
+			explicit VarTerm(const string& name, const vector<VarSlot>& candidates)
+				: name(name),
+				  candidates(candidates)
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				Context* context = nullptr;
+				unsigned contextHops = 0;
+
+				for (const auto& candidate : candidates)
+				{
+					const optional<Value>* slot;
+
+					if (candidate.hops == 0)
+						slot = &frame.locals[candidate.index];
+					else
+					{
+						if (!context)
+						{
+							context = frame.outer;
+							contextHops = 1;
+						}
+
+						for (; contextHops < candidate.hops; ++contextHops)
+							context = context->getOuter();
+
+						slot = &context->getSlots()[candidate.index];
+					}
+
+					if (*slot)
+						return **slot;
+				}
+
+				throw RinhaException("Variable '" + name + "' does not exist.");
+			}
+
+		private:
+			const string& name;
+			const vector<VarSlot>& candidates;
+		};
+
+		class LetTerm final : public CompiledTerm
+		{
+		public:
+			explicit LetTerm(unsigned slot, TermPtr value, TermPtr next)
+				: slot(slot),
+				  value(std::move(value)),
+				  next(std::move(next))
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				frame.locals[slot] = value->evaluate(frame);
+				return next->evaluate(frame);
+			}
+
+		private:
+			const unsigned slot;
+			const TermPtr value;
+			const TermPtr next;
+		};
+
+		class PrintTerm final : public CompiledTerm
+		{
+		public:
+			explicit PrintTerm(TermPtr arg)
+				: arg(std::move(arg))
+			{
+			}
+
+		public:
+			Value evaluate(ClosureFrame& frame) const override
+			{
+				auto value = arg->evaluate(frame);
+
+				frame.environment->print(value);
+
+				return value;
+			}
+
+		private:
+			const TermPtr arg;
+		};
+
+		template <template <BinaryOpNode::Op> class T, typename... Args>
+		TermPtr makeBinaryOpTerm(BinaryOpNode::Op op, Args&&... args)
+		{
+			switch (op)
+			{
+				case BinaryOpNode::Op::ADD:
+					return make_unique<T<BinaryOpNode::Op::ADD>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::SUB:
+					return make_unique<T<BinaryOpNode::Op::SUB>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::MUL:
+					return make_unique<T<BinaryOpNode::Op::MUL>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::DIV:
+					return make_unique<T<BinaryOpNode::Op::DIV>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::REM:
+					return make_unique<T<BinaryOpNode::Op::REM>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::EQ:
+					return make_unique<T<BinaryOpNode::Op::EQ>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::NEQ:
+					return make_unique<T<BinaryOpNode::Op::NEQ>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::LT:
+					return make_unique<T<BinaryOpNode::Op::LT>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::GT:
+					return make_unique<T<BinaryOpNode::Op::GT>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::LTE:
+					return make_unique<T<BinaryOpNode::Op::LTE>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::GTE:
+					return make_unique<T<BinaryOpNode::Op::GTE>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::AND:
+					return make_unique<T<BinaryOpNode::Op::AND>>(std::forward<Args>(args)...);
+
+				case BinaryOpNode::Op::OR:
+					return make_unique<T<BinaryOpNode::Op::OR>>(std::forward<Args>(args)...);
+			}
+
+			assert(false);
+			throw std::logic_error("Invalid binary op");
+		}
+	}  // namespace
+
+	bool CompiledTerm::evaluateCondition(ClosureFrame& frame) const
+	{
+		const auto conditionValue = evaluate(frame);
+
+		if (const auto conditionValueBool = std::get_if<BoolValue>(&conditionValue))
+			return conditionValueBool->getValue();
+
+		throw RinhaException("Invalid datatype in if.");
+	}
+
+	Value ClosureProgram::run(local_shared_ptr<Environment> environment) const
+	{
+		const auto& rootScope = scopeAnalysis->getRootScope();
+
+		ClosureFrame frame{nullptr,
+			make_local_shared<Context>(environment, rootScope.getSlotCount(), &rootScope.slotsByName), nullptr,
+			environment.get()};
+		frame.locals = frame.context->getSlots().data();
+
+		return root->evaluate(frame);
+	}
+
+	Value ClosureProgram::call(const FnValue& callee, vector<Value>& arguments, Environment* environment) const
+	{
+		return invokeFunction(functions.at(callee.getValue()), callee, environment, [&](optional<Value>* locals) {
+			for (unsigned i = 0; i < arguments.size(); ++i)
+				locals[i] = std::move(arguments[i]);
+		});
+	}
+
+	unique_ptr<ClosureProgram> ClosureCompiler::compile(const TermNode* root)
+	{
+		return compile(root, make_unique<ScopeAnalysis>(root));
+	}
+
+	unique_ptr<ClosureProgram> ClosureCompiler::compile(const TermNode* root, unique_ptr<ScopeAnalysis> scopeAnalysis)
+	{
+		auto program = make_unique<ClosureProgram>();
+		program->scopeAnalysis = std::move(scopeAnalysis);
+
+		ClosureCompiler compiler(*program);
+		program->root = compiler.compileTerm(root);
+
+		return program;
+	}
+
+	TermPtr ClosureCompiler::compileTerm(const TermNode* node)
+	{
+		switch (node->getType())
+		{
+			case TermNode::Type::LITERAL:
+				return make_unique<LiteralTerm>(static_cast<const LiteralNode*>(node)->value);
+
+			case TermNode::Type::TUPLE:
+			{
+				const auto tupleNode = static_cast<const TupleNode*>(node);
+				auto first = compileTerm(tupleNode->first);
+				auto second = compileTerm(tupleNode->second);
+				return make_unique<TupleTerm>(std::move(first), std::move(second));
+			}
+
+			case TermNode::Type::FN:
+			{
+				const auto fnNode = static_cast<const FnNode*>(node);
+				auto body = compileTerm(fnNode->getBody());
+
+				program.functions.emplace(
+					fnNode, CompiledFunction{&program.scopeAnalysis->getScope(fnNode), std::move(body)});
+
+				return make_unique<FnTerm>(fnNode);
+			}
+
+			case TermNode::Type::CALL:
+			{
+				const auto callNode = static_cast<const CallNode*>(node);
+				auto callee = compileTerm(callNode->callee);
+				vector<TermPtr> arguments;
+
+				for (const auto argument : callNode->arguments)
+					arguments.push_back(compileTerm(argument));
+
+				return make_unique<CallTerm>(program, std::move(callee), std::move(arguments));
+			}
+
+			case TermNode::Type::BINARY_OP:
+			{
+				const auto binaryOpNode = static_cast<const BinaryOpNode*>(node);
+				auto first = compileTerm(binaryOpNode->first);
+
+				if (const auto literalNode = nodeAs<LiteralNode>(binaryOpNode->second);
+					literalNode && std::holds_alternative<IntValue>(literalNode.value()->value))
+				{
+					return makeBinaryOpTerm<BinaryOpIntConstantTerm>(
+						binaryOpNode->op, std::move(first), std::get<IntValue>(literalNode.value()->value).getValue());
+				}
+
+				auto second = compileTerm(binaryOpNode->second);
+				return makeBinaryOpTerm<BinaryOpTerm>(binaryOpNode->op, std::move(first), std::move(second));
+			}
+
+			case TermNode::Type::IF:
+			{
+				const auto ifNode = static_cast<const IfNode*>(node);
+				auto condition = compileTerm(ifNode->condition);
+				auto then = compileTerm(ifNode->then);
+				auto otherwise = compileTerm(ifNode->otherwise);
+				return make_unique<IfTerm>(std::move(condition), std::move(then), std::move(otherwise));
+			}
+
+			case TermNode::Type::TUPLE_INDEX:
+			{
+				const auto tupleIndexNode = static_cast<const TupleIndexNode*>(node);
+				auto arg = compileTerm(tupleIndexNode->arg);
+
+				if (tupleIndexNode->index == 0)
+					return make_unique<TupleIndexTerm<0>>(std::move(arg));
+				else
+					return make_unique<TupleIndexTerm<1>>(std::move(arg));
+			}
+
+			case TermNode::Type::VAR:
+			{
+				const auto varNode = static_cast<const VarNode*>(node);
+				const auto& candidates = program.scopeAnalysis->getCandidates(varNode);
+
+				if (candidates.size() == 1 && candidates[0].hops == 0)
+					return make_unique<LocalVarTerm>(varNode->reference->name, candidates[0].index);
+
+				return make_unique<VarTerm>(varNode->reference->name, candidates);
+			}
+
+			case TermNode::Type::LET:
+			{
+				const auto letNode = static_cast<const LetNode*>(node);
+				auto value = compileTerm(letNode->value);
+				auto next = compileTerm(letNode->next);
+				return make_unique<LetTerm>(
+					program.scopeAnalysis->getLetSlot(letNode), std::move(value), std::move(next));
+			}
+
+			case TermNode::Type::PRINT:
+				return make_unique<PrintTerm>(compileTerm(static_cast<const PrintNode*>(node)->arg));
+		}
+
+		assert(false);
+		throw std::logic_error("Invalid node type for compile");
+	}
+}  // namespace rinha::interpreter
@@ -0,0 +1,101 @@
+#ifndef RINHA_INTERPRETER_CLOSURE_COMPILER_H
+#define RINHA_INTERPRETER_CLOSURE_COMPILER_H
+
+#include "./Context.h"
+#include "./Nodes.h"
+#include "./ResourceGovernor.h"
+#include "./ScopeAnalysis.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace rinha::interpreter
+{
+	class Environment;
+
+	// Activation record of a compiled function.
+	struct ClosureFrame final
+	{
+		std::optional<Value>* locals;
+		// Set only for capturing scopes, whose locals are the slots of this heap context.
+		boost::local_shared_ptr<Context> context;
+		Context* outer;
+		Environment* environment;
+	};
+
+	// A TermNode pre-bound to its resolved operands, evaluated with a direct virtual call.
+	class CompiledTerm
+	{
+	public:
+		virtual ~CompiledTerm() = default;
+
+	public:
+		virtual Value evaluate(ClosureFrame& frame) const = 0;
+
+		// Overridden by comparisons so that conditions don't need to materialize a BoolValue.
+		virtual bool evaluateCondition(ClosureFrame& frame) const;
+	};
+
+	// Native implementation of a function body that may decline a call, in which case the body is interpreted.
+	class NativeCode
+	{
+	public:
+		virtual ~NativeCode() = default;
+
+	public:
+		virtual std::optional<Value> call(const FnValue& callee, const std::optional<Value>* arguments) = 0;
+	};
+
+	struct CompiledFunction final
+	{
+		const Scope* scope;
+		std::unique_ptr<const CompiledTerm> body;
+		std::unique_ptr<NativeCode> native = nullptr;
+	};
+
+	class ClosureProgram final
+	{
+	public:
+		Value run(boost::local_shared_ptr<Environment> environment) const;
+
+		// Calls a closure of this program from outside compiled code, with its arguments already evaluated.
+		Value call(const FnValue& callee, std::vector<Value>& arguments, Environment* environment) const;
+
+	public:
+		std::unique_ptr<ScopeAnalysis> scopeAnalysis;
+		std::unordered_map<const FnNode*, CompiledFunction> functions;
+		std::unique_ptr<const CompiledTerm> root;
+		// Checked on each call of compiled code when set, as by the tiered strategy running with limits.
+		ResourceGovernor* governor = nullptr;
+		// Lowest address of the native stack compiled calls may use, or 0 for no limit.
+		std::uintptr_t stackLimit = 0;
+	};
+
+	class ClosureCompiler final
+	{
+	public:
+		static std::unique_ptr<ClosureProgram> compile(const TermNode* root);
+
+		// Reuses a ScopeAnalysis of the same root, whose scopes may already be in use by other strategies.
+		static std::unique_ptr<ClosureProgram> compile(
+			const TermNode* root, std::unique_ptr<ScopeAnalysis> scopeAnalysis);
+
+	private:
+		explicit ClosureCompiler(ClosureProgram& program)
+			: program(program)
+		{
+		}
+
+	private:
+		std::unique_ptr<const CompiledTerm> compileTerm(const TermNode* node);
+
+	private:
+		ClosureProgram& program;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_CLOSURE_COMPILER_H
@@ -0,0 +1,21 @@
+#include "./ClosureExecutionStrategy.h"
+#include "./ClosureCompiler.h"
+#include "./Environment.h"
+#include "./ParsedSource.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
+
+
+namespace rinha::interpreter
+{
+	Value ClosureExecutionStrategy::run(
+		local_shared_ptr<Environment> environment, local_shared_ptr<ParsedSource> parsedSource)
+	{
+		const auto program = ClosureCompiler::compile(parsedSource->getTerm());
+
+		return program->run(std::move(environment));
+	}
+}  // namespace rinha::interpreter
@@ -2,11 +2,13 @@
 #define RINHA_INTERPRETER_CONTEXT_H
 
 #include "./Exceptions.h"
+#include "./ResourceGovernor.h"
 #include "./Values.h"
 #include <boost/smart_ptr/local_shared_ptr.hpp>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace rinha::interpreter
 {
@@ -15,29 +17,69 @@ namespace rinha::interpreter
 
 	class Context final
 	{
+	public:
+		using SlotsByName = std::unordered_map<std::string, unsigned>;
+
 	public:
 		explicit Context(boost::local_shared_ptr<Environment> environment)
 			: environment(std::move(environment))
 		{
+			ResourceGovernor::countAllocation(sizeof(Context));
 		}
 
 		explicit Context(boost::local_shared_ptr<Context> outer)
 			: environment(outer->environment),
 			  outer(std::move(outer))
 		{
+			ResourceGovernor::countAllocation(sizeof(Context));
+		}
+
+		// Slot-based contexts are used by strategies that resolve variables ahead of execution.
+		// When given the slot of each name, they also support the by-name methods, so strategies can share them.
+		explicit Context(boost::local_shared_ptr<Environment> environment, unsigned slotCount,
+			const SlotsByName* slotsByName = nullptr)
+			: environment(std::move(environment)),
+			  slots(slotCount),
+			  slotsByName(slotsByName)
+		{
+			ResourceGovernor::countAllocation(sizeof(Context) + slotCount * sizeof(std::optional<Value>));
+		}
+
+		explicit Context(
+			boost::local_shared_ptr<Context> outer, unsigned slotCount, const SlotsByName* slotsByName = nullptr)
+			: environment(outer->environment),
+			  outer(std::move(outer)),
+			  slots(slotCount),
+			  slotsByName(slotsByName)
+		{
+			ResourceGovernor::countAllocation(sizeof(Context) + slotCount * sizeof(std::optional<Value>));
 		}
 
 		void createVariable(const std::string& name)
 		{
-			variables.insert_or_assign(name, std::nullopt);
+			if (slotsByName)
+				slots[slotsByName->at(name)].reset();
+			else
+			{
+				variables.insert_or_assign(name, std::nullopt);
+				ResourceGovernor::countAllocation(sizeof(std::optional<Value>) + name.size());
+			}
 		}
 
 		Value getVariable(const std::string& name) const
 		{
 			for (auto context = this; context; context = context->outer.get())
 			{
-				if (const auto it = context->variables.find(name);
-					it != context->variables.end() && it->second.has_value())
+				if (context->slotsByName)
+				{
+					if (const auto it = context->slotsByName->find(name);
+						it != context->slotsByName->end() && context->slots[it->second].has_value())
+					{
+						return context->slots[it->second].value();
+					}
+				}
+				else if (const auto it = context->variables.find(name);
+						 it != context->variables.end() && it->second.has_value())
 				{
 					return it->second.value();
 				}
@@ -48,7 +90,10 @@ namespace rinha::interpreter
 
 		void setVariable(const std::string& name, const Value& value)
 		{
-			variables[name] = value;
+			if (slotsByName)
+				slots[slotsByName->at(name)] = value;
+			else
+				variables[name] = value;
 		}
 
 		auto getEnvironment() noexcept
@@ -56,10 +101,25 @@ namespace rinha::interpreter
 			return environment;
 		}
 
+		Context* getOuter() const noexcept
+		{
+			return outer.get();
+		}
+
+		auto& getSlots() noexcept
+		{
+			return slots;
+		}
+
+	private:
+		friend class ContextCopier;
+
 	private:
 		boost::local_shared_ptr<Environment> environment;
 		boost::local_shared_ptr<Context> outer;
 		std::unordered_map<std::string, std::optional<Value>> variables;
+		std::vector<std::optional<Value>> slots;
+		const SlotsByName* slotsByName = nullptr;
 	};
 }  // namespace rinha::interpreter
 
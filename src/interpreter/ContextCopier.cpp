@@ -0,0 +1,55 @@
+#include "./ContextCopier.h"
+#include "./Context.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <optional>
+#include <variant>
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// optional
+using std::optional;
+
+
+namespace rinha::interpreter
+{
+	local_shared_ptr<Context> ContextCopier::copy(const local_shared_ptr<Context>& context)
+	{
+		if (!context)
+			return {};
+
+		if (const auto it = copies.find(context.get()); it != copies.end())
+			return it->second;
+
+		auto contextCopy = make_local_shared<Context>(environment, 0u, context->slotsByName);
+		copies.emplace(context.get(), contextCopy);
+
+		contextCopy->outer = copy(context->outer);
+
+		for (const auto& [name, value] : context->variables)
+			contextCopy->variables.emplace(name, value ? optional<Value>(copy(value.value())) : std::nullopt);
+
+		contextCopy->slots.reserve(context->slots.size());
+
+		for (const auto& slot : context->slots)
+			contextCopy->slots.push_back(slot ? optional<Value>(copy(slot.value())) : std::nullopt);
+
+		return contextCopy;
+	}
+
+	Value ContextCopier::copy(const Value& value)
+	{
+		if (const auto valueFn = std::get_if<FnValue>(&value))
+			return FnValue(valueFn->getValue(), copy(valueFn->getContext()));
+
+		if (const auto valueTuple = std::get_if<TupleValue>(&value))
+			return TupleValue(copy(valueTuple->getFirst()), copy(valueTuple->getSecond()));
+
+		return value;
+	}
+}  // namespace rinha::interpreter
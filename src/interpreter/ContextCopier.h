@@ -0,0 +1,39 @@
+#ifndef RINHA_INTERPRETER_CONTEXT_COPIER_H
+#define RINHA_INTERPRETER_CONTEXT_COPIER_H
+
+#include "./Context.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <unordered_map>
+#include <utility>
+
+namespace rinha::interpreter
+{
+	class Environment;
+
+	// Deep copy of contexts and the values they hold, so another thread can use them. Reference counts of
+	// local_shared_ptr are not atomic, so threads can't share contexts or values that hold them.
+	class ContextCopier final
+	{
+	public:
+		// Copies refer to the given environment instead of the original one.
+		explicit ContextCopier(boost::local_shared_ptr<Environment> environment)
+			: environment(std::move(environment))
+		{
+		}
+
+		ContextCopier(const ContextCopier&) = delete;
+		ContextCopier& operator=(const ContextCopier&) = delete;
+
+	public:
+		boost::local_shared_ptr<Context> copy(const boost::local_shared_ptr<Context>& context);
+		Value copy(const Value& value);
+
+	private:
+		boost::local_shared_ptr<Environment> environment;
+		// Each context is copied once, which also preserves cycles (a context holding a closure over itself).
+		std::unordered_map<const Context*, boost::local_shared_ptr<Context>> copies;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_CONTEXT_COPIER_H
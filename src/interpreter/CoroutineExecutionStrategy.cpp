@@ -1,44 +1,209 @@
 #include "./CoroutineExecutionStrategy.h"
+#include "./ContextCopier.h"
 #include "./Environment.h"
+#include "./Exceptions.h"
 #include "./Nodes.h"
 #include "./ParsedSource.h"
+#include "./ResourceGovernor.h"
 #include "./Runtime.h"
 #include "./Task.h"
 #include "./TermNodeVisitor.h"
+#include "./ValueTermNodeVisitor.h"
 #include "./Values.h"
 #include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
 
 // boost/smart_ptr/local_shared_ptr
 using boost::local_shared_ptr;
 
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// exception
+using std::exception_ptr;
+
+// variant
+using std::variant;
+
+// vector
+using std::vector;
+
 
 namespace rinha::interpreter
 {
 	namespace
 	{
+		// Call-free subtrees up to this height are evaluated directly, as their native recursion is bounded.
+		constexpr unsigned MAX_DIRECT_HEIGHT = 32;
+
+		// Forks in progress per thread of the pool, beyond which operands are evaluated sequentially. Forks that
+		// remain in progress are the ones near the root of the recursion, which are worth the cost of copying.
+		constexpr unsigned MAX_FORKS_PER_THREAD = 4;
+
+		// Environment of the copies evaluated by other threads, which must not print. Their calls stop once the fork,
+		// or one it's nested in, is cancelled because another operand failed.
+		class ForkedEnvironment final : public Environment
+		{
+		public:
+			explicit ForkedEnvironment(const ForkedEnvironment* parent)
+				: parent(parent)
+			{
+			}
+
+		public:
+			void printLine(std::string_view s) override
+			{
+				throw std::logic_error("Forked evaluation cannot print");
+			}
+
+			bool isCancelled() const noexcept
+			{
+				for (auto environment = this; environment; environment = environment->parent)
+				{
+					if (environment->cancelled.load(std::memory_order_relaxed))
+						return true;
+				}
+
+				return false;
+			}
+
+		public:
+			std::atomic<bool> cancelled = false;
+
+		private:
+			// Outlives this one, as a fork waits for the forks nested in it.
+			const ForkedEnvironment* const parent;
+		};
+
+		// Whether the value holds a closure, whose context would be a forked copy.
+		bool holdsClosure(const Value& value)
+		{
+			if (std::holds_alternative<FnValue>(value))
+				return true;
+
+			if (const auto valueTuple = std::get_if<TupleValue>(&value))
+				return holdsClosure(valueTuple->getFirst()) || holdsClosure(valueTuple->getSecond());
+
+			return false;
+		}
+
+		// Evaluates call-free subtrees synchronously.
+		class DirectExecuteVisitor final : public ValueTermNodeVisitor<DirectExecuteVisitor>
+		{
+		public:
+			Value visitCallNode(boost::local_shared_ptr<Context>& context, const CallNode* node)
+			{
+				throw std::logic_error("Calls are not evaluated directly");
+			}
+		};
+
+		// Only calls and subtrees containing them suspend. Everything else produces ready tasks, which don't allocate
+		// coroutine frames.
 		class CoroutineExecuteVisitor final : public TermNodeVisitor<CoroutineExecuteVisitor, Task>
 		{
+		private:
+			struct NodeInfo final
+			{
+				// Height of the subtree, or more than MAX_DIRECT_HEIGHT when it contains calls.
+				unsigned directHeight;
+				// Whether the subtree doesn't print or bind variables, not counting the bodies of functions in it.
+				bool quiet;
+			};
+
+		public:
+			// With an executor, calls yield to it every sliceCalls calls. With a governor, calls are checked by it.
+			explicit CoroutineExecuteVisitor(
+				ManualExecutor* executor = nullptr, unsigned sliceCalls = 0, ResourceGovernor* governor = nullptr)
+				: executor(executor),
+				  sliceCalls(sliceCalls),
+				  callsUntilYield(sliceCalls),
+				  governor(governor)
+			{
+			}
+
+			// With a pool, independent operands making calls are evaluated in parallel while it has idle threads.
+			// The node information is computed for the whole program upfront, so threads only read it.
+			explicit CoroutineExecuteVisitor(ThreadPoolExecutor* pool, unsigned threadCount, const TermNode* root)
+				: executor(nullptr),
+				  sliceCalls(0),
+				  callsUntilYield(0),
+				  pool(pool),
+				  maxForks(threadCount * MAX_FORKS_PER_THREAD)
+			{
+				analyze(root);
+			}
+
+		public:
+			// Whole program as a task, so errors found before it suspends are also reported through it.
+			Task start(local_shared_ptr<Environment> environment, const TermNode* term)
+			{
+				auto context = make_local_shared<Context>(environment);
+				term->compile(context);
+
+				co_return co_await evaluate(context, term);
+			}
+
+			Task evaluate(boost::local_shared_ptr<Context>& context, const TermNode* node)
+			{
+				if (getInfo(node).directHeight <= MAX_DIRECT_HEIGHT)
+					return Task::ready(directVisitor.visit(context, node));
+
+				return visit(context, node);
+			}
+
 		public:
 			Task visitLiteralNode(boost::local_shared_ptr<Context>& context, const LiteralNode* node)
 			{
-				co_return node->value;
+				return Task::ready(node->value);
 			}
 
 			Task visitTupleNode(boost::local_shared_ptr<Context>& context, const TupleNode* node)
 			{
-				const auto& firstValue = co_await visit(context, node->first);
-				const auto& secondValue = co_await visit(context, node->second);
+				if (shouldFork(node->first, node->second))
+					co_return co_await fork(context, node->first, node->second);
+
+				const auto& firstValue = co_await evaluate(context, node->first);
+				const auto& secondValue = co_await evaluate(context, node->second);
 				co_return TupleValue(firstValue, secondValue);
 			}
 
 			Task visitFnNode(boost::local_shared_ptr<Context>& context, const FnNode* node)
 			{
-				co_return FnValue(node, context);
+				return Task::ready(FnValue(node, context));
 			}
 
 			Task visitCallNode(boost::local_shared_ptr<Context>& context, const CallNode* node)
 			{
-				const auto& calleeValue = co_await visit(context, node->callee);
+				if (executor && --callsUntilYield == 0)
+				{
+					callsUntilYield = sliceCalls;
+					co_await executor->schedule();
+				}
+
+				if (governor)
+					governor->check();
+
+				if (pool)
+				{
+					if (const auto forkedEnvironment =
+							dynamic_cast<const ForkedEnvironment*>(context->getEnvironment().get());
+						forkedEnvironment && forkedEnvironment->isCancelled())
+					{
+						throw RinhaException("Forked evaluation cancelled.");
+					}
+				}
+
+				const auto& calleeValue = co_await evaluate(context, node->callee);
 
 				if (const auto calleeValueFn = std::get_if<FnValue>(&calleeValue))
 				{
@@ -48,18 +213,33 @@ namespace rinha::interpreter
 						throw RinhaException("Arguments and parameters count do not match.");
 
 					auto calleeContext = boost::make_local_shared<Context>(calleeValueFn->getContext());
-					auto argumentIt = node->arguments.begin();
 
-					for (const auto parameter : fnNode->getParameters())
+					if (node->arguments.size() == 2 && shouldFork(node->arguments[0], node->arguments[1]))
+					{
+						const auto argumentsValue = co_await fork(context, node->arguments[0], node->arguments[1]);
+						const auto& arguments = std::get<TupleValue>(argumentsValue);
+						const auto& parameters = fnNode->getParameters();
+
+						calleeContext->createVariable(parameters[0]->name);
+						calleeContext->setVariable(parameters[0]->name, arguments.getFirst());
+						calleeContext->createVariable(parameters[1]->name);
+						calleeContext->setVariable(parameters[1]->name, arguments.getSecond());
+					}
+					else
 					{
-						calleeContext->createVariable(parameter->name);
-						calleeContext->setVariable(parameter->name, co_await visit(context, *argumentIt));
-						++argumentIt;
+						auto argumentIt = node->arguments.begin();
+
+						for (const auto parameter : fnNode->getParameters())
+						{
+							calleeContext->createVariable(parameter->name);
+							calleeContext->setVariable(parameter->name, co_await evaluate(context, *argumentIt));
+							++argumentIt;
+						}
 					}
 
 					fnNode->getBody()->compile(calleeContext);
 
-					co_return co_await visit(calleeContext, fnNode->getBody());
+					co_return co_await evaluate(calleeContext, fnNode->getBody());
 				}
 
 				throw RinhaException("Cannot call a non-function.");
@@ -67,22 +247,30 @@ namespace rinha::interpreter
 
 			Task visitBinaryOpNode(boost::local_shared_ptr<Context>& context, const BinaryOpNode* node)
 			{
-				const auto& firstValue = co_await visit(context, node->first);
-				const auto& secondValue = co_await visit(context, node->second);
+				if (shouldFork(node->first, node->second))
+				{
+					const auto operandsValue = co_await fork(context, node->first, node->second);
+					const auto& operands = std::get<TupleValue>(operandsValue);
+
+					co_return Runtime::binaryOp(node->op, operands.getFirst(), operands.getSecond());
+				}
+
+				const auto& firstValue = co_await evaluate(context, node->first);
+				const auto& secondValue = co_await evaluate(context, node->second);
 
 				co_return Runtime::binaryOp(node->op, firstValue, secondValue);
 			}
 
 			Task visitIfNode(boost::local_shared_ptr<Context>& context, const IfNode* node)
 			{
-				const auto& conditionValue = co_await visit(context, node->condition);
+				const auto& conditionValue = co_await evaluate(context, node->condition);
 
 				if (const auto conditionValueBool = std::get_if<BoolValue>(&conditionValue))
 				{
 					if (conditionValueBool->getValue())
-						co_return co_await visit(context, node->then);
+						co_return co_await evaluate(context, node->then);
 					else
-						co_return co_await visit(context, node->otherwise);
+						co_return co_await evaluate(context, node->otherwise);
 				}
 
 				throw RinhaException("Invalid datatype in if.");
@@ -90,7 +278,7 @@ namespace rinha::interpreter
 
 			Task visitTupleIndexNode(boost::local_shared_ptr<Context>& context, const TupleIndexNode* node)
 			{
-				const auto& value = co_await visit(context, node->arg);
+				const auto& value = co_await evaluate(context, node->arg);
 
 				if (const auto conditionValueTuple = std::get_if<TupleValue>(&value))
 					co_return node->index == 0 ? conditionValueTuple->getFirst() : conditionValueTuple->getSecond();
@@ -100,24 +288,208 @@ namespace rinha::interpreter
 
 			Task visitVarNode(boost::local_shared_ptr<Context>& context, const VarNode* node)
 			{
-				co_return context->getVariable(node->reference->name);
+				return Task::ready(context->getVariable(node->reference->name));
 			}
 
 			Task visitLetNode(boost::local_shared_ptr<Context>& context, const LetNode* node)
 			{
-				context->setVariable(node->reference->name, co_await visit(context, node->value));
+				context->setVariable(node->reference->name, co_await evaluate(context, node->value));
 
-				co_return co_await visit(context, node->next);
+				co_return co_await evaluate(context, node->next);
 			}
 
 			Task visitPrintNode(boost::local_shared_ptr<Context>& context, const PrintNode* node)
 			{
-				const auto& value = co_await visit(context, node->arg);
+				const auto& value = co_await evaluate(context, node->arg);
 
-				std::visit([&](auto&& arg) { context->getEnvironment()->printLine(arg.toString()); }, value);
+				context->getEnvironment()->print(value);
 
 				co_return value;
 			}
+
+		private:
+			// Both operands make calls, neither prints or binds variables, the pool has idle threads and not too many
+			// forks are in progress.
+			bool shouldFork(const TermNode* first, const TermNode* second)
+			{
+				if (!pool || !pool->isHungry() || forks.load(std::memory_order_relaxed) >= maxForks)
+					return false;
+
+				const auto& firstInfo = getInfo(first);
+				const auto& secondInfo = getInfo(second);
+
+				return firstInfo.directHeight > MAX_DIRECT_HEIGHT && secondInfo.directHeight > MAX_DIRECT_HEIGHT &&
+					firstInfo.quiet && secondInfo.quiet;
+			}
+
+			// Evaluates the first node here and the second one in the pool, on a copy of the context, returning both
+			// as a tuple. If the second one fails, prints (in a function it calls) or returns a closure, it's
+			// evaluated again here after the first one, so output and errors stay in program order. If the first
+			// one fails, the second one is cancelled, as it may not end.
+			Task fork(boost::local_shared_ptr<Context>& context, const TermNode* first, const TermNode* second)
+			{
+				local_shared_ptr<Context> secondContext;
+				// Owned by the copy, whose references are only counted by the thread evaluating it.
+				ForkedEnvironment* secondEnvironment;
+
+				{
+					auto environment = make_local_shared<ForkedEnvironment>(
+						dynamic_cast<const ForkedEnvironment*>(context->getEnvironment().get()));
+					secondEnvironment = environment.get();
+
+					ContextCopier copier(std::move(environment));
+					secondContext = copier.copy(context);
+				}
+
+				vector<Task> tasks;
+				tasks.push_back(evaluate(context, first));
+				tasks.push_back(evaluate(secondContext, second));
+
+				++forks;
+				auto results = co_await WhenAll(*pool, std::move(tasks), &secondEnvironment->cancelled);
+				--forks;
+
+				if (const auto exception = std::get_if<exception_ptr>(&results[0]))
+					std::rethrow_exception(*exception);
+
+				auto& firstValue = std::get<Value>(results[0]);
+
+				if (const auto secondValue = std::get_if<Value>(&results[1]); secondValue && !holdsClosure(*secondValue))
+					co_return TupleValue(std::move(firstValue), std::move(*secondValue));
+
+				co_return TupleValue(std::move(firstValue), co_await evaluate(context, second));
+			}
+
+			// Computes the information of all nodes.
+			void analyze(const TermNode* node)
+			{
+				getInfo(node);
+
+				switch (node->getType())
+				{
+					case TermNode::Type::LITERAL:
+					case TermNode::Type::VAR:
+						break;
+
+					case TermNode::Type::TUPLE:
+						analyze(static_cast<const TupleNode*>(node)->first);
+						analyze(static_cast<const TupleNode*>(node)->second);
+						break;
+
+					case TermNode::Type::FN:
+						analyze(static_cast<const FnNode*>(node)->getBody());
+						break;
+
+					case TermNode::Type::CALL:
+						analyze(static_cast<const CallNode*>(node)->callee);
+
+						for (const auto argument : static_cast<const CallNode*>(node)->arguments)
+							analyze(argument);
+
+						break;
+
+					case TermNode::Type::BINARY_OP:
+						analyze(static_cast<const BinaryOpNode*>(node)->first);
+						analyze(static_cast<const BinaryOpNode*>(node)->second);
+						break;
+
+					case TermNode::Type::IF:
+						analyze(static_cast<const IfNode*>(node)->condition);
+						analyze(static_cast<const IfNode*>(node)->then);
+						analyze(static_cast<const IfNode*>(node)->otherwise);
+						break;
+
+					case TermNode::Type::TUPLE_INDEX:
+						analyze(static_cast<const TupleIndexNode*>(node)->arg);
+						break;
+
+					case TermNode::Type::LET:
+						analyze(static_cast<const LetNode*>(node)->value);
+						analyze(static_cast<const LetNode*>(node)->next);
+						break;
+
+					case TermNode::Type::PRINT:
+						analyze(static_cast<const PrintNode*>(node)->arg);
+						break;
+				}
+			}
+
+			// Cached, as it's asked on every visit.
+			const NodeInfo& getInfo(const TermNode* node)
+			{
+				if (const auto it = nodeInfos.find(node); it != nodeInfos.end())
+					return it->second;
+
+				NodeInfo info{1, true};
+
+				const auto child = [&](const TermNode* childNode) {
+					const auto& childInfo = getInfo(childNode);
+					info.directHeight =
+						std::max(info.directHeight, std::min(childInfo.directHeight, MAX_DIRECT_HEIGHT + 1) + 1);
+					info.quiet = info.quiet && childInfo.quiet;
+				};
+
+				switch (node->getType())
+				{
+					case TermNode::Type::LITERAL:
+					case TermNode::Type::FN:
+					case TermNode::Type::VAR:
+						break;
+
+					case TermNode::Type::TUPLE:
+						child(static_cast<const TupleNode*>(node)->first);
+						child(static_cast<const TupleNode*>(node)->second);
+						break;
+
+					case TermNode::Type::CALL:
+						child(static_cast<const CallNode*>(node)->callee);
+
+						for (const auto argument : static_cast<const CallNode*>(node)->arguments)
+							child(argument);
+
+						info.directHeight = MAX_DIRECT_HEIGHT + 1;
+						break;
+
+					case TermNode::Type::BINARY_OP:
+						child(static_cast<const BinaryOpNode*>(node)->first);
+						child(static_cast<const BinaryOpNode*>(node)->second);
+						break;
+
+					case TermNode::Type::IF:
+						child(static_cast<const IfNode*>(node)->condition);
+						child(static_cast<const IfNode*>(node)->then);
+						child(static_cast<const IfNode*>(node)->otherwise);
+						break;
+
+					case TermNode::Type::TUPLE_INDEX:
+						child(static_cast<const TupleIndexNode*>(node)->arg);
+						break;
+
+					case TermNode::Type::LET:
+						child(static_cast<const LetNode*>(node)->value);
+						child(static_cast<const LetNode*>(node)->next);
+						info.quiet = false;
+						break;
+
+					case TermNode::Type::PRINT:
+						child(static_cast<const PrintNode*>(node)->arg);
+						info.quiet = false;
+						break;
+				}
+
+				return nodeInfos.emplace(node, info).first->second;
+			}
+
+		private:
+			ManualExecutor* const executor;
+			const unsigned sliceCalls;
+			unsigned callsUntilYield;
+			ThreadPoolExecutor* const pool = nullptr;
+			ResourceGovernor* const governor = nullptr;
+			const unsigned maxForks = 0;
+			std::atomic<unsigned> forks = 0;
+			DirectExecuteVisitor directVisitor;
+			std::unordered_map<const TermNode*, NodeInfo> nodeInfos;
 		};
 	}  // namespace
 
@@ -126,12 +498,57 @@ namespace rinha::interpreter
 	{
 		const auto term = parsedSource->getTerm();
 
+		if (threadCount > 1)
+		{
+			ThreadPoolExecutor pool(threadCount);
+			CoroutineExecuteVisitor visitor(&pool, threadCount, term);
+
+			return pool.syncWait(visitor.start(environment, term));
+		}
+
 		auto context = make_local_shared<Context>(environment);
 		term->compile(context);
 
-		CoroutineExecuteVisitor visitor;
+		return evaluate(std::move(context), term);
+	}
+
+	Value CoroutineExecutionStrategy::evaluate(
+		local_shared_ptr<Context> context, const TermNode* term, ResourceGovernor* governor)
+	{
+		CoroutineExecuteVisitor visitor(nullptr, 0, governor);
+		ManualExecutor executor;
+
+		return executor.syncWait(visitor.evaluate(context, term));
+	}
+
+	vector<variant<Value, exception_ptr>> CoroutineExecutionStrategy::runInterleaved(
+		const vector<Program>& programs, unsigned sliceCalls)
+	{
 		ManualExecutor executor;
+		std::deque<CoroutineExecuteVisitor> visitors;
+		vector<Task> tasks;
+
+		for (const auto& program : programs)
+		{
+			auto& visitor = visitors.emplace_back(&executor, sliceCalls);
+			tasks.push_back(visitor.start(program.environment, program.parsedSource->getTerm()));
+		}
+
+		const auto syncWaitTasks = executor.syncWaitAll(std::move(tasks));
+		vector<variant<Value, exception_ptr>> results;
+
+		for (const auto& syncWaitTask : syncWaitTasks)
+		{
+			try
+			{
+				results.emplace_back(syncWaitTask.getResult());
+			}
+			catch (...)
+			{
+				results.emplace_back(std::current_exception());
+			}
+		}
 
-		return executor.syncWait(visitor.visit(context, term));
+		return results;
 	}
 }  // namespace rinha::interpreter
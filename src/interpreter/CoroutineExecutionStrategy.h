@@ -2,14 +2,51 @@
 #define RINHA_INTERPRETER_COROUTINE_EXECUTION_STRATEGY_H
 
 #include "./ExecutionStrategy.h"
+#include "./ResourceGovernor.h"
+#include <exception>
+#include <variant>
+#include <vector>
 
 namespace rinha::interpreter
 {
+	class Context;
+
 	class CoroutineExecutionStrategy final : public ExecutionStrategy
 	{
+	public:
+		struct Program final
+		{
+			boost::local_shared_ptr<Environment> environment;
+			boost::local_shared_ptr<ParsedSource> parsedSource;
+		};
+
+		// Calls a program makes before yielding to the others, when interleaved.
+		static constexpr unsigned DEFAULT_SLICE_CALLS = 1000;
+
+	public:
+		// With more than one thread, operands that make calls but don't print are evaluated in parallel.
+		explicit CoroutineExecutionStrategy(unsigned threadCount = 1)
+			: threadCount(threadCount)
+		{
+		}
+
+	public:
+		// Evaluates a term in an existing context, so other strategies can continue deep recursion here. The
+		// governor, if any, is checked on each call.
+		static Value evaluate(
+			boost::local_shared_ptr<Context> context, const TermNode* term, ResourceGovernor* governor = nullptr);
+
+		// Runs the programs on the calling thread, each one yielding to the next every sliceCalls calls, so a long
+		// program doesn't starve short ones. Returns the value or the error of each program.
+		static std::vector<std::variant<Value, std::exception_ptr>> runInterleaved(
+			const std::vector<Program>& programs, unsigned sliceCalls = DEFAULT_SLICE_CALLS);
+
 	public:
 		Value run(boost::local_shared_ptr<Environment> environment,
 			boost::local_shared_ptr<ParsedSource> parsedSource) override;
+
+	private:
+		const unsigned threadCount;
 	};
 }  // namespace rinha::interpreter
 
@@ -0,0 +1,382 @@
+#include "./CppGenerator.h"
+#include "./Nodes.h"
+#include "./ScopeAnalysis.h"
+#include "./Values.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+// string
+using std::string;
+using std::to_string;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		constexpr const char* BINARY_OPS[] = {"ADD", "SUB", "MUL", "DIV", "REM", "EQ", "NEQ", "LT", "GT", "LTE",
+			"GTE", "AND", "OR"};
+
+		static_assert(std::size(BINARY_OPS) == unsigned(BinaryOpNode::Op::OR) + 1);
+	}  // namespace
+
+	string CppGenerator::generate(const TermNode* root)
+	{
+		CppGenerator generator(root);
+		auto& out = generator.out;
+		const auto& scopes = generator.scopeAnalysis.getScopes();
+		const auto functionCount = (unsigned) scopes.size() - 1;
+
+		out << "#include \"AotRuntime.h\"\n"
+			   "#include <boost/smart_ptr/local_shared_ptr.hpp>\n"
+			   "#include <boost/smart_ptr/make_local_shared.hpp>\n"
+			   "#include <optional>\n"
+			   "\n"
+			   "using namespace rinha::interpreter;\n"
+			   "using boost::local_shared_ptr;\n"
+			   "using boost::make_local_shared;\n"
+			   "using std::optional;\n"
+			   "\n"
+			   "namespace\n"
+			   "{\n";
+
+		// Functions are identified at runtime by their FnNode, as FnValue requires.
+		// Only the parameter names are kept, for the arity check.
+		if (functionCount)
+		{
+			out << "\tconst ReferenceNode parameters[] = {";
+
+			for (unsigned i = 1; i <= functionCount; ++i)
+			{
+				for (const auto parameter : scopes[i]->fnNode->getParameters())
+					out << "ReferenceNode(" << quote(parameter->name) << "), ";
+			}
+
+			out << "ReferenceNode(\"\")};\n\n\tconst ReferenceNode* const parameterNodes[] = {";
+
+			for (unsigned i = 1, parameterIndex = 0; i <= functionCount; ++i)
+			{
+				for (unsigned j = 0; j < scopes[i]->getParameterCount(); ++j)
+					out << "&parameters[" << parameterIndex++ << "], ";
+			}
+
+			out << "nullptr};\n\n\tconst FnNode fnNodes[] = {\n";
+
+			for (unsigned i = 1, parameterIndex = 0; i <= functionCount; ++i)
+			{
+				generator.functionIndexes[scopes[i]->fnNode] = i - 1;
+
+				out << "\t\tFnNode({parameterNodes + " << parameterIndex << ", " << scopes[i]->getParameterCount()
+					<< "}, nullptr),\n";
+
+				parameterIndex += scopes[i]->getParameterCount();
+			}
+
+			out << "\t};\n\n";
+		}
+
+		out << "\tEnvironment* environment = nullptr;\n\n";
+
+		for (unsigned i = 0; i < functionCount; ++i)
+			out << "\tValue fn" << i << "(const FnValue& callee, Value* arguments);\n";
+
+		if (functionCount)
+		{
+			out << "\n\tconst AotRuntime::Code fnCodes[] = {";
+
+			for (unsigned i = 0; i < functionCount; ++i)
+				out << (i == 0 ? "" : ", ") << "fn" << i;
+
+			out << "};\n\n"
+				   "\tValue call(const FnValue& callee, Value* arguments)\n"
+				   "\t{\n"
+				   "\t\treturn fnCodes[callee.getValue() - fnNodes](callee, arguments);\n"
+				   "\t}\n";
+		}
+		else
+		{
+			// AotRuntime::callee() never succeeds without functions.
+			out << "\n\tValue call(const FnValue& callee, Value* arguments)\n"
+				   "\t{\n"
+				   "\t\tthrow RinhaException(\"Cannot call a non-function.\");\n"
+				   "\t}\n";
+		}
+
+		for (unsigned i = 1; i <= functionCount; ++i)
+		{
+			out << "\n\tValue fn" << (i - 1) << "(const FnValue& callee, Value* arguments)\n\t{\n";
+			generator.generateFunction(*scopes[i], scopes[i]->fnNode->getBody());
+			out << "\t}\n";
+		}
+
+		out << "\n\tValue run(local_shared_ptr<Environment> rootEnvironment)\n\t{\n";
+		out << "\t\tenvironment = rootEnvironment.get();\n\n";
+		generator.generateFunction(*scopes[0], root);
+		out << "\t}\n"
+			   "}  // namespace\n"
+			   "\n"
+			   "int main()\n"
+			   "{\n"
+			   "\treturn AotRuntime::main(run);\n"
+			   "}\n";
+
+		return out.str();
+	}
+
+	void CppGenerator::generateFunction(const Scope& functionScope, const TermNode* body)
+	{
+		scope = &functionScope;
+		indent = 2;
+		temporaryCount = 0;
+
+		const auto slotCount = scope->getSlotCount();
+		const auto isRoot = !scope->fnNode;
+
+		if (scope->capturing)
+		{
+			line() << "const auto context = make_local_shared<Context>("
+				   << (isRoot ? "rootEnvironment" : "callee.getContext()") << ", " << slotCount << ");\n";
+			line() << "const auto locals = context->getSlots().data();\n";
+
+			if (!isRoot)
+				line() << "[[maybe_unused]] Context* const outer = context->getOuter();\n";
+		}
+		else
+		{
+			if (slotCount)
+				line() << "optional<Value> locals[" << slotCount << "];\n";
+
+			if (!isRoot)
+				line() << "[[maybe_unused]] Context* const outer = callee.getContext().get();\n";
+		}
+
+		for (unsigned i = 0; i < scope->getParameterCount(); ++i)
+			line() << "locals[" << i << "] = std::move(arguments[" << i << "]);\n";
+
+		for (const auto slot : scope->resetSlots)
+			line() << "locals[" << slot << "].reset();\n";
+
+		const auto result = generateTerm(body);
+		line() << "return " << result << ";\n";
+	}
+
+	// Emits the statements evaluating the node and returns the expression holding its value.
+	string CppGenerator::generateTerm(const TermNode* node)
+	{
+		switch (node->getType())
+		{
+			case TermNode::Type::LITERAL:
+				return valueExpression(static_cast<const LiteralNode*>(node)->value);
+
+			case TermNode::Type::TUPLE:
+			{
+				const auto tupleNode = static_cast<const TupleNode*>(node);
+				const auto first = generateTerm(tupleNode->first);
+				const auto second = generateTerm(tupleNode->second);
+				const auto result = newTemporary();
+				line() << "const Value " << result << " = TupleValue(" << first << ", " << second << ");\n";
+				return result;
+			}
+
+			case TermNode::Type::FN:
+				return "Value(FnValue(&fnNodes[" + to_string(functionIndexes.at(static_cast<const FnNode*>(node))) +
+					"], context))";
+
+			case TermNode::Type::CALL:
+			{
+				const auto callNode = static_cast<const CallNode*>(node);
+				auto calleeValue = generateTerm(callNode->callee);
+
+				// The callee is referenced until the call returns, so it can't be a temporary object.
+				if (calleeValue.starts_with("Value("))
+				{
+					const auto value = newTemporary();
+					line() << "const Value " << value << " = " << calleeValue << ";\n";
+					calleeValue = value;
+				}
+
+				const auto callee = newTemporary();
+
+				line() << "const auto& " << callee << " = AotRuntime::callee(" << calleeValue << ", "
+					   << callNode->arguments.size() << ");\n";
+
+				string arguments;
+
+				for (const auto argument : callNode->arguments)
+					arguments += (arguments.empty() ? "" : ", ") + generateTerm(argument);
+
+				const auto result = newTemporary();
+
+				if (arguments.empty())
+					line() << "const Value " << result << " = call(" << callee << ", nullptr);\n";
+				else
+				{
+					const auto argumentsArray = newTemporary();
+					line() << "Value " << argumentsArray << "[] = {" << arguments << "};\n";
+					line() << "const Value " << result << " = call(" << callee << ", " << argumentsArray << ");\n";
+				}
+
+				return result;
+			}
+
+			case TermNode::Type::BINARY_OP:
+			{
+				const auto binaryOpNode = static_cast<const BinaryOpNode*>(node);
+				const auto first = generateTerm(binaryOpNode->first);
+				const auto second = generateTerm(binaryOpNode->second);
+				const auto result = newTemporary();
+				line() << "const Value " << result << " = AotRuntime::binaryOp<BinaryOpNode::Op::"
+					   << BINARY_OPS[unsigned(binaryOpNode->op)] << ">(" << first << ", " << second << ");\n";
+				return result;
+			}
+
+			case TermNode::Type::IF:
+			{
+				const auto ifNode = static_cast<const IfNode*>(node);
+				const auto condition = generateTerm(ifNode->condition);
+				const auto result = newTemporary();
+
+				line() << "optional<Value> " << result << ";\n";
+				line() << "if (AotRuntime::condition(" << condition << "))\n";
+				line() << "{\n";
+				++indent;
+				const auto then = generateTerm(ifNode->then);
+				line() << result << ".emplace(" << then << ");\n";
+				--indent;
+				line() << "}\n";
+				line() << "else\n";
+				line() << "{\n";
+				++indent;
+				const auto otherwise = generateTerm(ifNode->otherwise);
+				line() << result << ".emplace(" << otherwise << ");\n";
+				--indent;
+				line() << "}\n";
+
+				return "*" + result;
+			}
+
+			case TermNode::Type::TUPLE_INDEX:
+			{
+				const auto tupleIndexNode = static_cast<const TupleIndexNode*>(node);
+				const auto arg = generateTerm(tupleIndexNode->arg);
+				const auto result = newTemporary();
+				line() << "const Value " << result << " = AotRuntime::tupleIndex<" << tupleIndexNode->index << ">("
+					   << arg << ");\n";
+				return result;
+			}
+
+			case TermNode::Type::VAR:
+				return generateVar(static_cast<const VarNode*>(node));
+
+			case TermNode::Type::LET:
+			{
+				const auto letNode = static_cast<const LetNode*>(node);
+				const auto value = generateTerm(letNode->value);
+				line() << "locals[" << scopeAnalysis.getLetSlot(letNode) << "] = " << value << ";\n";
+				return generateTerm(letNode->next);
+			}
+
+			case TermNode::Type::PRINT:
+			{
+				const auto arg = generateTerm(static_cast<const PrintNode*>(node)->arg);
+				const auto result = newTemporary();
+				line() << "const Value " << result << " = AotRuntime::print(*environment, " << arg << ");\n";
+				return result;
+			}
+		}
+
+		assert(false);
+		throw std::logic_error("Invalid node type for generate");
+	}
+
+	string CppGenerator::generateVar(const VarNode* node)
+	{
+		const auto& candidates = scopeAnalysis.getCandidates(node);
+		const auto result = newTemporary();
+
+		// Parameters not shadowed by a let are always assigned.
+		if (candidates.size() == 1 && candidates[0].hops == 0 &&
+			candidates[0].index < scope->getParameterCount() &&
+			std::find(scope->resetSlots.begin(), scope->resetSlots.end(), candidates[0].index) ==
+				scope->resetSlots.end())
+		{
+			line() << "const Value " << result << " = *locals[" << candidates[0].index << "];\n";
+			return result;
+		}
+
+		line() << "const Value " << result << " = AotRuntime::lookup(" << quote(node->reference->name) << ", {";
+
+		for (unsigned i = 0; i < candidates.size(); ++i)
+		{
+			const auto& candidate = candidates[i];
+
+			out << (i == 0 ? "" : ", ");
+
+			if (candidate.hops == 0)
+				out << "&locals[" << candidate.index << "]";
+			else
+				out << "&AotRuntime::outerSlot(outer, " << candidate.hops << ", " << candidate.index << ")";
+		}
+
+		out << "});\n";
+
+		return result;
+	}
+
+	string CppGenerator::newTemporary()
+	{
+		return "t" + to_string(temporaryCount++);
+	}
+
+	std::ostream& CppGenerator::line()
+	{
+		return out << string(indent, '\t');
+	}
+
+	string CppGenerator::quote(const string& s)
+	{
+		string result = "\"";
+
+		for (const auto c : s)
+		{
+			if (c == '"' || c == '\\')
+			{
+				result += '\\';
+				result += c;
+			}
+			else if ((unsigned char) c < 0x20 || c == 0x7F || c == '?')
+			{
+				// Always three octal digits, so following characters are never taken as part of the escape.
+				// '?' is escaped to avoid trigraphs.
+				char escape[5];
+				snprintf(escape, sizeof(escape), "\\%03o", (unsigned char) c);
+				result += escape;
+			}
+			else
+				result += c;
+		}
+
+		return result + "\"";
+	}
+
+	string CppGenerator::valueExpression(const Value& value)
+	{
+		if (const auto valueInt = std::get_if<IntValue>(&value))
+			return "Value(IntValue(int32_t(" + to_string(valueInt->getValue()) + "LL)))";
+		else if (const auto valueBool = std::get_if<BoolValue>(&value))
+			return valueBool->getValue() ? "Value(BoolValue(true))" : "Value(BoolValue(false))";
+		else if (const auto valueStr = std::get_if<StrValue>(&value))
+		{
+			const auto& str = valueStr->getValue();
+			return "Value(StrValue(std::string(" + quote(str) + ", " + to_string(str.size()) + ")))";
+		}
+
+		assert(false);
+		throw std::logic_error("Invalid literal value");
+	}
+}  // namespace rinha::interpreter
@@ -0,0 +1,45 @@
+#ifndef RINHA_INTERPRETER_CPP_GENERATOR_H
+#define RINHA_INTERPRETER_CPP_GENERATOR_H
+
+#include "./Nodes.h"
+#include "./ScopeAnalysis.h"
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace rinha::interpreter
+{
+	// Translates a program to a standalone C++ source built against AotRuntime.h.
+	// Each function becomes a C++ function with its slots resolved by ScopeAnalysis.
+	class CppGenerator final
+	{
+	public:
+		static std::string generate(const TermNode* root);
+
+	private:
+		explicit CppGenerator(const TermNode* root)
+			: scopeAnalysis(root)
+		{
+		}
+
+	private:
+		void generateFunction(const Scope& scope, const TermNode* body);
+		std::string generateTerm(const TermNode* node);
+		std::string generateVar(const VarNode* node);
+		std::string newTemporary();
+		std::ostream& line();
+
+		static std::string quote(const std::string& s);
+		static std::string valueExpression(const Value& value);
+
+	private:
+		ScopeAnalysis scopeAnalysis;
+		std::unordered_map<const FnNode*, unsigned> functionIndexes;
+		std::ostringstream out;
+		const Scope* scope = nullptr;
+		unsigned indent = 0;
+		unsigned temporaryCount = 0;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_CPP_GENERATOR_H
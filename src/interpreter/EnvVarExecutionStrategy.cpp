@@ -1,13 +1,24 @@
 #include "./EnvVarExecutionStrategy.h"
+#include "./AutoExecutionStrategy.h"
+#include "./BytecodeExecutionStrategy.h"
+#include "./CekExecutionStrategy.h"
+#include "./ClosureExecutionStrategy.h"
 #include "./CoroutineExecutionStrategy.h"
+#include "./JitExecutionStrategy.h"
 #include "./TreeWalkerExecutionStrategy.h"
 #include "./Environment.h"
 #include "./Exceptions.h"
 #include "./ParsedSource.h"
+#include "./ResourceGovernor.h"
 #include "./Values.h"
 #include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <thread>
 #include <cstdlib>
+#include <cstring>
 
 // boost/smart_ptr/local_shared_ptr
 using boost::local_shared_ptr;
@@ -15,16 +26,76 @@ using boost::local_shared_ptr;
 
 namespace rinha::interpreter
 {
+	namespace
+	{
+		std::uint64_t getLimit(const char* name)
+		{
+			const auto env = std::getenv(name);
+			return env ? std::strtoull(env, nullptr, 10) : 0;
+		}
+	}  // namespace
+
 	Value EnvVarExecutionStrategy::run(
 		local_shared_ptr<Environment> environment, local_shared_ptr<ParsedSource> parsedSource)
 	{
 		const auto env = std::getenv("RINHA_EXEC_STRATEGY");
+		constexpr auto stackSize = TreeWalkerExecutionStrategy::DEFAULT_RESERVED_STACK_SIZE;
+		const auto limits = getLimitsFromEnvironment();
 
 		if (!env || strcmp(env, "tree-walker") == 0)
-			return TreeWalkerExecutionStrategy().run(environment, parsedSource);
+		{
+			return TreeWalkerExecutionStrategy({.reservedStackSize = stackSize, .limits = limits})
+				.run(environment, parsedSource);
+		}
+		else if (!limits.isUnlimited() && strcmp(env, "tiered") != 0 && strcmp(env, "hybrid") != 0)
+		{
+			// Running without the limits would silently give no protection.
+			throw RinhaException("Resource limits are not supported by the " + std::string(env) +
+				" execution strategy; use tree-walker, tiered or hybrid.");
+		}
+		else if (strcmp(env, "auto") == 0)
+			return AutoExecutionStrategy().run(environment, parsedSource);
+		else if (strcmp(env, "tiered") == 0)
+		{
+			return TreeWalkerExecutionStrategy({.tiered = true, .reservedStackSize = stackSize, .limits = limits})
+				.run(environment, parsedSource);
+		}
+		else if (strcmp(env, "hybrid") == 0)
+		{
+			const auto depthEnv = std::getenv("RINHA_HYBRID_DEPTH");
+			const auto depth = depthEnv ? unsigned(std::strtoul(depthEnv, nullptr, 10)) :
+										  TreeWalkerExecutionStrategy::DEFAULT_COROUTINE_DEPTH;
+
+			return TreeWalkerExecutionStrategy({.coroutineDepth = depth, .limits = limits}).run(environment, parsedSource);
+		}
 		else if (strcmp(env, "coroutine") == 0)
 			return CoroutineExecutionStrategy().run(environment, parsedSource);
+		else if (strcmp(env, "parallel") == 0)
+		{
+			const auto threadsEnv = std::getenv("RINHA_THREADS");
+			const auto threadCount = threadsEnv ? unsigned(std::strtoul(threadsEnv, nullptr, 10)) :
+												  std::max(std::thread::hardware_concurrency(), 2u);
+
+			return CoroutineExecutionStrategy(threadCount).run(environment, parsedSource);
+		}
+		else if (strcmp(env, "cek") == 0)
+			return CekExecutionStrategy().run(environment, parsedSource);
+		else if (strcmp(env, "bytecode") == 0)
+			return BytecodeExecutionStrategy().run(environment, parsedSource);
+		else if (strcmp(env, "closure") == 0)
+			return ClosureExecutionStrategy().run(environment, parsedSource);
+		else if (strcmp(env, "jit") == 0)
+			return JitExecutionStrategy().run(environment, parsedSource);
 		else
 			throw RinhaException("Unknown execution strategy: " + std::string(env));
 	}
+
+	ResourceLimits EnvVarExecutionStrategy::getLimitsFromEnvironment()
+	{
+		return ResourceLimits{
+			.maxCalls = getLimit("RINHA_MAX_CALLS"),
+			.maxAllocatedBytes = getLimit("RINHA_MAX_ALLOCATED_BYTES"),
+			.timeout = std::chrono::milliseconds(getLimit("RINHA_TIMEOUT_MS")),
+		};
+	}
 }  // namespace rinha::interpreter
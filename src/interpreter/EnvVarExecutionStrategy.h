@@ -2,6 +2,7 @@
 #define RINHA_INTERPRETER_ENV_VAR_EXECUTION_STRATEGY_H
 
 #include "./ExecutionStrategy.h"
+#include "./ResourceGovernor.h"
 
 namespace rinha::interpreter
 {
@@ -10,6 +11,9 @@ namespace rinha::interpreter
 	public:
 		Value run(boost::local_shared_ptr<Environment> environment,
 			boost::local_shared_ptr<ParsedSource> parsedSource) override;
+
+		// From RINHA_MAX_CALLS, RINHA_MAX_ALLOCATED_BYTES and RINHA_TIMEOUT_MS.
+		static ResourceLimits getLimitsFromEnvironment();
 	};
 }  // namespace rinha::interpreter
 
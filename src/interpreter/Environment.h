@@ -4,9 +4,16 @@
 #include "./ParsedSource.h"
 #include "./Values.h"
 #include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
 #include <iostream>
+#include <iterator>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
 
 namespace rinha::interpreter
 {
@@ -15,16 +22,122 @@ namespace rinha::interpreter
 	class Environment
 	{
 	public:
-		virtual void printLine(const std::string& s) = 0;
+		virtual void printLine(std::string_view s) = 0;
+
+		// Prints a value as its toString() would. Strings are printed without copying them, and other values are
+		// formatted into a buffer reused across calls.
+		void print(const Value& value)
+		{
+			if (const auto valueStr = std::get_if<StrValue>(&value))
+				printLine(valueStr->getValue());
+			else
+			{
+				line.clear();
+				append(line, value);
+				printLine(line);
+			}
+		}
+
+	private:
+		static void append(std::string& out, const Value& value)
+		{
+			std::visit(
+				[&](auto&& arg)
+				{
+					using T = std::decay_t<decltype(arg)>;
+
+					if constexpr (std::is_same_v<T, BoolValue>)
+						out += arg.getValue() ? "true" : "false";
+					else if constexpr (std::is_same_v<T, IntValue>)
+					{
+						char buffer[16];
+						out.append(buffer, std::to_chars(buffer, std::end(buffer), arg.getValue()).ptr);
+					}
+					else if constexpr (std::is_same_v<T, StrValue>)
+						out += arg.getValue();
+					else if constexpr (std::is_same_v<T, TupleValue>)
+					{
+						out += '(';
+						append(out, arg.getFirst());
+						out += ", ";
+						append(out, arg.getSecond());
+						out += ')';
+					}
+					else
+						out += arg.toString();
+				},
+				value);
+		}
+
+	private:
+		std::string line;
 	};
 
-	class StdEnvironment final : public Environment
+	struct BufferedEnvironmentOptions final
+	{
+		// Buffered bytes after which the buffer is written.
+		std::size_t capacity = std::size_t(64) << 10;
+
+		// When not zero, a line printed this long after the last write also writes the buffer. It's checked only
+		// when printing, so a line printed before a long computation stays buffered until the next one or the end.
+		std::chrono::milliseconds flushInterval{0};
+
+		// The clock the interval is measured with.
+		std::chrono::steady_clock::time_point (*now)() = std::chrono::steady_clock::now;
+	};
+
+	// Prints to a stream through a large buffer instead of flushing every line. The buffer is written when it
+	// reaches its capacity, on flush() and on destruction. Closures referencing their own contexts may keep the
+	// environment alive, so runs call flush() when they end, and before reporting an error so the output precedes
+	// its message.
+	class BufferedEnvironment final : public Environment
 	{
 	public:
-		void printLine(const std::string& s) override
+		explicit BufferedEnvironment(std::ostream& stream = std::cout, const BufferedEnvironmentOptions& options = {})
+			: stream(stream),
+			  options(options),
+			  lastFlush(options.now())
 		{
-			std::cout << s << std::endl;
+			buffer.reserve(options.capacity + 256);
 		}
+
+		BufferedEnvironment(const BufferedEnvironment&) = delete;
+		BufferedEnvironment& operator=(const BufferedEnvironment&) = delete;
+
+		~BufferedEnvironment()
+		{
+			flush();
+		}
+
+	public:
+		void printLine(std::string_view s) override
+		{
+			buffer.append(s);
+			buffer += '\n';
+
+			if (buffer.size() >= options.capacity ||
+				(options.flushInterval.count() != 0 &&
+					options.now() - lastFlush >= options.flushInterval))
+			{
+				flush();
+			}
+		}
+
+		void flush()
+		{
+			stream.write(buffer.data(), std::streamsize(buffer.size()));
+			stream.flush();
+			buffer.clear();
+
+			if (options.flushInterval.count() != 0)
+				lastFlush = options.now();
+		}
+
+	private:
+		std::ostream& stream;
+		const BufferedEnvironmentOptions options;
+		std::string buffer;
+		std::chrono::steady_clock::time_point lastFlush;
 	};
 }  // namespace rinha::interpreter
 
@@ -3,6 +3,7 @@
 
 #include "./Environment.h"
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace rinha::interpreter
@@ -10,9 +11,9 @@ namespace rinha::interpreter
 	class TestEnvironment final : public Environment
 	{
 	public:
-		void printLine(const std::string& s) override
+		void printLine(std::string_view s) override
 		{
-			lines.push_back(s);
+			lines.emplace_back(s);
 		}
 
 		const auto& getLines() const noexcept
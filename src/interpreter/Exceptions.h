@@ -6,11 +6,32 @@
 
 namespace rinha::interpreter
 {
-	class RinhaException final : public std::runtime_error
+	class RinhaException : public std::runtime_error
 	{
 	public:
 		using std::runtime_error::runtime_error;
 	};
+
+	// The program made more calls than allowed by ResourceLimits::maxCalls.
+	class CallLimitException final : public RinhaException
+	{
+	public:
+		using RinhaException::RinhaException;
+	};
+
+	// The program allocated more than ResourceLimits::maxAllocatedBytes.
+	class AllocationLimitException final : public RinhaException
+	{
+	public:
+		using RinhaException::RinhaException;
+	};
+
+	// The program ran longer than ResourceLimits::timeout.
+	class TimeLimitException final : public RinhaException
+	{
+	public:
+		using RinhaException::RinhaException;
+	};
 }  // namespace rinha::interpreter
 
 #endif  // RINHA_INTERPRETER_EXCEPTIONS_H
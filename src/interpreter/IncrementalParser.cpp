@@ -0,0 +1,352 @@
+#include "./IncrementalParser.h"
+#include "./Diagnostic.h"
+#include "./NativeParser.h"
+#include "./NodeArena.h"
+#include "./Nodes.h"
+#include "./ParsedSource.h"
+#include "./SemanticAnalysis.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// string
+using std::string;
+
+// string_view
+using std::string_view;
+
+// vector
+using std::vector;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		bool isIdentifierStart(char c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '{' || c == '}' || c == '_';
+		}
+
+		bool isIdentifierPart(char c)
+		{
+			return isIdentifierStart(c) || (c >= '0' && c <= '9');
+		}
+	}  // namespace
+
+	IncrementalParser::IncrementalParser(string source)
+		: source(std::move(source))
+	{
+		for (std::size_t start = 0;;)
+		{
+			auto& segment = segments.emplace_back(scanSegment(start));
+			parseSegment(segment);
+
+			if (segment.final)
+				break;
+
+			start = segment.end;
+		}
+
+		parsedCount = segments.size();
+	}
+
+	void IncrementalParser::edit(std::size_t offset, std::size_t length, string_view text)
+	{
+		if (offset > source.size() || length > source.size() - offset)
+			throw std::out_of_range("Edit outside of the source");
+
+		source.replace(offset, length, text);
+
+		const auto delta = std::ptrdiff_t(text.size()) - std::ptrdiff_t(length);
+		const auto shift = [&](std::size_t position) { return std::size_t(std::ptrdiff_t(position) + delta); };
+
+		// The segment the edit starts in. Segments before it end with a `;` that the edit doesn't touch, so they
+		// stay as they are.
+		const auto first =
+			std::size_t(std::ranges::upper_bound(segments, offset, {}, &Segment::start) - segments.begin() - 1);
+
+		// Old segments starting after the replaced text are unchanged, and can be kept once a rescanned segment
+		// ends where one of them starts.
+		auto kept = first + 1;
+
+		while (kept < segments.size() && segments[kept].start < offset + length)
+			++kept;
+
+		vector<Segment> scanned;
+
+		for (auto start = segments[first].start;;)
+		{
+			auto& segment = scanned.emplace_back(scanSegment(start));
+
+			if (segment.final)
+			{
+				kept = segments.size();
+				break;
+			}
+
+			while (kept < segments.size() && shift(segments[kept].start) < segment.end)
+				++kept;
+
+			if (kept < segments.size() && shift(segments[kept].start) == segment.end)
+				break;
+
+			start = segment.end;
+		}
+
+		for (auto i = kept; i < segments.size(); ++i)
+		{
+			segments[i].start = shift(segments[i].start);
+			segments[i].end = shift(segments[i].end);
+		}
+
+		for (auto& segment : scanned)
+			parseSegment(segment);
+
+		parsedCount = scanned.size();
+
+		// Columns of the first kept segment's first line change when the text before it on that line does.
+		if (kept < segments.size() && segments[kept].columnDependent &&
+			getColumn(segments[kept].start) != segments[kept].startColumn)
+		{
+			parseSegment(segments[kept]);
+			++parsedCount;
+		}
+
+		segments.erase(segments.begin() + first, segments.begin() + kept);
+		segments.insert(segments.begin() + first, std::make_move_iterator(scanned.begin()),
+			std::make_move_iterator(scanned.end()));
+
+		parsedSource.reset();
+		parsedSourceBuilt = false;
+	}
+
+	local_shared_ptr<Diagnostics> IncrementalParser::getDiagnostics() const
+	{
+		auto diagnostics = make_local_shared<Diagnostics>();
+		unsigned lineOffset = 0;
+
+		for (const auto& segment : segments)
+		{
+			for (auto diagnostic : segment.diagnostics)
+			{
+				diagnostic.line += lineOffset;
+				diagnostics->add(std::move(diagnostic));
+			}
+
+			lineOffset += segment.lineBreaks;
+		}
+
+		return diagnostics;
+	}
+
+	local_shared_ptr<ParsedSource> IncrementalParser::getParsedSource() const
+	{
+		if (parsedSourceBuilt)
+			return parsedSource;
+
+		parsedSourceBuilt = true;
+
+		for (const auto& segment : segments)
+		{
+			if (std::ranges::any_of(segment.diagnostics,
+					[](const auto& diagnostic) { return diagnostic.type == Diagnostic::Type::ERROR; }))
+			{
+				return nullptr;
+			}
+		}
+
+		// The lets are chained again, as each one's next term is in the following segment.
+		NodeArena arena;
+		SourcePositions positions;
+		vector<ParsedSource::Part> parts;
+		unsigned lineOffset = 0;
+
+		for (const auto& segment : segments)
+		{
+			parts.push_back({segment.parsedSource, lineOffset});
+			lineOffset += segment.lineBreaks;
+		}
+
+		const TermNode* term = segments.back().parsedSource->getTerm();
+
+		for (auto i = segments.size() - 1; i-- > 0;)
+		{
+			const auto letNode = segments[i].letNode;
+			const auto node = arena.make<LetNode>(letNode->reference, letNode->value, term);
+
+			if (const auto position = segments[i].parsedSource->getPosition(letNode))
+				positions.add(node, {position->line + parts[i].lineOffset, position->column});
+
+			term = node;
+		}
+
+		parsedSource = make_local_shared<ParsedSource>(term, std::move(arena), std::move(positions), std::move(parts));
+
+		return parsedSource;
+	}
+
+	// Finds where the `;` of the let starting the text at `start` is, counting one more `;` for each let nested
+	// without parentheses or braces. Tokens are recognized as by Rinha.g4's lexer, so a `{` or `}` followed by
+	// identifier characters is part of an identifier. Without a leading let or its `;`, the rest is the final term.
+	IncrementalParser::Segment IncrementalParser::scanSegment(std::size_t start) const
+	{
+		const string_view text = source;
+		bool letSeen = false;
+		unsigned pendingLets = 0;
+		int depth = 0;
+		auto firstToken = string_view::npos;
+
+		const auto makeSegment = [&](std::size_t end, bool final)
+		{
+			Segment segment{start, end, final};
+			segment.columnDependent = firstToken != string_view::npos &&
+				text.substr(start, firstToken - start).find('\n') == string_view::npos;
+
+			return segment;
+		};
+
+		for (auto i = start; i < text.size();)
+		{
+			const auto c = text[i];
+			const auto next = i + 1 < text.size() ? text[i + 1] : '\0';
+
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+			{
+				++i;
+				continue;
+			}
+			else if (c == '/' && next == '/')
+			{
+				i = std::min(text.find('\n', i), text.size());
+				continue;
+			}
+			else if (c == '/' && next == '*')
+			{
+				const auto commentEnd = text.find("*/", i + 2);
+				i = commentEnd == string_view::npos ? text.size() : commentEnd + 2;
+				continue;
+			}
+
+			if (firstToken == string_view::npos)
+				firstToken = i;
+
+			if (isIdentifierStart(c))
+			{
+				auto wordEnd = i + 1;
+
+				if (c != '_')
+				{
+					while (wordEnd < text.size() && isIdentifierPart(text[wordEnd]))
+						++wordEnd;
+				}
+
+				const auto word = text.substr(i, wordEnd - i);
+				i = wordEnd;
+
+				if (word == "let" && depth == 0)
+				{
+					if (letSeen)
+						++pendingLets;
+
+					letSeen = true;
+					continue;
+				}
+				else if (word == "{")
+					++depth;
+				else if (word == "}")
+					--depth;
+			}
+			else if (c == '"')
+			{
+				for (++i; i < text.size() && text[i] != '"'; ++i)
+				{
+					if (text[i] == '\\')
+						++i;
+				}
+
+				i = std::min(i + 1, text.size());
+			}
+			else
+			{
+				if (c == '(')
+					++depth;
+				else if (c == ')')
+					--depth;
+				else if (c == ';' && depth == 0 && letSeen)
+				{
+					if (pendingLets == 0)
+						return makeSegment(i + 1, false);
+
+					--pendingLets;
+				}
+
+				++i;
+			}
+
+			if (!letSeen)
+				break;
+		}
+
+		return makeSegment(text.size(), true);
+	}
+
+	void IncrementalParser::parseSegment(Segment& segment) const
+	{
+		segment.startColumn = getColumn(segment.start);
+		segment.lineBreaks =
+			unsigned(std::count(source.begin() + segment.start, source.begin() + segment.end, '\n'));
+
+		// Padded so columns are those in the source. A let is completed with a next term, which is discarded.
+		string text(segment.startColumn, ' ');
+		text.append(source, segment.start, segment.end - segment.start);
+
+		if (!segment.final)
+			text += " 0";
+
+		const NativeParser parser(text);
+		const auto parsedSource = parser.getParsedSource();
+
+		segment.parsedSource = parsedSource;
+		segment.diagnostics = parser.getDiagnostics()->getList();
+		segment.letNode = nullptr;
+
+		if (const auto term = parsedSource->getTerm())
+		{
+			if (!segment.final)
+				segment.letNode = static_cast<const LetNode*>(term);
+
+			// Only errors, as whether variables are bound depends on the other lets.
+			const auto analysisDiagnostics = SemanticAnalysis(*parsedSource).getDiagnostics();
+
+			for (const auto& diagnostic : analysisDiagnostics->getList())
+			{
+				if (diagnostic.type == Diagnostic::Type::ERROR)
+					segment.diagnostics.push_back(diagnostic);
+			}
+		}
+	}
+
+	// Code points before `offset` on its line, as NativeParser counts columns.
+	unsigned IncrementalParser::getColumn(std::size_t offset) const
+	{
+		const auto lineBreak = offset == 0 ? string::npos : source.rfind('\n', offset - 1);
+		const auto lineStart = lineBreak == string::npos ? 0 : lineBreak + 1;
+
+		return unsigned(std::count_if(source.begin() + lineStart, source.begin() + offset,
+			[](char c) { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; }));
+	}
+}  // namespace rinha::interpreter
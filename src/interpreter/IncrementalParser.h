@@ -0,0 +1,79 @@
+#ifndef RINHA_INTERPRETER_INCREMENTAL_PARSER_H
+#define RINHA_INTERPRETER_INCREMENTAL_PARSER_H
+
+#include "./Diagnostic.h"
+#include "./Nodes.h"
+#include "./ParsedSource.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace rinha::interpreter
+{
+	// Keeps a source parsed across edits, for editor sessions. The source is split into its top-level lets, each one
+	// parsed on its own by NativeParser, plus the final term. An edit rescans the text from the let it starts in up to
+	// the first unchanged boundary and reparses only the lets in between. The others keep their nodes, positions
+	// (shifted by the lines inserted above them) and diagnostics, including those of the duplicate parameter check.
+	//
+	// Diagnostics are those of each let parsed alone, so a source may get more of them than from a whole parse, which
+	// stops at the first syntax error.
+	class IncrementalParser final
+	{
+	public:
+		explicit IncrementalParser(std::string source);
+
+	public:
+		// Replaces `length` bytes at `offset` with `text`.
+		void edit(std::size_t offset, std::size_t length, std::string_view text);
+
+		const std::string& getSource() const
+		{
+			return source;
+		}
+
+		boost::local_shared_ptr<Diagnostics> getDiagnostics() const;
+
+		// Null when there are errors. Built on the first call after an edit; nodes of unchanged lets are shared.
+		boost::local_shared_ptr<ParsedSource> getParsedSource() const;
+
+		// How many top-level lets (or the final term) the last edit or the constructor parsed.
+		std::size_t getParsedCount() const
+		{
+			return parsedCount;
+		}
+
+	private:
+		// A top-level `let name = value;`, or the final term, with what precedes it up to the previous `;`.
+		struct Segment final
+		{
+			std::size_t start;
+			std::size_t end;
+			bool final;
+			// Line breaks in the segment, and code points before its start on its first line when it was parsed.
+			unsigned lineBreaks = 0;
+			unsigned startColumn = 0;
+			// Whether tokens start on its first line, so their columns depend on the text before the segment.
+			bool columnDependent = false;
+			// Parsed from the segment's text, so its first line is line 1. Columns are those in the source.
+			boost::local_shared_ptr<const ParsedSource> parsedSource;
+			std::vector<Diagnostic> diagnostics;
+			const LetNode* letNode = nullptr;
+		};
+
+	private:
+		Segment scanSegment(std::size_t start) const;
+		void parseSegment(Segment& segment) const;
+		unsigned getColumn(std::size_t offset) const;
+
+	private:
+		std::string source;
+		std::vector<Segment> segments;
+		std::size_t parsedCount = 0;
+		mutable boost::local_shared_ptr<ParsedSource> parsedSource;
+		mutable bool parsedSourceBuilt = false;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_INCREMENTAL_PARSER_H
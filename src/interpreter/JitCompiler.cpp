@@ -0,0 +1,578 @@
+#include "./JitCompiler.h"
+#include "./ClosureCompiler.h"
+#include "./Context.h"
+#include "./Nodes.h"
+#include "./ScopeAnalysis.h"
+#include "./Values.h"
+#include "./X86Assembler.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define RINHA_JIT_X86_64
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// memory
+using std::make_unique;
+
+// optional
+using std::optional;
+
+// vector
+using std::vector;
+
+
+namespace rinha::interpreter
+{
+#ifdef RINHA_JIT_X86_64
+	namespace
+	{
+		// Calls before a function is compiled.
+		constexpr unsigned CALL_THRESHOLD = 16;
+
+		// Bail outs before a function goes back to being always interpreted.
+		constexpr unsigned MAX_BAIL_OUTS = 16;
+
+		constexpr unsigned MAX_PARAMETERS = 8;
+
+		// Native stack kept free below the JIT frames, and the maximum used when the stack size is unlimited.
+		constexpr uintptr_t STACK_MARGIN = 256 * 1024;
+		constexpr uintptr_t MAX_NATIVE_STACK = uintptr_t(1) << 30;
+
+		enum class NativeType : uint8_t
+		{
+			INT,
+			BOOL
+		};
+
+		struct NativeResult final
+		{
+			int64_t value;
+			int64_t status;
+		};
+
+		using NativeEntry = NativeResult (*)(const int64_t* arguments, uintptr_t stackLimit);
+
+		uintptr_t getStackLimit()
+		{
+			thread_local const uintptr_t stackLimit = [] {
+				const auto current = (uintptr_t) __builtin_frame_address(0);
+				auto limit = current > MAX_NATIVE_STACK ? current - MAX_NATIVE_STACK : 0;
+
+				pthread_attr_t attr;
+
+				if (pthread_getattr_np(pthread_self(), &attr) == 0)
+				{
+					void* address;
+					size_t size;
+
+					if (pthread_attr_getstack(&attr, &address, &size) == 0)
+						limit = std::max(limit, (uintptr_t) address + STACK_MARGIN);
+
+					pthread_attr_destroy(&attr);
+				}
+
+				return limit;
+			}();
+
+			return stackLimit;
+		}
+
+		// Native code for a function whose body only deals with integers and booleans, calling only itself.
+		//
+		// Types are inferred statically from the argument types of the call that triggers compilation, and
+		// calls with other types are declined. Operations that would make the interpreter fail (or fault)
+		// and running out of native stack bail out of the whole native invocation. As these functions have
+		// no side effects, the interpreter can then simply run the call again from the start, with
+		// Runtime::binaryOp semantics.
+		class JitFunction final : public NativeCode
+		{
+		public:
+			explicit JitFunction(const ScopeAnalysis& scopeAnalysis, const FnNode* node)
+				: scopeAnalysis(scopeAnalysis),
+				  node(node),
+				  scope(scopeAnalysis.getScope(node)),
+				  parameterCount(scope.getParameterCount())
+			{
+			}
+
+			~JitFunction() override
+			{
+				if (code)
+					munmap(code, codeSize);
+			}
+
+			JitFunction(const JitFunction&) = delete;
+			JitFunction& operator=(const JitFunction&) = delete;
+
+		public:
+			optional<Value> call(const FnValue& callee, const optional<Value>* arguments) override
+			{
+				if (disabled)
+					return std::nullopt;
+
+				if (!entry)
+				{
+					if (++calls < CALL_THRESHOLD || !compile(arguments))
+						return std::nullopt;
+				}
+
+				int64_t nativeArguments[MAX_PARAMETERS];
+
+				for (unsigned i = 0; i < parameterCount; ++i)
+				{
+					const auto& argument = arguments[i].value();
+
+					if (const auto argumentInt = std::get_if<IntValue>(&argument);
+						argumentInt && parameterTypes[i] == NativeType::INT)
+					{
+						nativeArguments[i] = argumentInt->getValue();
+					}
+					else if (const auto argumentBool = std::get_if<BoolValue>(&argument);
+							 argumentBool && parameterTypes[i] == NativeType::BOOL)
+					{
+						nativeArguments[i] = argumentBool->getValue();
+					}
+					else
+						return std::nullopt;
+				}
+
+				// Recursive calls jump straight to the native code, so the variable they use must really be
+				// this very closure.
+				if (selfSlot)
+				{
+					auto context = callee.getContext().get();
+
+					for (unsigned hops = 1; hops < selfSlot->hops; ++hops)
+						context = context->getOuter();
+
+					const auto& binding = context->getSlots()[selfSlot->index];
+					const auto bindingFn = binding ? std::get_if<FnValue>(&binding.value()) : nullptr;
+
+					if (!bindingFn || bindingFn->getValue() != node || bindingFn->getContext() != callee.getContext())
+						return std::nullopt;
+				}
+
+				const auto result = entry(nativeArguments, getStackLimit());
+
+				if (result.status != 0)
+				{
+					if (++bailOuts >= MAX_BAIL_OUTS)
+						disabled = true;
+
+					return std::nullopt;
+				}
+
+				if (returnType == NativeType::INT)
+					return IntValue((int32_t) result.value);
+				else
+					return BoolValue(result.value != 0);
+			}
+
+		private:
+			bool compile(const optional<Value>* arguments)
+			{
+				parameterTypes.clear();
+
+				for (unsigned i = 0; i < parameterCount; ++i)
+				{
+					const auto& argument = arguments[i].value();
+
+					if (std::holds_alternative<IntValue>(argument))
+						parameterTypes.push_back(NativeType::INT);
+					else if (std::holds_alternative<BoolValue>(argument))
+						parameterTypes.push_back(NativeType::BOOL);
+					else
+						return false;
+				}
+
+				bool inferred = false;
+
+				for (const auto type : {NativeType::INT, NativeType::BOOL})
+				{
+					returnType = type;
+					selfSlot.reset();
+					localTypes.assign(scope.getSlotCount(), std::nullopt);
+					assigned.assign(scope.getSlotCount(), false);
+
+					if (infer(node->getBody()) == returnType)
+					{
+						inferred = true;
+						break;
+					}
+				}
+
+				if (!inferred)
+				{
+					disabled = true;
+					return false;
+				}
+
+				X86Assembler assembler;
+				X86Assembler::Label body, bailOut;
+				bodyLabel = &body;
+				bailOutLabel = &bailOut;
+
+				assembler.enterTrampoline();
+
+				for (unsigned i = 0; i < parameterCount; ++i)
+					assembler.pushArgumentFromRdi(i);
+
+				assembler.call(body);
+				assembler.leaveTrampoline(false);
+
+				assembler.bind(bailOut);
+				assembler.leaveTrampoline(true);
+
+				assembler.bind(body);
+				assembler.enterFunction(bailOut, (scope.getSlotCount() - parameterCount) * 8);
+				generate(assembler, node->getBody());
+				assembler.leaveFunction();
+
+				bodyLabel = bailOutLabel = nullptr;
+
+				const auto& bytes = assembler.getCode();
+				const auto pageSize = (size_t) sysconf(_SC_PAGESIZE);
+				const auto size = (bytes.size() + pageSize - 1) / pageSize * pageSize;
+				const auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+				if (memory == MAP_FAILED)
+				{
+					disabled = true;
+					return false;
+				}
+
+				memcpy(memory, bytes.data(), bytes.size());
+
+				if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+				{
+					munmap(memory, size);
+					disabled = true;
+					return false;
+				}
+
+				code = memory;
+				codeSize = size;
+				entry = reinterpret_cast<NativeEntry>(memory);
+
+				return true;
+			}
+
+			// Returns the static type of the node, or nothing when it can't run natively.
+			optional<NativeType> infer(const TermNode* node)
+			{
+				switch (node->getType())
+				{
+					case TermNode::Type::LITERAL:
+					{
+						const auto& value = static_cast<const LiteralNode*>(node)->value;
+
+						if (std::holds_alternative<IntValue>(value))
+							return NativeType::INT;
+						else if (std::holds_alternative<BoolValue>(value))
+							return NativeType::BOOL;
+
+						return std::nullopt;
+					}
+
+					case TermNode::Type::VAR:
+					{
+						const auto& candidates = scopeAnalysis.getCandidates(static_cast<const VarNode*>(node));
+
+						if (candidates.empty() || candidates[0].hops != 0)
+							return std::nullopt;
+
+						const auto slot = candidates[0].index;
+
+						if (slot < parameterCount)
+							return parameterTypes[slot];
+
+						// Lets must be assigned before being read, otherwise lookup would go to the next candidates.
+						return assigned[slot] ? localTypes[slot] : std::nullopt;
+					}
+
+					case TermNode::Type::BINARY_OP:
+					{
+						const auto binaryOpNode = static_cast<const BinaryOpNode*>(node);
+						const auto firstType = infer(binaryOpNode->first);
+						const auto secondType = infer(binaryOpNode->second);
+
+						if (!firstType || firstType != secondType)
+							return std::nullopt;
+
+						switch (binaryOpNode->op)
+						{
+							case BinaryOpNode::Op::ADD:
+							case BinaryOpNode::Op::SUB:
+							case BinaryOpNode::Op::MUL:
+							case BinaryOpNode::Op::DIV:
+							case BinaryOpNode::Op::REM:
+								return firstType == NativeType::INT ? firstType : std::nullopt;
+
+							case BinaryOpNode::Op::AND:
+							case BinaryOpNode::Op::OR:
+								return firstType == NativeType::BOOL ? firstType : std::nullopt;
+
+							default:
+								return NativeType::BOOL;
+						}
+					}
+
+					case TermNode::Type::IF:
+					{
+						const auto ifNode = static_cast<const IfNode*>(node);
+
+						if (infer(ifNode->condition) != NativeType::BOOL)
+							return std::nullopt;
+
+						const auto thenType = infer(ifNode->then);
+						const auto otherwiseType = infer(ifNode->otherwise);
+
+						return thenType == otherwiseType ? thenType : std::nullopt;
+					}
+
+					case TermNode::Type::LET:
+					{
+						const auto letNode = static_cast<const LetNode*>(node);
+						const auto slot = scopeAnalysis.getLetSlot(letNode);
+						const auto valueType = infer(letNode->value);
+
+						if (!valueType || slot < parameterCount || (localTypes[slot] && localTypes[slot] != valueType))
+							return std::nullopt;
+
+						localTypes[slot] = valueType;
+
+						const auto wasAssigned = assigned[slot];
+						assigned[slot] = true;
+
+						const auto nextType = infer(letNode->next);
+						assigned[slot] = wasAssigned;
+
+						return nextType;
+					}
+
+					case TermNode::Type::CALL:
+					{
+						const auto callNode = static_cast<const CallNode*>(node);
+						const auto calleeVarNode = nodeAs<VarNode>(callNode->callee);
+
+						if (!calleeVarNode || callNode->arguments.size() != parameterCount)
+							return std::nullopt;
+
+						const auto& candidates = scopeAnalysis.getCandidates(calleeVarNode.value());
+
+						if (candidates.size() != 1 || candidates[0].hops == 0)
+							return std::nullopt;
+
+						if (selfSlot && (selfSlot->hops != candidates[0].hops || selfSlot->index != candidates[0].index))
+							return std::nullopt;
+
+						selfSlot = candidates[0];
+
+						for (unsigned i = 0; i < parameterCount; ++i)
+						{
+							if (infer(callNode->arguments[i]) != parameterTypes[i])
+								return std::nullopt;
+						}
+
+						return returnType;
+					}
+
+					default:
+						return std::nullopt;
+				}
+			}
+
+			int32_t getSlotOffset(unsigned slot) const
+			{
+				// Arguments are pushed in order above the return address and the saved rbp; lets are below rbp.
+				if (slot < parameterCount)
+					return 16 + 8 * (int32_t) (parameterCount - 1 - slot);
+				else
+					return -8 * (int32_t) (slot - parameterCount + 1);
+			}
+
+			void generate(X86Assembler& assembler, const TermNode* node)
+			{
+				switch (node->getType())
+				{
+					case TermNode::Type::LITERAL:
+					{
+						const auto& value = static_cast<const LiteralNode*>(node)->value;
+
+						if (const auto valueInt = std::get_if<IntValue>(&value))
+							assembler.loadImmediate(valueInt->getValue());
+						else
+							assembler.loadImmediate(std::get<BoolValue>(value).getValue());
+
+						break;
+					}
+
+					case TermNode::Type::VAR:
+					{
+						const auto& candidates = scopeAnalysis.getCandidates(static_cast<const VarNode*>(node));
+						assembler.loadFrame(getSlotOffset(candidates[0].index));
+						break;
+					}
+
+					case TermNode::Type::BINARY_OP:
+					{
+						const auto binaryOpNode = static_cast<const BinaryOpNode*>(node);
+
+						generate(assembler, binaryOpNode->first);
+						assembler.pushResult();
+						generate(assembler, binaryOpNode->second);
+						assembler.popFirstOperand();
+
+						switch (binaryOpNode->op)
+						{
+							case BinaryOpNode::Op::ADD:
+								assembler.add();
+								break;
+
+							case BinaryOpNode::Op::SUB:
+								assembler.sub();
+								break;
+
+							case BinaryOpNode::Op::MUL:
+								assembler.mul();
+								break;
+
+							case BinaryOpNode::Op::DIV:
+								assembler.divide(*bailOutLabel, false);
+								break;
+
+							case BinaryOpNode::Op::REM:
+								assembler.divide(*bailOutLabel, true);
+								break;
+
+							case BinaryOpNode::Op::EQ:
+								assembler.compare(X86Assembler::Condition::EQUAL);
+								break;
+
+							case BinaryOpNode::Op::NEQ:
+								assembler.compare(X86Assembler::Condition::NOT_EQUAL);
+								break;
+
+							case BinaryOpNode::Op::LT:
+								assembler.compare(X86Assembler::Condition::LESS);
+								break;
+
+							case BinaryOpNode::Op::GT:
+								assembler.compare(X86Assembler::Condition::GREATER);
+								break;
+
+							case BinaryOpNode::Op::LTE:
+								assembler.compare(X86Assembler::Condition::LESS_EQUAL);
+								break;
+
+							case BinaryOpNode::Op::GTE:
+								assembler.compare(X86Assembler::Condition::GREATER_EQUAL);
+								break;
+
+							case BinaryOpNode::Op::AND:
+								assembler.bitwiseAnd();
+								break;
+
+							case BinaryOpNode::Op::OR:
+								assembler.bitwiseOr();
+								break;
+						}
+
+						break;
+					}
+
+					case TermNode::Type::IF:
+					{
+						const auto ifNode = static_cast<const IfNode*>(node);
+						X86Assembler::Label otherwise, end;
+
+						generate(assembler, ifNode->condition);
+						assembler.jumpIfZero(otherwise);
+						generate(assembler, ifNode->then);
+						assembler.jump(end);
+						assembler.bind(otherwise);
+						generate(assembler, ifNode->otherwise);
+						assembler.bind(end);
+						break;
+					}
+
+					case TermNode::Type::LET:
+					{
+						const auto letNode = static_cast<const LetNode*>(node);
+
+						generate(assembler, letNode->value);
+						assembler.storeFrame(getSlotOffset(scopeAnalysis.getLetSlot(letNode)));
+						generate(assembler, letNode->next);
+						break;
+					}
+
+					case TermNode::Type::CALL:
+					{
+						const auto callNode = static_cast<const CallNode*>(node);
+
+						for (const auto argument : callNode->arguments)
+						{
+							generate(assembler, argument);
+							assembler.pushResult();
+						}
+
+						assembler.call(*bodyLabel);
+
+						if (parameterCount)
+							assembler.dropStack(parameterCount * 8);
+
+						break;
+					}
+
+					default:
+						assert(false);
+						break;
+				}
+			}
+
+		private:
+			const ScopeAnalysis& scopeAnalysis;
+			const FnNode* const node;
+			const Scope& scope;
+			const unsigned parameterCount;
+			unsigned calls = 0;
+			unsigned bailOuts = 0;
+			bool disabled = false;
+			vector<NativeType> parameterTypes;
+			NativeType returnType = NativeType::INT;
+			vector<optional<NativeType>> localTypes;
+			vector<bool> assigned;
+			optional<VarSlot> selfSlot;
+			X86Assembler::Label* bodyLabel = nullptr;
+			X86Assembler::Label* bailOutLabel = nullptr;
+			void* code = nullptr;
+			size_t codeSize = 0;
+			NativeEntry entry = nullptr;
+		};
+	}  // namespace
+
+	void JitCompiler::attach(ClosureProgram& program)
+	{
+		for (auto& [fnNode, function] : program.functions)
+		{
+			const auto scope = function.scope;
+
+			if (!scope->capturing && scope->resetSlots.empty() && scope->getParameterCount() <= MAX_PARAMETERS)
+				function.native = make_unique<JitFunction>(*program.scopeAnalysis, fnNode);
+		}
+	}
+#else
+	void JitCompiler::attach(ClosureProgram& program)
+	{
+	}
+#endif
+}  // namespace rinha::interpreter
@@ -0,0 +1,17 @@
+#ifndef RINHA_INTERPRETER_JIT_COMPILER_H
+#define RINHA_INTERPRETER_JIT_COMPILER_H
+
+#include "./ClosureCompiler.h"
+
+namespace rinha::interpreter
+{
+	class JitCompiler final
+	{
+	public:
+		// Attaches lazily compiled x86-64 code to the functions of the program that may run natively.
+		// Does nothing on other architectures.
+		static void attach(ClosureProgram& program);
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_JIT_COMPILER_H
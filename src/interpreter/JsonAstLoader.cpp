@@ -0,0 +1,765 @@
+#include "./JsonAstLoader.h"
+#include "./Diagnostic.h"
+#include "./MappedFile.h"
+#include "./NodeArena.h"
+#include "./Nodes.h"
+#include "./ParsedSource.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// filesystem
+namespace fs = std::filesystem;
+
+// string
+using std::string;
+
+// string_view
+using std::string_view;
+
+// vector
+using std::vector;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		struct JsonError final
+		{
+			std::size_t offset;
+			string message;
+		};
+
+		// Tokens of the JSON text. Strings without escapes are returned as views of the text.
+		class JsonReader final
+		{
+		public:
+			explicit JsonReader(string_view json)
+				: json(json)
+			{
+			}
+
+		public:
+			char peek()
+			{
+				skipWhitespace();
+				return offset < json.size() ? json[offset] : '\0';
+			}
+
+			bool consume(char c)
+			{
+				if (peek() != c)
+					return false;
+
+				++offset;
+				return true;
+			}
+
+			void expect(char c)
+			{
+				if (!consume(c))
+					throw error(string("expected '") + c + "'");
+			}
+
+			void expectEnd()
+			{
+				if (peek() != '\0' || offset != json.size())
+					throw error("unexpected data after the AST");
+			}
+
+			// The result is valid until the next call.
+			string_view readString()
+			{
+				expect('"');
+
+				const auto start = offset;
+				offset = json.find_first_of("\"\\", offset);
+
+				if (offset == string_view::npos)
+				{
+					offset = json.size();
+					throw error("unterminated string");
+				}
+
+				if (json[offset] == '"')
+					return json.substr(start, offset++ - start);
+
+				decoded.assign(json.substr(start, offset - start));
+
+				while (true)
+				{
+					if (offset == json.size())
+						throw error("unterminated string");
+
+					const auto c = json[offset++];
+
+					if (c == '"')
+						return decoded;
+					else if (c == '\\')
+						readEscape();
+					else
+						decoded += c;
+				}
+			}
+
+			std::int32_t readInt()
+			{
+				skipWhitespace();
+
+				std::int32_t value;
+				const auto [end, ec] = std::from_chars(json.data() + offset, json.data() + json.size(), value);
+
+				if (ec != std::errc())
+					throw error("invalid integer");
+
+				offset = end - json.data();
+				return value;
+			}
+
+			bool readBool()
+			{
+				skipWhitespace();
+
+				if (json.substr(offset, 4) == "true")
+				{
+					offset += 4;
+					return true;
+				}
+				else if (json.substr(offset, 5) == "false")
+				{
+					offset += 5;
+					return false;
+				}
+
+				throw error("invalid value");
+			}
+
+			void skipValue()
+			{
+				unsigned depth = 0;
+
+				do
+				{
+					const auto c = peek();
+
+					switch (c)
+					{
+						case '{':
+						case '[':
+							++depth;
+							++offset;
+							break;
+
+						case '}':
+						case ']':
+						case ',':
+						case ':':
+							if (depth == 0)
+								throw error("expected a value");
+
+							if (c == '}' || c == ']')
+								--depth;
+
+							++offset;
+							break;
+
+						case '"':
+							readString();
+							break;
+
+						case '\0':
+							throw error("unexpected end");
+
+						default:
+						{
+							const auto end = json.find_first_of(",:]} \t\n\r", offset);
+							offset = end == string_view::npos ? json.size() : end;
+							break;
+						}
+					}
+				} while (depth > 0);
+			}
+
+			JsonError error(string&& message) const
+			{
+				return {offset, std::move(message)};
+			}
+
+		private:
+			void skipWhitespace()
+			{
+				while (offset < json.size() &&
+					(json[offset] == ' ' || json[offset] == '\n' || json[offset] == '\r' || json[offset] == '\t'))
+				{
+					++offset;
+				}
+			}
+
+			void readEscape()
+			{
+				if (offset == json.size())
+					throw error("unterminated string");
+
+				switch (const auto c = json[offset++])
+				{
+					case 'b':
+						decoded += '\b';
+						break;
+
+					case 'f':
+						decoded += '\f';
+						break;
+
+					case 'n':
+						decoded += '\n';
+						break;
+
+					case 'r':
+						decoded += '\r';
+						break;
+
+					case 't':
+						decoded += '\t';
+						break;
+
+					case 'u':
+					{
+						auto codePoint = readHex();
+
+						// A surrogate pair. Surrogates out of one aren't characters.
+						if (codePoint >= 0xD800 && codePoint < 0xDC00)
+						{
+							if (json.substr(offset, 2) != "\\u")
+								throw error("invalid unicode escape");
+
+							offset += 2;
+							const auto lowSurrogate = readHex();
+
+							if (lowSurrogate < 0xDC00 || lowSurrogate > 0xDFFF)
+								throw error("invalid unicode escape");
+
+							codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+						}
+						else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+							throw error("invalid unicode escape");
+
+						appendUtf8(codePoint);
+						break;
+					}
+
+					default:
+						decoded += c;
+						break;
+				}
+			}
+
+			char32_t readHex()
+			{
+				unsigned value;
+				const auto begin = json.data() + offset;
+				const auto [end, ec] = std::from_chars(begin, begin + std::min<std::size_t>(4, json.size() - offset),
+					value, 16);
+
+				if (ec != std::errc() || end != begin + 4)
+					throw error("invalid unicode escape");
+
+				offset += 4;
+				return value;
+			}
+
+			void appendUtf8(char32_t codePoint)
+			{
+				if (codePoint < 0x80)
+					decoded += char(codePoint);
+				else if (codePoint < 0x800)
+				{
+					decoded += char(0xC0 | (codePoint >> 6));
+					decoded += char(0x80 | (codePoint & 0x3F));
+				}
+				else if (codePoint < 0x10000)
+				{
+					decoded += char(0xE0 | (codePoint >> 12));
+					decoded += char(0x80 | ((codePoint >> 6) & 0x3F));
+					decoded += char(0x80 | (codePoint & 0x3F));
+				}
+				else
+				{
+					decoded += char(0xF0 | (codePoint >> 18));
+					decoded += char(0x80 | ((codePoint >> 12) & 0x3F));
+					decoded += char(0x80 | ((codePoint >> 6) & 0x3F));
+					decoded += char(0x80 | (codePoint & 0x3F));
+				}
+			}
+
+		private:
+			const string_view json;
+			std::size_t offset = 0;
+			string decoded;
+		};
+
+		// Builds nodes as their objects close, as members may come in any order. Each open object is a Frame.
+		class AstBuilder final
+		{
+		private:
+			// Where a finished object goes in its parent.
+			enum class Slot : uint8_t
+			{
+				EXPRESSION,
+				CALLEE,
+				LHS,
+				RHS,
+				FIRST,
+				SECOND,
+				CONDITION,
+				THEN,
+				OTHERWISE,
+				VALUE,
+				NEXT,
+				NAME,
+				ARGUMENT,
+				PARAMETER
+			};
+
+			static constexpr std::size_t TERM_SLOT_COUNT = std::size_t(Slot::NEXT) + 1;
+
+			enum class FrameType : uint8_t
+			{
+				FILE,
+				TERM,
+				PARAMETER
+			};
+
+			struct Frame final
+			{
+				FrameType type;
+				Slot slot;
+				string kind;
+				string text;
+				string op;
+				std::optional<Value> literal;
+				std::array<const TermNode*, TERM_SLOT_COUNT> terms{};
+				const ReferenceNode* name = nullptr;
+				// Slot of the elements of the array being read, ARGUMENT or PARAMETER.
+				Slot array = Slot::EXPRESSION;
+				// Sizes of `terms` and `references` when the object started, so its elements are those above them.
+				std::size_t termsStart = 0;
+				std::size_t referencesStart = 0;
+				bool hasArguments = false;
+				bool hasParameters = false;
+			};
+
+			// What to read next.
+			enum class Step : uint8_t
+			{
+				MEMBERS,
+				AFTER_MEMBER,
+				AFTER_ELEMENT,
+				DONE
+			};
+
+		public:
+			explicit AstBuilder(string_view json)
+				: reader(json)
+			{
+			}
+
+		public:
+			const TermNode* build()
+			{
+				reader.expect('{');
+				frames.push_back({FrameType::FILE, Slot::EXPRESSION});
+
+				for (auto step = Step::MEMBERS; step != Step::DONE;)
+				{
+					switch (step)
+					{
+						case Step::MEMBERS:
+							step = reader.consume('}') ? finish() : readMember();
+							break;
+
+						case Step::AFTER_MEMBER:
+							if (reader.consume(','))
+								step = readMember();
+							else
+							{
+								reader.expect('}');
+								step = finish();
+							}
+
+							break;
+
+						case Step::AFTER_ELEMENT:
+							if (reader.consume(','))
+								step = startElement();
+							else
+							{
+								reader.expect(']');
+								step = Step::AFTER_MEMBER;
+							}
+
+							break;
+
+						case Step::DONE:
+							break;
+					}
+				}
+
+				reader.expectEnd();
+
+				return root;
+			}
+
+			JsonError error(string&& message) const
+			{
+				return reader.error(std::move(message));
+			}
+
+		public:
+			NodeArena arena;
+
+		private:
+			Step readMember()
+			{
+				const auto key = reader.readString();
+				reader.expect(':');
+
+				auto& frame = frames.back();
+
+				switch (frame.type)
+				{
+					case FrameType::FILE:
+						if (key == "expression")
+							return startObject(FrameType::TERM, Slot::EXPRESSION);
+
+						break;
+
+					case FrameType::PARAMETER:
+						if (key == "text")
+						{
+							frame.text = reader.readString();
+							return Step::AFTER_MEMBER;
+						}
+
+						break;
+
+					case FrameType::TERM:
+						if (key == "kind")
+							frame.kind = reader.readString();
+						else if (key == "text")
+							frame.text = reader.readString();
+						else if (key == "op")
+							frame.op = reader.readString();
+						else if (key == "value")
+						{
+							switch (reader.peek())
+							{
+								case '{':
+									return startObject(FrameType::TERM, Slot::VALUE);
+
+								case '"':
+									frame.literal = StrValue(string(reader.readString()));
+									break;
+
+								case 't':
+								case 'f':
+									frame.literal = BoolValue(reader.readBool());
+									break;
+
+								default:
+									frame.literal = IntValue(reader.readInt());
+									break;
+							}
+						}
+						else if (key == "name")
+							return startObject(FrameType::PARAMETER, Slot::NAME);
+						else if (key == "arguments")
+							return startArray(Slot::ARGUMENT, frame.hasArguments, key);
+						else if (key == "parameters")
+							return startArray(Slot::PARAMETER, frame.hasParameters, key);
+						else if (const auto slot = getTermSlot(key))
+							return startObject(FrameType::TERM, slot.value());
+						else
+							break;
+
+						return Step::AFTER_MEMBER;
+				}
+
+				reader.skipValue();
+				return Step::AFTER_MEMBER;
+			}
+
+			Step startObject(FrameType type, Slot slot)
+			{
+				reader.expect('{');
+
+				frames.push_back({type, slot});
+
+				auto& frame = frames.back();
+				frame.termsStart = terms.size();
+				frame.referencesStart = references.size();
+
+				return Step::MEMBERS;
+			}
+
+			Step startArray(Slot array, bool& seen, string_view key)
+			{
+				if (seen)
+					throw error("duplicate '" + string(key) + "'");
+
+				reader.expect('[');
+
+				seen = true;
+				frames.back().array = array;
+
+				return reader.consume(']') ? Step::AFTER_MEMBER : startElement();
+			}
+
+			Step startElement()
+			{
+				const auto array = frames.back().array;
+				return startObject(array == Slot::ARGUMENT ? FrameType::TERM : FrameType::PARAMETER, array);
+			}
+
+			// Builds the node of the innermost object and passes it to its parent.
+			Step finish()
+			{
+				auto& frame = frames.back();
+				const auto slot = frame.slot;
+
+				switch (frame.type)
+				{
+					case FrameType::FILE:
+						root = require(frame, Slot::EXPRESSION);
+						frames.pop_back();
+						return Step::DONE;
+
+					case FrameType::PARAMETER:
+					{
+						const auto reference = arena.make<ReferenceNode>(std::move(frame.text));
+						frames.pop_back();
+
+						if (slot == Slot::PARAMETER)
+						{
+							references.push_back(reference);
+							return Step::AFTER_ELEMENT;
+						}
+
+						frames.back().name = reference;
+						return Step::AFTER_MEMBER;
+					}
+
+					case FrameType::TERM:
+					{
+						const auto term = makeTerm(frame);
+						frames.pop_back();
+
+						if (slot == Slot::ARGUMENT)
+						{
+							terms.push_back(term);
+							return Step::AFTER_ELEMENT;
+						}
+
+						frames.back().terms[std::size_t(slot)] = term;
+						return Step::AFTER_MEMBER;
+					}
+				}
+
+				return Step::DONE;
+			}
+
+			const TermNode* makeTerm(Frame& frame)
+			{
+				const auto& kind = frame.kind;
+
+				// Elements of arrays of other kinds would be taken by the enclosing Call or Function.
+				if (frame.hasArguments != (kind == "Call"))
+					throw error((frame.hasArguments ? "unexpected" : "missing") + string(" 'arguments' in ") + kind);
+
+				if (frame.hasParameters != (kind == "Function"))
+					throw error((frame.hasParameters ? "unexpected" : "missing") + string(" 'parameters' in ") + kind);
+
+				if (kind == "Int" || kind == "Str" || kind == "Bool")
+				{
+					if (!frame.literal ||
+						(kind == "Int" && !std::holds_alternative<IntValue>(frame.literal.value())) ||
+						(kind == "Str" && !std::holds_alternative<StrValue>(frame.literal.value())) ||
+						(kind == "Bool" && !std::holds_alternative<BoolValue>(frame.literal.value())))
+					{
+						throw error("invalid value in " + kind);
+					}
+
+					return arena.make<LiteralNode>(std::move(frame.literal.value()));
+				}
+				else if (kind == "Var")
+					return arena.make<VarNode>(arena.make<ReferenceNode>(std::move(frame.text)));
+				else if (kind == "Tuple")
+					return arena.make<TupleNode>(require(frame, Slot::FIRST), require(frame, Slot::SECOND));
+				else if (kind == "Call")
+				{
+					const auto arguments = arena.makeArray<const TermNode*>(
+						std::span(terms).subspan(frame.termsStart));
+					terms.resize(frame.termsStart);
+
+					return arena.make<CallNode>(require(frame, Slot::CALLEE), arguments);
+				}
+				else if (kind == "Binary")
+				{
+					return arena.make<BinaryOpNode>(
+						getOp(frame.op), require(frame, Slot::LHS), require(frame, Slot::RHS));
+				}
+				else if (kind == "Function")
+				{
+					const auto parameters = arena.makeArray<const ReferenceNode*>(
+						std::span(references).subspan(frame.referencesStart));
+					references.resize(frame.referencesStart);
+
+					return arena.make<FnNode>(parameters, require(frame, Slot::VALUE));
+				}
+				else if (kind == "Let")
+				{
+					if (!frame.name)
+						throw error("missing 'name' in Let");
+
+					return arena.make<LetNode>(frame.name, require(frame, Slot::VALUE), require(frame, Slot::NEXT));
+				}
+				else if (kind == "If")
+				{
+					return arena.make<IfNode>(require(frame, Slot::CONDITION), require(frame, Slot::THEN),
+						require(frame, Slot::OTHERWISE));
+				}
+				else if (kind == "Print")
+					return arena.make<PrintNode>(require(frame, Slot::VALUE));
+				else if (kind == "First" || kind == "Second")
+					return arena.make<TupleIndexNode>(require(frame, Slot::VALUE), kind == "First" ? 0 : 1);
+				else
+					throw error("unknown kind '" + kind + "'");
+			}
+
+			const TermNode* require(const Frame& frame, Slot slot) const
+			{
+				if (const auto term = frame.terms[std::size_t(slot)])
+					return term;
+
+				throw error("missing term in " + (frame.type == FrameType::FILE ? string("file") : frame.kind));
+			}
+
+			BinaryOpNode::Op getOp(string_view op) const
+			{
+				constexpr std::pair<string_view, BinaryOpNode::Op> OPS[] = {
+					{"Add", BinaryOpNode::Op::ADD},
+					{"Sub", BinaryOpNode::Op::SUB},
+					{"Mul", BinaryOpNode::Op::MUL},
+					{"Div", BinaryOpNode::Op::DIV},
+					{"Rem", BinaryOpNode::Op::REM},
+					{"Eq", BinaryOpNode::Op::EQ},
+					{"Neq", BinaryOpNode::Op::NEQ},
+					{"Lt", BinaryOpNode::Op::LT},
+					{"Gt", BinaryOpNode::Op::GT},
+					{"Lte", BinaryOpNode::Op::LTE},
+					{"Gte", BinaryOpNode::Op::GTE},
+					{"And", BinaryOpNode::Op::AND},
+					{"Or", BinaryOpNode::Op::OR},
+				};
+
+				for (const auto& [name, value] : OPS)
+				{
+					if (op == name)
+						return value;
+				}
+
+				throw error("unknown op '" + string(op) + "'");
+			}
+
+			static std::optional<Slot> getTermSlot(string_view key)
+			{
+				constexpr std::pair<string_view, Slot> SLOTS[] = {
+					{"callee", Slot::CALLEE},
+					{"lhs", Slot::LHS},
+					{"rhs", Slot::RHS},
+					{"first", Slot::FIRST},
+					{"second", Slot::SECOND},
+					{"condition", Slot::CONDITION},
+					{"then", Slot::THEN},
+					{"otherwise", Slot::OTHERWISE},
+					{"next", Slot::NEXT},
+				};
+
+				for (const auto& [name, slot] : SLOTS)
+				{
+					if (key == name)
+						return slot;
+				}
+
+				return std::nullopt;
+			}
+
+		private:
+			JsonReader reader;
+			vector<Frame> frames;
+			// Elements of the arrays being read, innermost last.
+			vector<const TermNode*> terms;
+			vector<const ReferenceNode*> references;
+			const TermNode* root = nullptr;
+		};
+
+		SourcePosition getPosition(string_view json, std::size_t offset)
+		{
+			SourcePosition position{1, 1};
+
+			for (std::size_t i = 0; i < offset && i < json.size(); ++i)
+			{
+				if (json[i] == '\n')
+				{
+					++position.line;
+					position.column = 1;
+				}
+				else
+					++position.column;
+			}
+
+			return position;
+		}
+	}  // namespace
+
+	JsonAstLoader::JsonAstLoader(string_view json)
+		: diagnostics(make_local_shared<Diagnostics>())
+	{
+		AstBuilder builder(json);
+		const TermNode* rootTerm = nullptr;
+
+		try
+		{
+			rootTerm = builder.build();
+		}
+		catch (const JsonError& error)
+		{
+			const auto position = getPosition(json, error.offset);
+			diagnostics->add({Diagnostic::Type::ERROR, position.line, position.column, error.message});
+		}
+
+		parsedSource = make_local_shared<ParsedSource>(rootTerm, std::move(builder.arena), SourcePositions());
+	}
+
+	JsonAstLoader JsonAstLoader::fromFile(const fs::path& file)
+	{
+		const MappedFile mappedFile(file);
+		return JsonAstLoader(mappedFile.getData());
+	}
+}  // namespace rinha::interpreter
@@ -0,0 +1,42 @@
+#ifndef RINHA_INTERPRETER_JSON_AST_LOADER_H
+#define RINHA_INTERPRETER_JSON_AST_LOADER_H
+
+#include "./Diagnostic.h"
+#include "./ParsedSource.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <filesystem>
+#include <string_view>
+
+namespace rinha::interpreter
+{
+	// Builds the AST from the JSON format of the official Rinha tooling ({"name", "expression", "location"}) in a
+	// single pass, without a document tree. Nesting is tracked in an explicit stack, so deep ASTs don't use the native
+	// stack. Locations are byte offsets in a source that isn't available, so nodes have no positions.
+	class JsonAstLoader final
+	{
+	public:
+		// The JSON is only read during construction.
+		explicit JsonAstLoader(std::string_view json);
+
+		// Maps the file instead of reading it.
+		static JsonAstLoader fromFile(const std::filesystem::path& file);
+
+	public:
+		auto getParsedSource() const
+		{
+			return parsedSource;
+		}
+
+		// Errors are positioned in the JSON text.
+		auto getDiagnostics() const
+		{
+			return diagnostics;
+		}
+
+	private:
+		boost::local_shared_ptr<ParsedSource> parsedSource;
+		boost::local_shared_ptr<Diagnostics> diagnostics;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_JSON_AST_LOADER_H
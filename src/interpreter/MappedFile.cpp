@@ -0,0 +1,57 @@
+#include "./MappedFile.h"
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// filesystem
+namespace fs = std::filesystem;
+
+// stdexcept
+using std::runtime_error;
+
+
+namespace rinha::interpreter
+{
+	MappedFile::MappedFile(const fs::path& file)
+	{
+		const auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (fd < 0)
+			throw runtime_error("Cannot open " + file.string());
+
+		struct stat fileStat;
+
+		if (fstat(fd, &fileStat) != 0)
+		{
+			close(fd);
+			throw runtime_error("Cannot open " + file.string());
+		}
+
+		size = std::size_t(fileStat.st_size);
+
+		if (size != 0)
+		{
+			address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (address == MAP_FAILED)
+			{
+				close(fd);
+				throw runtime_error("Cannot map " + file.string());
+			}
+
+			madvise(address, size, MADV_SEQUENTIAL);
+		}
+
+		close(fd);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (address)
+			munmap(address, size);
+	}
+}  // namespace rinha::interpreter
@@ -0,0 +1,33 @@
+#ifndef RINHA_INTERPRETER_MAPPED_FILE_H
+#define RINHA_INTERPRETER_MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace rinha::interpreter
+{
+	// Read-only view of a whole file, mapped into memory for as long as the object lives.
+	class MappedFile final
+	{
+	public:
+		explicit MappedFile(const std::filesystem::path& file);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+	public:
+		std::string_view getData() const noexcept
+		{
+			return {static_cast<const char*>(address), size};
+		}
+
+	private:
+		// Null for an empty file.
+		void* address = nullptr;
+		std::size_t size = 0;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_MAPPED_FILE_H
@@ -0,0 +1,763 @@
+#include "./NativeParser.h"
+#include "./Diagnostic.h"
+#include "./Exceptions.h"
+#include "./MappedFile.h"
+#include "./NodeArena.h"
+#include "./Nodes.h"
+#include "./ParsedSource.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// filesystem
+namespace fs = std::filesystem;
+
+// string
+using std::string;
+
+// string_view
+using std::string_view;
+
+// vector
+using std::vector;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		enum class TokenType : uint8_t
+		{
+			END,
+			IDENTIFIER,
+			INT,
+			STRING,
+			ELSE,
+			FALSE,
+			FIRST,
+			FN,
+			IF,
+			LET,
+			PRINT,
+			SECOND,
+			TRUE,
+			OPEN_PAREN,
+			CLOSE_PAREN,
+			OPEN_BRACE,
+			CLOSE_BRACE,
+			COMMA,
+			SEMICOLON,
+			ASSIGN,
+			ARROW,
+			OPERATOR
+		};
+
+		struct Token final
+		{
+			TokenType type;
+			// For OPERATOR.
+			BinaryOpNode::Op op;
+			string_view text;
+			SourcePosition position;
+		};
+
+		struct SyntaxError final
+		{
+			SourcePosition position;
+			string message;
+		};
+
+		constexpr std::pair<string_view, TokenType> KEYWORDS[] = {
+			{"else", TokenType::ELSE},
+			{"false", TokenType::FALSE},
+			{"first", TokenType::FIRST},
+			{"fn", TokenType::FN},
+			{"if", TokenType::IF},
+			{"let", TokenType::LET},
+			{"print", TokenType::PRINT},
+			{"second", TokenType::SECOND},
+			{"true", TokenType::TRUE},
+		};
+
+		// Precedence of the grammar's logical, conjunction, equality, comparison, arithmetic and factor rules.
+		unsigned getPrecedence(BinaryOpNode::Op op)
+		{
+			switch (op)
+			{
+				case BinaryOpNode::Op::OR:
+					return 0;
+
+				case BinaryOpNode::Op::AND:
+					return 1;
+
+				case BinaryOpNode::Op::EQ:
+				case BinaryOpNode::Op::NEQ:
+					return 2;
+
+				case BinaryOpNode::Op::LT:
+				case BinaryOpNode::Op::GT:
+				case BinaryOpNode::Op::LTE:
+				case BinaryOpNode::Op::GTE:
+					return 3;
+
+				case BinaryOpNode::Op::ADD:
+				case BinaryOpNode::Op::SUB:
+					return 4;
+
+				case BinaryOpNode::Op::MUL:
+				case BinaryOpNode::Op::DIV:
+				case BinaryOpNode::Op::REM:
+					return 5;
+			}
+
+			return 0;
+		}
+
+		// Tokens of Rinha.g4's lexer rules, produced on demand. Unrecognized input is reported and skipped, as ANTLR
+		// does. Columns count code points.
+		class Lexer final
+		{
+		public:
+			explicit Lexer(string_view source, Diagnostics& diagnostics)
+				: source(source),
+				  diagnostics(diagnostics)
+			{
+			}
+
+		public:
+			Token next()
+			{
+				while (true)
+				{
+					skipSpaceAndComments();
+
+					if (offset == source.size())
+						return {TokenType::END, {}, "<EOF>", getPosition()};
+
+					if (const auto token = lexToken())
+						return token.value();
+				}
+			}
+
+		private:
+			void skipSpaceAndComments()
+			{
+				while (offset < source.size())
+				{
+					const auto c = source[offset];
+
+					if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+						advance(1);
+					else if (source.substr(offset, 2) == "//")
+					{
+						const auto end = source.find_first_of("\r\n", offset);
+						advance((end == string_view::npos ? source.size() : end) - offset);
+					}
+					else if (source.substr(offset, 2) == "/*")
+					{
+						const auto end = source.find("*/", offset + 2);
+
+						// Without an end, it's lexed as operators.
+						if (end == string_view::npos)
+							return;
+
+						advance(end + 2 - offset);
+					}
+					else
+						return;
+				}
+			}
+
+			std::optional<Token> lexToken()
+			{
+				const auto c = source[offset];
+				const auto position = getPosition();
+				const auto start = offset;
+
+				if (isIdentifierStart(c))
+				{
+					auto end = offset + 1;
+
+					while (end < source.size() && isIdentifierPart(source[end]))
+						++end;
+
+					const auto text = source.substr(start, end - start);
+					advance(end - start);
+
+					if (text == "{")
+						return Token{TokenType::OPEN_BRACE, {}, text, position};
+					else if (text == "}")
+						return Token{TokenType::CLOSE_BRACE, {}, text, position};
+
+					for (const auto& [keyword, type] : KEYWORDS)
+					{
+						if (text == keyword)
+							return Token{type, {}, text, position};
+					}
+
+					return Token{TokenType::IDENTIFIER, {}, text, position};
+				}
+
+				if (c == '_')
+				{
+					advance(1);
+					return Token{TokenType::IDENTIFIER, {}, source.substr(start, 1), position};
+				}
+
+				if (c >= '0' && c <= '9')
+				{
+					auto end = offset + 1;
+
+					while (end < source.size() && source[end] >= '0' && source[end] <= '9')
+						++end;
+
+					advance(end - start);
+					return Token{TokenType::INT, {}, source.substr(start, end - start), position};
+				}
+
+				if (c == '"')
+				{
+					auto end = offset + 1;
+
+					while (end < source.size() && source[end] != '"')
+					{
+						if (source[end] != '\\')
+							++end;
+						else if (end + 1 < source.size() && (source[end + 1] == '"' || source[end + 1] == '\\'))
+							end += 2;
+						else
+							break;
+					}
+
+					if (end < source.size() && source[end] == '"')
+					{
+						advance(end + 1 - start);
+						return Token{TokenType::STRING, {}, source.substr(start, end + 1 - start), position};
+					}
+
+					return recognitionError(position, source.substr(start, end - start + (end < source.size())));
+				}
+
+				const auto next = offset + 1 < source.size() ? source[offset + 1] : '\0';
+
+				switch (c)
+				{
+					case '(':
+						return symbol(TokenType::OPEN_PAREN, position, 1);
+
+					case ')':
+						return symbol(TokenType::CLOSE_PAREN, position, 1);
+
+					case ',':
+						return symbol(TokenType::COMMA, position, 1);
+
+					case ';':
+						return symbol(TokenType::SEMICOLON, position, 1);
+
+					case '=':
+						if (next == '=')
+							return op(BinaryOpNode::Op::EQ, position, 2);
+						else if (next == '>')
+							return symbol(TokenType::ARROW, position, 2);
+						else
+							return symbol(TokenType::ASSIGN, position, 1);
+
+					case '!':
+						if (next == '=')
+							return op(BinaryOpNode::Op::NEQ, position, 2);
+
+						break;
+
+					case '&':
+						if (next == '&')
+							return op(BinaryOpNode::Op::AND, position, 2);
+
+						break;
+
+					case '|':
+						if (next == '|')
+							return op(BinaryOpNode::Op::OR, position, 2);
+
+						break;
+
+					case '<':
+						if (next == '=')
+							return op(BinaryOpNode::Op::LTE, position, 2);
+						else
+							return op(BinaryOpNode::Op::LT, position, 1);
+
+					case '>':
+						if (next == '=')
+							return op(BinaryOpNode::Op::GTE, position, 2);
+						else
+							return op(BinaryOpNode::Op::GT, position, 1);
+
+					case '+':
+						return op(BinaryOpNode::Op::ADD, position, 1);
+
+					case '-':
+						return op(BinaryOpNode::Op::SUB, position, 1);
+
+					case '*':
+						return op(BinaryOpNode::Op::MUL, position, 1);
+
+					case '/':
+						return op(BinaryOpNode::Op::DIV, position, 1);
+
+					case '%':
+						return op(BinaryOpNode::Op::REM, position, 1);
+				}
+
+				return recognitionError(position, source.substr(start, 1));
+			}
+
+			Token symbol(TokenType type, SourcePosition position, std::size_t length)
+			{
+				const auto text = source.substr(offset, length);
+				advance(length);
+				return {type, {}, text, position};
+			}
+
+			Token op(BinaryOpNode::Op op, SourcePosition position, std::size_t length)
+			{
+				const auto text = source.substr(offset, length);
+				advance(length);
+				return {TokenType::OPERATOR, op, text, position};
+			}
+
+			// Reports the text and skips its first character.
+			std::optional<Token> recognitionError(SourcePosition position, string_view text)
+			{
+				diagnostics.add({Diagnostic::Type::ERROR, position.line, position.column,
+					"token recognition error at: '" + string(text) + "'"});
+				advance(1);
+				return std::nullopt;
+			}
+
+			void advance(std::size_t count)
+			{
+				for (const auto end = offset + count; offset < end; ++offset)
+				{
+					const auto c = (unsigned char) source[offset];
+
+					if (c == '\n')
+					{
+						++line;
+						column = 0;
+					}
+					else if ((c & 0xC0) != 0x80)
+						++column;
+				}
+			}
+
+			SourcePosition getPosition() const
+			{
+				return {line, column + 1};
+			}
+
+			static bool isIdentifierStart(char c)
+			{
+				return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '{' || c == '}';
+			}
+
+			static bool isIdentifierPart(char c)
+			{
+				return isIdentifierStart(c) || (c >= '0' && c <= '9') || c == '_';
+			}
+
+		private:
+			const string_view source;
+			Diagnostics& diagnostics;
+			std::size_t offset = 0;
+			unsigned line = 1;
+			unsigned column = 0;
+		};
+
+		// Recursive descent for terms, and operator precedence for the left-associative binary operators. Chains of
+		// lets and operators are built iteratively, so only nesting uses the native stack.
+		class RecursiveDescentParser final
+		{
+		private:
+			struct Operand final
+			{
+				const TermNode* node;
+				SourcePosition position;
+			};
+
+			struct Operator final
+			{
+				BinaryOpNode::Op op;
+				unsigned precedence;
+			};
+
+			struct PendingLet final
+			{
+				SourcePosition position;
+				const ReferenceNode* reference;
+				const TermNode* value;
+			};
+
+		public:
+			explicit RecursiveDescentParser(string_view source, Diagnostics& diagnostics)
+				: lexer(source, diagnostics),
+				  token(lexer.next())
+			{
+			}
+
+		public:
+			const TermNode* parseRoot()
+			{
+				const auto term = parseTerm();
+
+				if (token.type != TokenType::END)
+					throw error("extraneous input '" + string(token.text) + "' expecting <EOF>");
+
+				return term;
+			}
+
+		public:
+			NodeArena arena;
+			SourcePositions positions;
+
+		private:
+			const TermNode* parseTerm()
+			{
+				const auto position = token.position;
+
+				switch (token.type)
+				{
+					case TokenType::OPEN_PAREN:
+					{
+						consume();
+						const auto first = parseTerm();
+
+						if (token.type == TokenType::COMMA)
+						{
+							consume();
+							const auto second = parseTerm();
+							expect(TokenType::CLOSE_PAREN, ")");
+
+							return make<TupleNode>(position, first, second);
+						}
+
+						expect(TokenType::CLOSE_PAREN, ")");
+
+						return parseOperators(parseApply({first, position}));
+					}
+
+					case TokenType::LET:
+					{
+						vector<PendingLet> lets;
+
+						do
+						{
+							const auto letPosition = token.position;
+							consume();
+							const auto reference = parseReference();
+							expect(TokenType::ASSIGN, "=");
+							const auto value = parseTerm();
+							expect(TokenType::SEMICOLON, ";");
+
+							lets.push_back({letPosition, reference, value});
+						} while (token.type == TokenType::LET);
+
+						auto next = parseTerm();
+
+						for (auto it = lets.rbegin(); it != lets.rend(); ++it)
+							next = make<LetNode>(it->position, it->reference, it->value, next);
+
+						return next;
+					}
+
+					case TokenType::IF:
+					{
+						consume();
+						expect(TokenType::OPEN_PAREN, "(");
+						const auto condition = parseTerm();
+						expect(TokenType::CLOSE_PAREN, ")");
+						expect(TokenType::OPEN_BRACE, "{");
+						const auto then = parseTerm();
+						expect(TokenType::CLOSE_BRACE, "}");
+						expect(TokenType::ELSE, "else");
+						expect(TokenType::OPEN_BRACE, "{");
+						const auto otherwise = parseTerm();
+						expect(TokenType::CLOSE_BRACE, "}");
+
+						return make<IfNode>(position, condition, then, otherwise);
+					}
+
+					case TokenType::FN:
+					{
+						consume();
+						expect(TokenType::OPEN_PAREN, "(");
+
+						vector<const ReferenceNode*> parameters;
+
+						if (token.type == TokenType::IDENTIFIER)
+							parameters.push_back(parseReference());
+
+						while (token.type == TokenType::COMMA)
+						{
+							consume();
+							parameters.push_back(parseReference());
+						}
+
+						expect(TokenType::CLOSE_PAREN, ")");
+						expect(TokenType::ARROW, "=>");
+						const auto body = parseTerm();
+
+						return make<FnNode>(position, arena.makeArray<const ReferenceNode*>(parameters), body);
+					}
+
+					case TokenType::OPEN_BRACE:
+					{
+						consume();
+						const auto term = parseTerm();
+						expect(TokenType::CLOSE_BRACE, "}");
+
+						return term;
+					}
+
+					default:
+						return parseOperators(parseApply(parsePrimary()));
+				}
+			}
+
+			// Shunting-yard over the operands that follow `first`. Operators of the same precedence are reduced
+			// before pushing the next one, so they group to the left.
+			const TermNode* parseOperators(Operand first)
+			{
+				vector<Operand> operands{first};
+				vector<Operator> operators;
+
+				while (token.type == TokenType::OPERATOR)
+				{
+					const Operator current{token.op, getPrecedence(token.op)};
+					consume();
+
+					while (!operators.empty() && operators.back().precedence >= current.precedence)
+						reduce(operands, operators);
+
+					operators.push_back(current);
+					operands.push_back(parseApply(parsePrimary()));
+				}
+
+				while (!operators.empty())
+					reduce(operands, operators);
+
+				return operands.back().node;
+			}
+
+			void reduce(vector<Operand>& operands, vector<Operator>& operators)
+			{
+				const auto second = operands.back();
+				operands.pop_back();
+				auto& first = operands.back();
+
+				first.node = make<BinaryOpNode>(first.position, operators.back().op, first.node, second.node);
+				operators.pop_back();
+			}
+
+			Operand parseApply(Operand callee)
+			{
+				while (token.type == TokenType::OPEN_PAREN)
+				{
+					consume();
+
+					vector<const TermNode*> arguments;
+
+					if (token.type != TokenType::COMMA && token.type != TokenType::CLOSE_PAREN)
+						arguments.push_back(parseTerm());
+
+					while (token.type == TokenType::COMMA)
+					{
+						consume();
+						arguments.push_back(parseTerm());
+					}
+
+					expect(TokenType::CLOSE_PAREN, ")");
+
+					callee.node =
+						make<CallNode>(callee.position, callee.node, arena.makeArray<const TermNode*>(arguments));
+				}
+
+				return callee;
+			}
+
+			Operand parsePrimary()
+			{
+				const auto position = token.position;
+
+				switch (token.type)
+				{
+					case TokenType::OPEN_PAREN:
+					{
+						consume();
+						const auto term = parseTerm();
+						expect(TokenType::CLOSE_PAREN, ")");
+
+						return {term, position};
+					}
+
+					case TokenType::TRUE:
+					case TokenType::FALSE:
+					{
+						const auto value = token.type == TokenType::TRUE;
+						consume();
+
+						return {make<LiteralNode>(position, BoolValue(value)), position};
+					}
+
+					case TokenType::INT:
+					{
+						const auto value = std::stoi(string(token.text));
+						consume();
+
+						return {make<LiteralNode>(position, IntValue(value)), position};
+					}
+
+					case TokenType::STRING:
+					{
+						string text;
+						text.reserve(token.text.size() - 2);
+
+						for (auto i = 1u; i < token.text.size() - 1; ++i)
+						{
+							if (token.text[i] == '\\')
+								++i;
+
+							text += token.text[i];
+						}
+
+						consume();
+
+						return {make<LiteralNode>(position, StrValue(std::move(text))), position};
+					}
+
+					case TokenType::IDENTIFIER:
+						return {make<VarNode>(position, parseReference()), position};
+
+					case TokenType::PRINT:
+					{
+						consume();
+						const auto arg = parseParenthesized();
+
+						return {make<PrintNode>(position, arg), position};
+					}
+
+					case TokenType::FIRST:
+					case TokenType::SECOND:
+					{
+						const auto index = token.type == TokenType::FIRST ? 0u : 1u;
+						consume();
+						const auto arg = parseParenthesized();
+
+						return {make<TupleIndexNode>(position, arg, index), position};
+					}
+
+					default:
+						throw error("no viable alternative at input '" + string(token.text) + "'");
+				}
+			}
+
+			const TermNode* parseParenthesized()
+			{
+				expect(TokenType::OPEN_PAREN, "(");
+				const auto term = parseTerm();
+				expect(TokenType::CLOSE_PAREN, ")");
+
+				return term;
+			}
+
+			const ReferenceNode* parseReference()
+			{
+				if (token.type != TokenType::IDENTIFIER)
+					throw error("mismatched input '" + string(token.text) + "' expecting TEXT");
+
+				const auto reference = make<ReferenceNode>(token.position, string(token.text));
+				consume();
+
+				return reference;
+			}
+
+			void expect(TokenType type, const char* text)
+			{
+				if (token.type != type)
+					throw error("mismatched input '" + string(token.text) + "' expecting '" + text + "'");
+
+				consume();
+			}
+
+			void consume()
+			{
+				token = lexer.next();
+			}
+
+			SyntaxError error(string&& message) const
+			{
+				return {token.position, std::move(message)};
+			}
+
+			template <typename T, typename... Args>
+			T* make(SourcePosition position, Args&&... args)
+			{
+				const auto node = arena.make<T>(std::forward<Args>(args)...);
+				positions.add(node, position);
+
+				return node;
+			}
+
+		private:
+			Lexer lexer;
+			Token token;
+		};
+	}  // namespace
+
+	NativeParser::NativeParser(string_view source)
+		: diagnostics(make_local_shared<Diagnostics>())
+	{
+		RecursiveDescentParser parser(source, *diagnostics);
+		const TermNode* rootTerm = nullptr;
+
+		try
+		{
+			rootTerm = parser.parseRoot();
+		}
+		catch (const SyntaxError& error)
+		{
+			diagnostics->add({Diagnostic::Type::ERROR, error.position.line, error.position.column, error.message});
+		}
+
+		parsedSource = make_local_shared<ParsedSource>(rootTerm, std::move(parser.arena), std::move(parser.positions));
+	}
+
+	NativeParser NativeParser::fromFile(const fs::path& file)
+	{
+		const MappedFile mappedFile(file);
+		return NativeParser(mappedFile.getData());
+	}
+
+	bool NativeParser::isSelected()
+	{
+		const auto env = std::getenv("RINHA_PARSER");
+
+		if (!env || strcmp(env, "native") == 0)
+			return true;
+		else if (strcmp(env, "antlr") == 0)
+			return false;
+		else
+			throw RinhaException("Unknown parser: " + string(env));
+	}
+}  // namespace rinha::interpreter
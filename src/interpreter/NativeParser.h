@@ -0,0 +1,43 @@
+#ifndef RINHA_INTERPRETER_NATIVE_PARSER_H
+#define RINHA_INTERPRETER_NATIVE_PARSER_H
+
+#include "./Diagnostic.h"
+#include "./ParsedSource.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <filesystem>
+#include <string_view>
+
+namespace rinha::interpreter
+{
+	// Hand-written lexer and parser for the language of Rinha.g4, building the same AST as Parser without the ANTLR
+	// runtime. It stops at the first syntax error; positions of diagnostics match ANTLR's, but not all messages do.
+	class NativeParser final
+	{
+	public:
+		// The source is only read during construction.
+		explicit NativeParser(std::string_view source);
+
+		// Maps the file instead of reading it.
+		static NativeParser fromFile(const std::filesystem::path& file);
+
+		// Whether RINHA_PARSER selects this parser ("native", the default) rather than ANTLR's ("antlr").
+		static bool isSelected();
+
+	public:
+		auto getParsedSource() const
+		{
+			return parsedSource;
+		}
+
+		auto getDiagnostics() const
+		{
+			return diagnostics;
+		}
+
+	private:
+		boost::local_shared_ptr<ParsedSource> parsedSource;
+		boost::local_shared_ptr<Diagnostics> diagnostics;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_NATIVE_PARSER_H
@@ -0,0 +1,95 @@
+#ifndef RINHA_INTERPRETER_NODE_ARENA_H
+#define RINHA_INTERPRETER_NODE_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rinha::interpreter
+{
+	// Owns the nodes of a program, allocated contiguously in the order they're created, so walking a tree touches few
+	// cache lines. Nodes are destroyed with the arena, never individually.
+	class NodeArena final
+	{
+	public:
+		static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+	public:
+		NodeArena() = default;
+
+		NodeArena(NodeArena&&) = default;
+		NodeArena& operator=(NodeArena&&) = delete;
+
+		NodeArena(const NodeArena&) = delete;
+		NodeArena& operator=(const NodeArena&) = delete;
+
+		~NodeArena()
+		{
+			for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+				it->destroy(it->object);
+		}
+
+	public:
+		template <typename T, typename... Args>
+		T* make(Args&&... args)
+		{
+			const auto object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+			if constexpr (!std::is_trivially_destructible_v<T>)
+				destructors.push_back({object, [](void* p) { static_cast<T*>(p)->~T(); }});
+
+			return object;
+		}
+
+		// Copies the items to the arena.
+		template <typename T>
+		requires std::is_trivially_copyable_v<T>
+		std::span<const T> makeArray(std::span<const T> items)
+		{
+			if (items.empty())
+				return {};
+
+			const auto array = static_cast<T*>(allocate(items.size_bytes(), alignof(T)));
+			std::copy(items.begin(), items.end(), array);
+
+			return {array, items.size()};
+		}
+
+	private:
+		struct Destructor final
+		{
+			void* object;
+			void (*destroy)(void*);
+		};
+
+	private:
+		void* allocate(std::size_t size, std::size_t alignment)
+		{
+			auto offset = (chunkUsed + alignment - 1) & ~(alignment - 1);
+
+			if (chunks.empty() || offset + size > chunkSize)
+			{
+				chunkSize = std::max(size, CHUNK_SIZE);
+				chunks.push_back(std::make_unique_for_overwrite<std::byte[]>(chunkSize));
+				offset = 0;
+			}
+
+			chunkUsed = offset + size;
+
+			return chunks.back().get() + offset;
+		}
+
+	private:
+		std::vector<std::unique_ptr<std::byte[]>> chunks;
+		std::size_t chunkSize = 0;
+		std::size_t chunkUsed = 0;
+		std::vector<Destructor> destructors;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_NODE_ARENA_H
@@ -8,6 +8,7 @@
 #include <boost/smart_ptr/local_shared_ptr.hpp>
 #include <boost/smart_ptr/make_local_shared.hpp>
 #include <optional>
+#include <span>
 #include <string>
 #include <type_traits>
 #include <unordered_set>
@@ -22,12 +23,9 @@ namespace rinha::interpreter
 	class TypedNode : public T
 	{
 	public:
-		using T::T;
-
-	public:
-		typename T::Type getType() const override
+		TypedNode()
+			: T(typeConst)
 		{
-			return typeConst;
 		}
 
 	public:
@@ -55,14 +53,10 @@ namespace rinha::interpreter
 		return fromNode && fromNode->getType() == To::TYPE;
 	}
 
+	// Nodes are allocated in a NodeArena and have no virtual functions, so they're kept small. Their positions are
+	// in the ParsedSource.
 	class Node
 	{
-	public:
-		virtual ~Node() = default;
-
-	public:
-		unsigned startLine = 0;
-		unsigned startColumn = 0;
 	};
 
 	class ReferenceNode final : public Node
@@ -94,9 +88,23 @@ namespace rinha::interpreter
 			PRINT
 		};
 
+	protected:
+		explicit TermNode(Type type) noexcept
+			: type(type)
+		{
+		}
+
 	public:
-		virtual Type getType() const = 0;
-		virtual void compile(boost::local_shared_ptr<Context> context) const = 0;
+		Type getType() const noexcept
+		{
+			return type;
+		}
+
+		// Dispatches to the compile method of the node type.
+		void compile(boost::local_shared_ptr<Context> context) const;
+
+	private:
+		const Type type;
 	};
 
 	class LiteralNode final : public TypedNode<TermNode, TermNode::Type::LITERAL>
@@ -108,7 +116,7 @@ namespace rinha::interpreter
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override { }
+		void compile(boost::local_shared_ptr<Context> context) const { }
 
 	public:
 		const Value value;
@@ -124,7 +132,7 @@ namespace rinha::interpreter
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override
+		void compile(boost::local_shared_ptr<Context> context) const
 		{
 			first->compile(context);
 			second->compile(context);
@@ -138,14 +146,14 @@ namespace rinha::interpreter
 	class FnNode final : public TypedNode<TermNode, TermNode::Type::FN>
 	{
 	public:
-		explicit FnNode(std::vector<const ReferenceNode*>&& parameters, const TermNode* body)
-			: parameters(std::move(parameters)),
+		explicit FnNode(std::span<const ReferenceNode* const> parameters, const TermNode* body)
+			: parameters(parameters),
 			  body(body)
 		{
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override
+		void compile(boost::local_shared_ptr<Context> context) const
 		{
 			std::unordered_set<std::string> set;
 
@@ -168,21 +176,22 @@ namespace rinha::interpreter
 		}
 
 	public:
-		const std::vector<const ReferenceNode*> parameters;
+		// Stored in the same arena as the node.
+		const std::span<const ReferenceNode* const> parameters;
 		const TermNode* const body;
 	};
 
 	class CallNode final : public TypedNode<TermNode, TermNode::Type::CALL>
 	{
 	public:
-		explicit CallNode(const TermNode* callee, std::vector<const TermNode*>&& arguments)
+		explicit CallNode(const TermNode* callee, std::span<const TermNode* const> arguments)
 			: callee(callee),
-			  arguments(std::move(arguments))
+			  arguments(arguments)
 		{
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override
+		void compile(boost::local_shared_ptr<Context> context) const
 		{
 			callee->compile(context);
 
@@ -192,7 +201,8 @@ namespace rinha::interpreter
 
 	public:
 		const TermNode* const callee;
-		const std::vector<const TermNode*> arguments;
+		// Stored in the same arena as the node.
+		const std::span<const TermNode* const> arguments;
 	};
 
 	class BinaryOpNode final : public TypedNode<TermNode, TermNode::Type::BINARY_OP>
@@ -224,7 +234,7 @@ namespace rinha::interpreter
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override
+		void compile(boost::local_shared_ptr<Context> context) const
 		{
 			first->compile(context);
 			second->compile(context);
@@ -247,7 +257,7 @@ namespace rinha::interpreter
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override
+		void compile(boost::local_shared_ptr<Context> context) const
 		{
 			condition->compile(context);
 			then->compile(context);
@@ -272,7 +282,7 @@ namespace rinha::interpreter
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override
+		void compile(boost::local_shared_ptr<Context> context) const
 		{
 			arg->compile(context);
 		}
@@ -291,7 +301,7 @@ namespace rinha::interpreter
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override { }
+		void compile(boost::local_shared_ptr<Context> context) const { }
 
 	public:
 		const ReferenceNode* reference;
@@ -308,7 +318,7 @@ namespace rinha::interpreter
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override
+		void compile(boost::local_shared_ptr<Context> context) const
 		{
 			context->createVariable(reference->name);
 
@@ -331,7 +341,7 @@ namespace rinha::interpreter
 		}
 
 	public:
-		void compile(boost::local_shared_ptr<Context> context) const override
+		void compile(boost::local_shared_ptr<Context> context) const
 		{
 			arg->compile(context);
 		}
@@ -339,6 +349,52 @@ namespace rinha::interpreter
 	public:
 		const TermNode* const arg;
 	};
+
+	inline void TermNode::compile(boost::local_shared_ptr<Context> context) const
+	{
+		switch (type)
+		{
+			case Type::LITERAL:
+				static_cast<const LiteralNode*>(this)->compile(std::move(context));
+				break;
+
+			case Type::TUPLE:
+				static_cast<const TupleNode*>(this)->compile(std::move(context));
+				break;
+
+			case Type::FN:
+				static_cast<const FnNode*>(this)->compile(std::move(context));
+				break;
+
+			case Type::CALL:
+				static_cast<const CallNode*>(this)->compile(std::move(context));
+				break;
+
+			case Type::BINARY_OP:
+				static_cast<const BinaryOpNode*>(this)->compile(std::move(context));
+				break;
+
+			case Type::IF:
+				static_cast<const IfNode*>(this)->compile(std::move(context));
+				break;
+
+			case Type::TUPLE_INDEX:
+				static_cast<const TupleIndexNode*>(this)->compile(std::move(context));
+				break;
+
+			case Type::VAR:
+				static_cast<const VarNode*>(this)->compile(std::move(context));
+				break;
+
+			case Type::LET:
+				static_cast<const LetNode*>(this)->compile(std::move(context));
+				break;
+
+			case Type::PRINT:
+				static_cast<const PrintNode*>(this)->compile(std::move(context));
+				break;
+		}
+	}
 }  // namespace rinha::interpreter
 
 #endif  // RINHA_INTERPRETER_NODES_H
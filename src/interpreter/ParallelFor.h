@@ -0,0 +1,56 @@
+#ifndef RINHA_INTERPRETER_PARALLEL_FOR_H
+#define RINHA_INTERPRETER_PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace rinha::interpreter
+{
+	// Calls work(chunk, start, end) for each chunk of chunkSize items of [0, count), taking chunks from up to
+	// threadCount threads, the calling one included. Once all chunks are done, the exception thrown by the first
+	// chunk that threw one is rethrown, so the result doesn't depend on the number of threads.
+	template <typename Work>
+	void parallelForChunks(std::size_t count, std::size_t chunkSize, unsigned threadCount, const Work& work)
+	{
+		const auto chunkCount = (count + chunkSize - 1) / chunkSize;
+		std::vector<std::exception_ptr> exceptions(chunkCount);
+		std::atomic<std::size_t> nextChunk = 0;
+
+		const auto run = [&]
+		{
+			for (std::size_t chunk; (chunk = nextChunk.fetch_add(1)) < chunkCount;)
+			{
+				try
+				{
+					work(chunk, chunk * chunkSize, std::min((chunk + 1) * chunkSize, count));
+				}
+				catch (...)
+				{
+					exceptions[chunk] = std::current_exception();
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+
+		for (std::size_t i = 1; i < std::min(std::size_t(threadCount), chunkCount); ++i)
+			threads.emplace_back(run);
+
+		run();
+
+		for (auto& thread : threads)
+			thread.join();
+
+		for (const auto& exception : exceptions)
+		{
+			if (exception)
+				std::rethrow_exception(exception);
+		}
+	}
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_PARALLEL_FOR_H
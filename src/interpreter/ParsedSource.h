@@ -1,20 +1,72 @@
 #ifndef RINHA_INTERPRETER_PARSED_SOURCE_H
 #define RINHA_INTERPRETER_PARSED_SOURCE_H
 
+#include "./NodeArena.h"
 #include <boost/smart_ptr/local_shared_ptr.hpp>
-#include <unordered_set>
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
 
 namespace rinha::interpreter
 {
 	class Node;
 	class TermNode;
 
+	struct SourcePosition final
+	{
+		unsigned line = 0;
+		unsigned column = 0;
+	};
+
+	// Where each node starts, kept apart from the nodes as it's only needed for reporting. Sorted on the first lookup,
+	// so building it costs nothing more than appending.
+	class SourcePositions final
+	{
+	public:
+		void add(const Node* node, SourcePosition position)
+		{
+			entries.emplace_back(node, position);
+			sorted = false;
+		}
+
+		const SourcePosition* find(const Node* node) const
+		{
+			if (!sorted)
+			{
+				std::ranges::sort(entries, {}, &Entry::first);
+				sorted = true;
+			}
+
+			const auto it = std::ranges::lower_bound(entries, node, {}, &Entry::first);
+			return it != entries.end() && it->first == node ? &it->second : nullptr;
+		}
+
+	private:
+		using Entry = std::pair<const Node*, SourcePosition>;
+
+	private:
+		mutable std::vector<Entry> entries;
+		mutable bool sorted = true;
+	};
+
 	class ParsedSource final
 	{
 	public:
-		ParsedSource(const TermNode* term, std::unordered_set<boost::local_shared_ptr<Node>>&& nodes)
+		// Another source whose nodes are part of this one, starting `lineOffset` lines further down.
+		struct Part final
+		{
+			boost::local_shared_ptr<const ParsedSource> source;
+			unsigned lineOffset;
+		};
+
+	public:
+		ParsedSource(const TermNode* term, NodeArena&& arena, SourcePositions&& positions,
+			std::vector<Part>&& parts = {})
 			: term(term),
-			  nodes(std::move(nodes))
+			  arena(std::move(arena)),
+			  positions(std::move(positions)),
+			  parts(std::move(parts))
 		{
 		}
 
@@ -24,9 +76,28 @@ namespace rinha::interpreter
 			return term;
 		}
 
+		std::optional<SourcePosition> getPosition(const Node* node) const
+		{
+			if (const auto position = positions.find(node))
+				return *position;
+
+			for (const auto& part : parts)
+			{
+				if (auto position = part.source->getPosition(node))
+				{
+					position->line += part.lineOffset;
+					return position;
+				}
+			}
+
+			return std::nullopt;
+		}
+
 	private:
 		const TermNode* term;
-		std::unordered_set<boost::local_shared_ptr<Node>> nodes;
+		NodeArena arena;
+		SourcePositions positions;
+		std::vector<Part> parts;
 	};
 }  // namespace rinha::interpreter
 
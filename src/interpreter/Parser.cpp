@@ -1,4 +1,5 @@
 #include "./Parser.h"
+#include "./NodeArena.h"
 #include "./Nodes.h"
 #include "grammar/RinhaLexer.h"
 #include "grammar/RinhaParser.h"
@@ -14,7 +15,6 @@
 #include <string>
 #include <type_traits>
 #include <unordered_map>
-#include <unordered_set>
 #include <utility>
 
 // grammar
@@ -53,9 +53,6 @@ using std::derived_from;
 // unordered_map
 using std::unordered_map;
 
-// unordered_set
-using std::unordered_set;
-
 
 namespace
 {
@@ -69,24 +66,6 @@ namespace
 
 	// Start of NodeFromContext specializations
 
-	template <>
-	struct NodeFromContext<RinhaParser::LogicalOpRuleContext>
-	{
-		using T = BinaryOpNode;
-	};
-
-	template <>
-	struct NodeFromContext<RinhaParser::ArithmeticOpRuleContext>
-	{
-		using T = BinaryOpNode;
-	};
-
-	template <>
-	struct NodeFromContext<RinhaParser::FactorOpRuleContext>
-	{
-		using T = BinaryOpNode;
-	};
-
 	template <>
 	struct NodeFromContext<RinhaParser::TermTupleRuleContext>
 	{
@@ -230,7 +209,7 @@ namespace
 			ranges::transform(ctx->reference(), inserter(parameters, parameters.begin()),
 				[&](auto& parameter) { return getNode(parameter); });
 
-			newNode(ctx, std::move(parameters), getNode(ctx->term()));
+			newNode(ctx, arena.makeArray<const ReferenceNode*>(parameters), getNode(ctx->term()));
 		}
 
 		void enterTermTermRule(RinhaParser::TermTermRuleContext* ctx) override { }
@@ -240,102 +219,46 @@ namespace
 			refNode(ctx, ctx->term());
 		}
 
-		void enterLogicalArithmeticRule(RinhaParser::LogicalArithmeticRuleContext* ctx) override { }
-		void exitLogicalArithmeticRule(RinhaParser::LogicalArithmeticRuleContext* ctx) override
+		void enterLogical(RinhaParser::LogicalContext* ctx) override { }
+
+		void exitLogical(RinhaParser::LogicalContext* ctx) override
 		{
-			refNode(ctx, ctx->arithmetic());
+			newBinaryOpChain(ctx, ctx->conjunction(), ctx->op);
 		}
 
-		void enterLogicalOpRule(RinhaParser::LogicalOpRuleContext* ctx) override { }
+		void enterConjunction(RinhaParser::ConjunctionContext* ctx) override { }
 
-		void exitLogicalOpRule(RinhaParser::LogicalOpRuleContext* ctx) override
+		void exitConjunction(RinhaParser::ConjunctionContext* ctx) override
 		{
-			BinaryOpNode::Op op;
-
-			if (ctx->op->getText() == "&&")
-				op = BinaryOpNode::Op::AND;
-			else if (ctx->op->getText() == "||")
-				op = BinaryOpNode::Op::OR;
-			else if (ctx->op->getText() == "==")
-				op = BinaryOpNode::Op::EQ;
-			else if (ctx->op->getText() == "!=")
-				op = BinaryOpNode::Op::NEQ;
-			else if (ctx->op->getText() == "<=")
-				op = BinaryOpNode::Op::LTE;
-			else if (ctx->op->getText() == ">=")
-				op = BinaryOpNode::Op::GTE;
-			else if (ctx->op->getText() == "<")
-				op = BinaryOpNode::Op::LT;
-			else if (ctx->op->getText() == ">")
-				op = BinaryOpNode::Op::GT;
-			else
-				throw std::logic_error("Invalid logical op");
-
-			newNode(ctx, op, getNode(ctx->arithmetic()), getNode(ctx->logical()));
+			newBinaryOpChain(ctx, ctx->equality(), ctx->op);
 		}
 
-		void enterArithmeticFactorRule(RinhaParser::ArithmeticFactorRuleContext* ctx) override { }
+		void enterEquality(RinhaParser::EqualityContext* ctx) override { }
 
-		void exitArithmeticFactorRule(RinhaParser::ArithmeticFactorRuleContext* ctx) override
+		void exitEquality(RinhaParser::EqualityContext* ctx) override
 		{
-			refNode(ctx, ctx->factor());
+			newBinaryOpChain(ctx, ctx->comparison(), ctx->op);
 		}
 
-		void enterArithmeticOpRule(RinhaParser::ArithmeticOpRuleContext* ctx) override { }
+		void enterComparison(RinhaParser::ComparisonContext* ctx) override { }
 
-		void exitArithmeticOpRule(RinhaParser::ArithmeticOpRuleContext* ctx) override
+		void exitComparison(RinhaParser::ComparisonContext* ctx) override
 		{
-			BinaryOpNode::Op op;
-
-			switch (ctx->op->getText()[0])
-			{
-				case '+':
-					op = BinaryOpNode::Op::ADD;
-					break;
-
-				case '-':
-					op = BinaryOpNode::Op::SUB;
-					break;
-
-				default:
-					throw std::logic_error("Invalid arithmetic op");
-			}
-
-			newNode(ctx, op, getNode(ctx->factor()), getNode(ctx->arithmetic()));
+			newBinaryOpChain(ctx, ctx->arithmetic(), ctx->op);
 		}
 
-		void enterFactorApplyRule(RinhaParser::FactorApplyRuleContext* ctx) override { }
+		void enterArithmetic(RinhaParser::ArithmeticContext* ctx) override { }
 
-		void exitFactorApplyRule(RinhaParser::FactorApplyRuleContext* ctx) override
+		void exitArithmetic(RinhaParser::ArithmeticContext* ctx) override
 		{
-			refNode(ctx, ctx->apply());
+			newBinaryOpChain(ctx, ctx->factor(), ctx->op);
 		}
 
-		void enterFactorOpRule(RinhaParser::FactorOpRuleContext* ctx) override { }
+		void enterFactor(RinhaParser::FactorContext* ctx) override { }
 
-		void exitFactorOpRule(RinhaParser::FactorOpRuleContext* ctx) override
+		void exitFactor(RinhaParser::FactorContext* ctx) override
 		{
-			BinaryOpNode::Op op;
-
-			switch (ctx->op->getText()[0])
-			{
-				case '*':
-					op = BinaryOpNode::Op::MUL;
-					break;
-
-				case '/':
-					op = BinaryOpNode::Op::DIV;
-					break;
-
-				case '%':
-					op = BinaryOpNode::Op::REM;
-					break;
-
-				default:
-					throw std::logic_error("Invalid factor op");
-			}
-
-			newNode(ctx, op, getNode(ctx->apply()), getNode(ctx->factor()));
+			newBinaryOpChain(ctx, ctx->apply(), ctx->op);
 		}
 
 		void enterApplyPrimaryRule(RinhaParser::ApplyPrimaryRuleContext* ctx) override { }
@@ -436,7 +359,7 @@ namespace
 			ranges::transform(ctx->term(), inserter(arguments, arguments.begin()),
 				[&](auto& parameter) { return getNode(parameter); });
 
-			newNode(ctx, getNode(ctx->apply()), std::move(arguments));
+			newNode(ctx, getNode(ctx->apply()), arena.makeArray<const TermNode*>(arguments));
 		}
 
 		void enterReference(RinhaParser::ReferenceContext* ctx) override { }
@@ -459,7 +382,7 @@ namespace
 			if (!ctx)
 				return nullptr;
 
-			return static_cast<NodeFromContextType<T>*>(ctxNodeMap[ctx].get());
+			return static_cast<NodeFromContextType<T>*>(ctxNodeMap[ctx]);
 		}
 
 	private:
@@ -469,14 +392,68 @@ namespace
 		{
 			assert(!ctxNodeMap.contains(ctx));
 
-			auto node = make_local_shared<NodeFromContextType<T>>(std::forward<decltype(args)>(args)...);
+			const auto node = arena.make<NodeFromContextType<T>>(std::forward<decltype(args)>(args)...);
+
+			const antlr4::Token* startToken = ctx->getStart();
+			positions.add(node, {unsigned(startToken->getLine()), unsigned(startToken->getCharPositionInLine()) + 1});
+
+			ctxNodeMap[ctx] = node;
+			return node;
+		}
+
+		// Groups `operand (op operand)*` to the left. The operators' nodes all start where the first operand does.
+		template <typename T, typename U>
+		requires derived_from<T, antlr4::ParserRuleContext> && derived_from<U, antlr4::ParserRuleContext>
+		void newBinaryOpChain(T* ctx, const std::vector<U*>& operands, const std::vector<antlr4::Token*>& ops)
+		{
+			assert(!ctxNodeMap.contains(ctx));
 
+			// Operands are missing after a syntax error.
+			TermNode* node = operands.empty() ? nullptr : getNode(operands.front());
 			const antlr4::Token* startToken = ctx->getStart();
-			node->startLine = startToken->getLine();
-			node->startColumn = startToken->getCharPositionInLine() + 1;
+
+			for (std::size_t i = 0; i < ops.size() && i + 1 < operands.size(); ++i)
+			{
+				node = arena.make<BinaryOpNode>(getBinaryOp(ops[i]), node, getNode(operands[i + 1]));
+				positions.add(
+					node, {unsigned(startToken->getLine()), unsigned(startToken->getCharPositionInLine()) + 1});
+			}
 
 			ctxNodeMap[ctx] = node;
-			return node.get();
+		}
+
+		static BinaryOpNode::Op getBinaryOp(const antlr4::Token* token)
+		{
+			const auto text = token->getText();
+
+			if (text == "||")
+				return BinaryOpNode::Op::OR;
+			else if (text == "&&")
+				return BinaryOpNode::Op::AND;
+			else if (text == "==")
+				return BinaryOpNode::Op::EQ;
+			else if (text == "!=")
+				return BinaryOpNode::Op::NEQ;
+			else if (text == "<=")
+				return BinaryOpNode::Op::LTE;
+			else if (text == ">=")
+				return BinaryOpNode::Op::GTE;
+			else if (text == "<")
+				return BinaryOpNode::Op::LT;
+			else if (text == ">")
+				return BinaryOpNode::Op::GT;
+			else if (text == "+")
+				return BinaryOpNode::Op::ADD;
+			else if (text == "-")
+				return BinaryOpNode::Op::SUB;
+			else if (text == "*")
+				return BinaryOpNode::Op::MUL;
+			else if (text == "/")
+				return BinaryOpNode::Op::DIV;
+			else if (text == "%")
+				return BinaryOpNode::Op::REM;
+			else
+				throw std::logic_error("Invalid binary op");
 		}
 
 		template <typename T, typename U>
@@ -489,14 +466,16 @@ namespace
 			if (auto nodeIt = ctxNodeMap.find(referencedCtx); nodeIt != ctxNodeMap.end())
 			{
 				ctxNodeMap[ctx] = nodeIt->second;
-				return static_cast<NodeFromContextType<U>*>(nodeIt->second.get());
+				return static_cast<NodeFromContextType<U>*>(nodeIt->second);
 			}
 			else
 				return nullptr;
 		}
 
 	public:
-		unordered_map<antlr4::ParserRuleContext*, local_shared_ptr<Node>> ctxNodeMap;
+		NodeArena arena;
+		SourcePositions positions;
+		unordered_map<antlr4::ParserRuleContext*, Node*> ctxNodeMap;
 	};
 
 	class ErrorListener : public antlr4::BaseErrorListener
@@ -533,34 +512,74 @@ namespace rinha::interpreter
 
 			parser.removeParseListeners();
 			parser.removeErrorListeners();
+		}
+
+		// Null when SLL prediction fails, which happens for invalid sources but also for some valid ones. Errors are
+		// not reported.
+		RinhaParser::RootContext* parseSll()
+		{
+			parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(
+				antlr4::atn::PredictionMode::SLL);
+			parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+			parser.addParseListener(listener.get());
+
+			try
+			{
+				return parser.root();
+			}
+			catch (const antlr4::ParseCancellationException&)
+			{
+				return nullptr;
+			}
+		}
+
+		// Parses from the first token again, dropping the nodes built by a previous attempt.
+		RinhaParser::RootContext* parseLl()
+		{
+			listener = make_unique<Listener>();
+
+			parser.reset();
+			parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(
+				antlr4::atn::PredictionMode::LL);
+			parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+			parser.removeParseListeners();
+			parser.addParseListener(listener.get());
 			parser.addErrorListener(&errorListener);
 
-			parser.addParseListener(&listener);
+			return parser.root();
 		}
 
 		antlr4::ANTLRInputStream antlrInputStream;
 		RinhaLexer lexer{&antlrInputStream};
 		antlr4::CommonTokenStream tokens{&lexer};
 		RinhaParser parser{&tokens};
-		Listener listener;
+		unique_ptr<Listener> listener = make_unique<Listener>();
 		ErrorListener errorListener;
 	};
 
 
-	Parser::Parser(unique_ptr<istream> _stream)
+	Parser::Parser(unique_ptr<istream> _stream, Mode mode)
 		: stream(std::move(_stream)),
 		  diagnostics(make_local_shared<Diagnostics>()),
 		  hidden(make_unique<Hidden>(*stream.get(), diagnostics))
 	{
-		auto root = hidden->parser.root();
-		rootTerm = hidden->listener.getNode(root);
+		auto root = mode == Mode::SLL_THEN_LL ? hidden->parseSll() : nullptr;
+
+		if (!root)
+		{
+			reparsed = mode == Mode::SLL_THEN_LL;
+			root = hidden->parseLl();
+		}
 
-		unordered_set<local_shared_ptr<Node>> nodeSet;
+		auto& listener = *hidden->listener;
+		rootTerm = listener.getNode(root);
 
-		ranges::transform(
-			hidden->listener.ctxNodeMap, inserter(nodeSet, nodeSet.begin()), [](auto& pair) { return pair.second; });
+		parsedSource =
+			make_local_shared<ParsedSource>(rootTerm, std::move(listener.arena), std::move(listener.positions));
 
-		parsedSource = make_local_shared<ParsedSource>(rootTerm, std::move(nodeSet));
+		// The AST doesn't refer to the parse tree and tokens, so they're freed right away.
+		hidden.reset();
+		stream.reset();
 	}
 
 	Parser::~Parser() = default;
@@ -5,7 +5,9 @@
 #include "./ParsedSource.h"
 #include "./Diagnostic.h"
 #include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <cstdint>
 #include <istream>
+#include <memory>
 #include <sstream>
 #include <string>
 
@@ -17,16 +19,31 @@ namespace rinha::interpreter
 		struct Hidden;
 
 	public:
-		explicit Parser(std::unique_ptr<std::istream> _stream);
+		enum class Mode : uint8_t
+		{
+			// SLL prediction, giving up at the first error, then full LL with error recovery and diagnostics only if
+			// that fails. Both accept the same programs; SLL avoids full-context prediction for valid ones.
+			SLL_THEN_LL,
+			LL
+		};
+
+	public:
+		explicit Parser(std::unique_ptr<std::istream> _stream, Mode mode = Mode::SLL_THEN_LL);
 
-		explicit Parser(const std::string& str)
-			: Parser(std::make_unique<std::istringstream>(str))
+		explicit Parser(const std::string& str, Mode mode = Mode::SLL_THEN_LL)
+			: Parser(std::make_unique<std::istringstream>(str), mode)
 		{
 		}
 
 		~Parser();
 
 	public:
+		// Whether the source was parsed twice, as SLL failed.
+		bool wasReparsed() const
+		{
+			return reparsed;
+		}
+
 		auto getParsedSource() const
 		{
 			return parsedSource;
@@ -42,6 +59,7 @@ namespace rinha::interpreter
 		boost::local_shared_ptr<ParsedSource> parsedSource;
 		boost::local_shared_ptr<Diagnostics> diagnostics;
 		const TermNode* rootTerm = nullptr;
+		bool reparsed = false;
 		std::unique_ptr<Hidden> hidden;
 	};
 }  // namespace rinha::interpreter
@@ -0,0 +1,657 @@
+#include "./ProgramCache.h"
+#include "./MappedFile.h"
+#include "./NodeArena.h"
+#include "./Nodes.h"
+#include "./ParsedSource.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <unistd.h>
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// filesystem
+namespace fs = std::filesystem;
+
+// optional
+using std::optional;
+
+// string
+using std::string;
+
+// string_view
+using std::string_view;
+
+// vector
+using std::vector;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		// Changed whenever the layout of entries or the AST built for a source changes, so old entries are ignored.
+		constexpr uint32_t FORMAT_VERSION = 3;
+		constexpr char MAGIC[8] = {'R', 'I', 'N', 'H', 'A', 'A', 'S', 'T'};
+
+		struct Header final
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t sourceFormat;
+			uint64_t sourceSize;
+			std::array<uint64_t, 2> sourceHash;
+		};
+
+		enum class LiteralType : uint8_t
+		{
+			BOOL,
+			INT,
+			STR
+		};
+
+		// Not cryptographic: entries are also checked against the source size, and a cache directory is trusted.
+		std::array<uint64_t, 2> hashSource(string_view source, ProgramCache::SourceFormat format)
+		{
+			const auto fmix = [](uint64_t h)
+			{
+				h ^= h >> 33;
+				h *= 0xFF51AFD7ED558CCDull;
+				h ^= h >> 33;
+				h *= 0xC4CEB9FE1A85EC53ull;
+				return h ^ (h >> 33);
+			};
+
+			uint64_t a = 0x9E3779B97F4A7C15ull ^ source.size();
+			uint64_t b = 0xC2B2AE3D27D4EB4Full + source.size() + uint64_t(format);
+
+			const auto mix = [&](uint64_t word)
+			{
+				a = std::rotl(a ^ word, 31) * 0x87C37B91114253D5ull;
+				b = (std::rotl(b + word, 27) * 0x4CF5AD432745937Full) ^ a;
+			};
+
+			std::size_t i = 0;
+
+			for (; i + 8 <= source.size(); i += 8)
+			{
+				uint64_t word;
+				std::memcpy(&word, source.data() + i, 8);
+				mix(word);
+			}
+
+			if (i < source.size())
+			{
+				uint64_t tail = 0;
+				std::memcpy(&tail, source.data() + i, source.size() - i);
+				mix(tail);
+			}
+
+			return {fmix(a + b), fmix(b ^ std::rotl(a, 17))};
+		}
+
+		fs::path getEntryPath(const fs::path& directory, const std::array<uint64_t, 2>& sourceHash)
+		{
+			static constexpr char DIGITS[] = "0123456789abcdef";
+
+			string name;
+
+			for (const auto part : sourceHash)
+			{
+				for (int shift = 60; shift >= 0; shift -= 4)
+					name += DIGITS[(part >> shift) & 0xF];
+			}
+
+			return directory / (name + ".ast");
+		}
+
+		// Writes each term after its children, so reading needs no recursion, only a stack of finished terms.
+		class Writer final
+		{
+		public:
+			explicit Writer(const ParsedSource& parsedSource)
+				: parsedSource(parsedSource)
+			{
+			}
+
+		public:
+			string write(const Header& header)
+			{
+				append(header);
+
+				vector<std::pair<const TermNode*, bool>> pending{{parsedSource.getTerm(), false}};
+
+				while (!pending.empty())
+				{
+					auto [node, childrenWritten] = pending.back();
+
+					if (childrenWritten)
+					{
+						pending.pop_back();
+						writeTerm(node);
+						continue;
+					}
+
+					pending.back().second = true;
+
+					// Pushed in reverse, so they're written in order.
+					const auto child = [&](const TermNode* childNode) { pending.emplace_back(childNode, false); };
+
+					switch (node->getType())
+					{
+						case TermNode::Type::LITERAL:
+						case TermNode::Type::VAR:
+							break;
+
+						case TermNode::Type::TUPLE:
+							child(static_cast<const TupleNode*>(node)->second);
+							child(static_cast<const TupleNode*>(node)->first);
+							break;
+
+						case TermNode::Type::FN:
+							child(static_cast<const FnNode*>(node)->body);
+							break;
+
+						case TermNode::Type::CALL:
+						{
+							const auto callNode = static_cast<const CallNode*>(node);
+
+							for (auto it = callNode->arguments.rbegin(); it != callNode->arguments.rend(); ++it)
+								child(*it);
+
+							child(callNode->callee);
+							break;
+						}
+
+						case TermNode::Type::BINARY_OP:
+							child(static_cast<const BinaryOpNode*>(node)->second);
+							child(static_cast<const BinaryOpNode*>(node)->first);
+							break;
+
+						case TermNode::Type::IF:
+							child(static_cast<const IfNode*>(node)->otherwise);
+							child(static_cast<const IfNode*>(node)->then);
+							child(static_cast<const IfNode*>(node)->condition);
+							break;
+
+						case TermNode::Type::TUPLE_INDEX:
+							child(static_cast<const TupleIndexNode*>(node)->arg);
+							break;
+
+						case TermNode::Type::LET:
+							child(static_cast<const LetNode*>(node)->next);
+							child(static_cast<const LetNode*>(node)->value);
+							break;
+
+						case TermNode::Type::PRINT:
+							child(static_cast<const PrintNode*>(node)->arg);
+							break;
+					}
+				}
+
+				return std::move(output);
+			}
+
+		private:
+			void writeTerm(const TermNode* node)
+			{
+				append(node->getType());
+				appendPosition(node);
+
+				switch (node->getType())
+				{
+					case TermNode::Type::LITERAL:
+						std::visit(
+							[&](const auto& value)
+							{
+								using T = std::decay_t<decltype(value)>;
+
+								if constexpr (std::is_same_v<T, BoolValue>)
+								{
+									append(LiteralType::BOOL);
+									append(uint8_t(value.getValue()));
+								}
+								else if constexpr (std::is_same_v<T, IntValue>)
+								{
+									append(LiteralType::INT);
+									append(value.getValue());
+								}
+								else if constexpr (std::is_same_v<T, StrValue>)
+								{
+									append(LiteralType::STR);
+									appendString(value.getValue());
+								}
+								else
+									std::abort();  // The parsers only build the literals above.
+							},
+							static_cast<const LiteralNode*>(node)->value);
+						break;
+
+					case TermNode::Type::FN:
+					{
+						const auto& parameters = static_cast<const FnNode*>(node)->parameters;
+						appendVarint(uint32_t(parameters.size()));
+
+						for (const auto parameter : parameters)
+							appendReference(parameter);
+
+						break;
+					}
+
+					case TermNode::Type::CALL:
+						appendVarint(uint32_t(static_cast<const CallNode*>(node)->arguments.size()));
+						break;
+
+					case TermNode::Type::BINARY_OP:
+						append(static_cast<const BinaryOpNode*>(node)->op);
+						break;
+
+					case TermNode::Type::TUPLE_INDEX:
+						append(uint8_t(static_cast<const TupleIndexNode*>(node)->index));
+						break;
+
+					case TermNode::Type::VAR:
+						appendReference(static_cast<const VarNode*>(node)->reference);
+						break;
+
+					case TermNode::Type::LET:
+						appendReference(static_cast<const LetNode*>(node)->reference);
+						break;
+
+					case TermNode::Type::TUPLE:
+					case TermNode::Type::IF:
+					case TermNode::Type::PRINT:
+						break;
+				}
+			}
+
+			template <typename T>
+			void append(const T& value)
+			{
+				output.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+
+			// LEB128, as most counts, lengths and positions fit in a byte or two.
+			void appendVarint(uint32_t value)
+			{
+				while (value >= 0x80)
+				{
+					output += char(value | 0x80);
+					value >>= 7;
+				}
+
+				output += char(value);
+			}
+
+			void appendString(const string& value)
+			{
+				appendVarint(uint32_t(value.size()));
+				output += value;
+			}
+
+			void appendPosition(const Node* node)
+			{
+				const auto position = parsedSource.getPosition(node);
+				appendVarint(position ? position->line : 0);
+				appendVarint(position ? position->column : 0);
+			}
+
+			void appendReference(const ReferenceNode* node)
+			{
+				appendPosition(node);
+				appendString(node->name);
+			}
+
+		private:
+			const ParsedSource& parsedSource;
+			string output;
+		};
+
+		// Thrown for truncated or inconsistent entries.
+		struct InvalidEntry final
+		{
+		};
+
+		class Reader final
+		{
+		public:
+			explicit Reader(string_view data)
+				: data(data)
+			{
+			}
+
+		public:
+			local_shared_ptr<ParsedSource> read()
+			{
+				vector<const TermNode*> terms;
+				vector<const ReferenceNode*> parameters;
+
+				while (offset < data.size())
+				{
+					const auto type = read<TermNode::Type>();
+					const auto position = readPosition();
+					const TermNode* node;
+
+					switch (type)
+					{
+						case TermNode::Type::LITERAL:
+							node = arena.make<LiteralNode>(readLiteral());
+							break;
+
+						case TermNode::Type::TUPLE:
+						{
+							const auto second = pop(terms);
+							node = arena.make<TupleNode>(pop(terms), second);
+							break;
+						}
+
+						case TermNode::Type::FN:
+						{
+							const auto count = readVarint();
+
+							// Each parameter takes at least three bytes, so a corrupt count can't exhaust memory.
+							if (count > (data.size() - offset) / 3)
+								throw InvalidEntry();
+
+							parameters.resize(count);
+
+							for (auto& parameter : parameters)
+								parameter = readReference();
+
+							node = arena.make<FnNode>(
+								arena.makeArray<const ReferenceNode*>(parameters), pop(terms));
+							break;
+						}
+
+						case TermNode::Type::CALL:
+						{
+							const auto count = readVarint();
+
+							if (count >= terms.size())
+								throw InvalidEntry();
+
+							const auto arguments = std::span(terms).last(count);
+							const auto callee = terms[terms.size() - count - 1];
+
+							node = arena.make<CallNode>(callee, arena.makeArray<const TermNode*>(arguments));
+							terms.resize(terms.size() - count - 1);
+							break;
+						}
+
+						case TermNode::Type::BINARY_OP:
+						{
+							const auto op = read<BinaryOpNode::Op>();
+
+							if (op > BinaryOpNode::Op::OR)
+								throw InvalidEntry();
+
+							const auto second = pop(terms);
+							node = arena.make<BinaryOpNode>(op, pop(terms), second);
+							break;
+						}
+
+						case TermNode::Type::IF:
+						{
+							const auto otherwise = pop(terms);
+							const auto then = pop(terms);
+							node = arena.make<IfNode>(pop(terms), then, otherwise);
+							break;
+						}
+
+						case TermNode::Type::TUPLE_INDEX:
+						{
+							const auto index = read<uint8_t>();
+
+							if (index > 1)
+								throw InvalidEntry();
+
+							node = arena.make<TupleIndexNode>(pop(terms), index);
+							break;
+						}
+
+						case TermNode::Type::VAR:
+							node = arena.make<VarNode>(readReference());
+							break;
+
+						case TermNode::Type::LET:
+						{
+							const auto reference = readReference();
+							const auto next = pop(terms);
+							node = arena.make<LetNode>(reference, pop(terms), next);
+							break;
+						}
+
+						case TermNode::Type::PRINT:
+							node = arena.make<PrintNode>(pop(terms));
+							break;
+
+						default:
+							throw InvalidEntry();
+					}
+
+					addPosition(node, position);
+					terms.push_back(node);
+				}
+
+				if (terms.size() != 1)
+					throw InvalidEntry();
+
+				return make_local_shared<ParsedSource>(terms.front(), std::move(arena), std::move(positions));
+			}
+
+		private:
+			template <typename T>
+			T read()
+			{
+				if (data.size() - offset < sizeof(T))
+					throw InvalidEntry();
+
+				T value;
+				std::memcpy(&value, data.data() + offset, sizeof(T));
+				offset += sizeof(T);
+
+				return value;
+			}
+
+			uint32_t readVarint()
+			{
+				uint32_t value = 0;
+
+				for (unsigned shift = 0; shift < 32; shift += 7)
+				{
+					const auto byte = read<uint8_t>();
+					value |= uint32_t(byte & 0x7F) << shift;
+
+					if (!(byte & 0x80))
+						return value;
+				}
+
+				throw InvalidEntry();
+			}
+
+			SourcePosition readPosition()
+			{
+				const auto line = readVarint();
+				return {line, readVarint()};
+			}
+
+			string readString()
+			{
+				const auto size = readVarint();
+
+				if (data.size() - offset < size)
+					throw InvalidEntry();
+
+				string value(data.substr(offset, size));
+				offset += size;
+
+				return value;
+			}
+
+			Value readLiteral()
+			{
+				switch (read<LiteralType>())
+				{
+					case LiteralType::BOOL:
+						return BoolValue(read<uint8_t>() != 0);
+
+					case LiteralType::INT:
+						return IntValue(read<int32_t>());
+
+					case LiteralType::STR:
+						return StrValue(readString());
+
+					default:
+						throw InvalidEntry();
+				}
+			}
+
+			const ReferenceNode* readReference()
+			{
+				const auto position = readPosition();
+				const auto node = arena.make<ReferenceNode>(readString());
+				addPosition(node, position);
+
+				return node;
+			}
+
+			void addPosition(const Node* node, SourcePosition position)
+			{
+				if (position.line != 0)
+					positions.add(node, position);
+			}
+
+			static const TermNode* pop(vector<const TermNode*>& terms)
+			{
+				if (terms.empty())
+					throw InvalidEntry();
+
+				const auto term = terms.back();
+				terms.pop_back();
+
+				return term;
+			}
+
+		private:
+			const string_view data;
+			std::size_t offset = 0;
+			NodeArena arena;
+			SourcePositions positions;
+		};
+	}  // namespace
+
+	ProgramCache::ProgramCache(fs::path directory)
+		: directory(std::move(directory))
+	{
+	}
+
+	optional<ProgramCache> ProgramCache::fromEnvironment()
+	{
+		const auto env = std::getenv("RINHA_CACHE_DIR");
+
+		if (!env || !*env)
+			return std::nullopt;
+
+		return ProgramCache(env);
+	}
+
+	local_shared_ptr<ParsedSource> ProgramCache::load(string_view source, SourceFormat format) const
+	{
+		const auto sourceHash = hashSource(source, format);
+		const auto path = getEntryPath(directory, sourceHash);
+		std::error_code errorCode;
+
+		if (!fs::is_regular_file(path, errorCode))
+			return nullptr;
+
+		try
+		{
+			const MappedFile mappedFile(path);
+			const auto data = mappedFile.getData();
+
+			if (data.size() < sizeof(Header))
+				return nullptr;
+
+			Header header;
+			std::memcpy(&header, data.data(), sizeof(header));
+
+			if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION ||
+				header.sourceFormat != uint32_t(format) || header.sourceSize != source.size() ||
+				header.sourceHash != sourceHash)
+			{
+				return nullptr;
+			}
+
+			return Reader(data.substr(sizeof(Header))).read();
+		}
+		catch (const InvalidEntry&)
+		{
+			return nullptr;
+		}
+		catch (const std::runtime_error&)
+		{
+			return nullptr;
+		}
+	}
+
+	void ProgramCache::store(string_view source, SourceFormat format, const ParsedSource& parsedSource) const
+	{
+		Header header{};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = FORMAT_VERSION;
+		header.sourceFormat = uint32_t(format);
+		header.sourceSize = source.size();
+		header.sourceHash = hashSource(source, format);
+
+		const auto entry = Writer(parsedSource).write(header);
+
+		std::error_code errorCode;
+		fs::create_directories(directory, errorCode);
+
+		// Written aside and renamed, so concurrent runs never map a partial entry.
+		auto temporaryPath = (directory / ".entry-XXXXXX").string();
+		const auto fd = mkstemp(temporaryPath.data());
+
+		if (fd < 0)
+			return;
+
+		auto written = std::size_t(0);
+
+		while (written < entry.size())
+		{
+			const auto result = ::write(fd, entry.data() + written, entry.size() - written);
+
+			if (result <= 0)
+				break;
+
+			written += std::size_t(result);
+		}
+
+		close(fd);
+
+		if (written == entry.size())
+			fs::rename(temporaryPath, getEntryPath(directory, header.sourceHash), errorCode);
+
+		if (written != entry.size() || errorCode)
+			fs::remove(temporaryPath, errorCode);
+	}
+}  // namespace rinha::interpreter
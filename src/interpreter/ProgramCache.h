@@ -0,0 +1,45 @@
+#ifndef RINHA_INTERPRETER_PROGRAM_CACHE_H
+#define RINHA_INTERPRETER_PROGRAM_CACHE_H
+
+#include "./ParsedSource.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+namespace rinha::interpreter
+{
+	// Parsed programs stored in a directory, one file per source named after a 128-bit hash of it. Entries are
+	// written in a compact postorder form and read back through mmap in a single pass, so running a cached source
+	// doesn't lex, parse or initialize ANTLR. Only sources without errors are stored.
+	class ProgramCache final
+	{
+	public:
+		// How the source is read, which is part of the key, so identical bytes read as Rinha and as a JSON AST don't
+		// share an entry.
+		enum class SourceFormat : uint8_t
+		{
+			RINHA,
+			JSON_AST
+		};
+
+	public:
+		explicit ProgramCache(std::filesystem::path directory);
+
+		// From RINHA_CACHE_DIR, if set.
+		static std::optional<ProgramCache> fromEnvironment();
+
+	public:
+		// Null when the source isn't cached or its entry is unusable.
+		boost::local_shared_ptr<ParsedSource> load(std::string_view source, SourceFormat format) const;
+
+		// Errors are ignored, as the cache is only an optimization.
+		void store(std::string_view source, SourceFormat format, const ParsedSource& parsedSource) const;
+
+	private:
+		std::filesystem::path directory;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_PROGRAM_CACHE_H
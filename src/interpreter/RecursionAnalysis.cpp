@@ -0,0 +1,290 @@
+#include "./RecursionAnalysis.h"
+#include "./Nodes.h"
+#include "./ScopeAnalysis.h"
+#include <algorithm>
+#include <unordered_set>
+
+// optional
+using std::optional;
+
+// string
+using std::string;
+using std::to_string;
+
+
+namespace rinha::interpreter
+{
+	RecursionAnalysis::RecursionAnalysis(const TermNode* root)
+		: scopeAnalysis(root)
+	{
+		auto& rootFunction = functions.emplace_back(Function{nullptr, &scopeAnalysis.getRootScope(), {}});
+		collect(rootFunction, root, true);
+
+		for (auto& function : functions)
+		{
+			for (auto& call : function.calls)
+				call.callee = resolveCallee(function, call.node->callee);
+		}
+
+		bool unknownDepth = false;
+		bool hasEntries = false;
+
+		for (const auto& function : functions)
+		{
+			unsigned recursiveCalls = 0;
+
+			for (const auto& call : function.calls)
+			{
+				if (!call.callee || !reaches(call.callee, call.callee))
+					continue;
+
+				if (function.node && reaches(call.callee, function.node))
+				{
+					// A call inside the recursion.
+					recursive = true;
+					++recursiveCalls;
+
+					if (!call.tail)
+						tailOnly = false;
+				}
+				else
+				{
+					// A call entering the recursion from outside.
+					hasEntries = true;
+
+					if (const auto depth = estimateDepth(*functionsByNode.at(call.callee), call.node))
+						estimatedDepth = std::max(estimatedDepth.value_or(0), depth.value());
+					else
+						unknownDepth = true;
+				}
+			}
+
+			// Calls in different branches of an if are counted together, so this is an over-approximation.
+			if (recursiveCalls > 1)
+				treeShaped = true;
+		}
+
+		if (!recursive)
+			tailOnly = false;
+
+		if (!recursive || unknownDepth || !hasEntries)
+			estimatedDepth.reset();
+	}
+
+	string RecursionAnalysis::describe() const
+	{
+		if (!recursive)
+			return "not recursive";
+
+		string description = "recursive, ";
+		description += treeShaped ? "tree-shaped" : "linear";
+		description += tailOnly ? ", tail calls only" : ", non-tail calls";
+		description += estimatedDepth ? ", estimated depth " + to_string(estimatedDepth.value()) : ", unknown depth";
+
+		return description;
+	}
+
+	void RecursionAnalysis::collect(Function& function, const TermNode* node, bool tail)
+	{
+		switch (node->getType())
+		{
+			case TermNode::Type::LITERAL:
+			case TermNode::Type::VAR:
+				break;
+
+			case TermNode::Type::FN:
+			{
+				const auto fnNode = static_cast<const FnNode*>(node);
+				auto& nested = functions.emplace_back(Function{fnNode, &scopeAnalysis.getScope(fnNode), {}});
+				functionsByNode[fnNode] = &nested;
+				collect(nested, fnNode->getBody(), true);
+				break;
+			}
+
+			case TermNode::Type::TUPLE:
+			{
+				const auto tupleNode = static_cast<const TupleNode*>(node);
+				collect(function, tupleNode->first, false);
+				collect(function, tupleNode->second, false);
+				break;
+			}
+
+			case TermNode::Type::CALL:
+			{
+				const auto callNode = static_cast<const CallNode*>(node);
+				function.calls.push_back({callNode, tail});
+				collect(function, callNode->callee, false);
+
+				for (const auto argument : callNode->arguments)
+					collect(function, argument, false);
+
+				break;
+			}
+
+			case TermNode::Type::BINARY_OP:
+			{
+				const auto binaryOpNode = static_cast<const BinaryOpNode*>(node);
+				collect(function, binaryOpNode->first, false);
+				collect(function, binaryOpNode->second, false);
+				break;
+			}
+
+			case TermNode::Type::IF:
+			{
+				const auto ifNode = static_cast<const IfNode*>(node);
+				collect(function, ifNode->condition, false);
+				collect(function, ifNode->then, tail);
+				collect(function, ifNode->otherwise, tail);
+				break;
+			}
+
+			case TermNode::Type::TUPLE_INDEX:
+				collect(function, static_cast<const TupleIndexNode*>(node)->arg, false);
+				break;
+
+			case TermNode::Type::LET:
+			{
+				const auto letNode = static_cast<const LetNode*>(node);
+				const auto fnNode = nodeAs<FnNode>(letNode->value);
+				auto& scopeBindings = bindings[function.scope];
+
+				if (const auto [it, inserted] =
+						scopeBindings.try_emplace(scopeAnalysis.getLetSlot(letNode), fnNode.value_or(nullptr));
+					!inserted && it->second != fnNode.value_or(nullptr))
+				{
+					it->second = nullptr;
+				}
+
+				collect(function, letNode->value, false);
+				collect(function, letNode->next, tail);
+				break;
+			}
+
+			case TermNode::Type::PRINT:
+				collect(function, static_cast<const PrintNode*>(node)->arg, false);
+				break;
+		}
+	}
+
+	const FnNode* RecursionAnalysis::resolveCallee(const Function& function, const TermNode* callee) const
+	{
+		if (const auto fnNode = nodeAs<FnNode>(callee))
+			return fnNode.value();
+
+		const auto varNode = nodeAs<VarNode>(callee);
+
+		if (!varNode)
+			return nullptr;
+
+		const auto& candidates = scopeAnalysis.getCandidates(varNode.value());
+
+		if (candidates.empty())
+			return nullptr;
+
+		auto scope = function.scope;
+
+		for (unsigned hops = 0; hops < candidates[0].hops; ++hops)
+			scope = scope->parent;
+
+		if (const auto scopeIt = bindings.find(scope); scopeIt != bindings.end())
+		{
+			if (const auto it = scopeIt->second.find(candidates[0].index); it != scopeIt->second.end())
+				return it->second;
+		}
+
+		return nullptr;
+	}
+
+	bool RecursionAnalysis::reaches(const FnNode* from, const FnNode* to) const
+	{
+		std::unordered_set<const FnNode*> visited;
+		std::vector<const FnNode*> pending{from};
+
+		while (!pending.empty())
+		{
+			const auto current = pending.back();
+			pending.pop_back();
+
+			for (const auto& call : functionsByNode.at(current)->calls)
+			{
+				if (!call.callee)
+					continue;
+
+				if (call.callee == to)
+					return true;
+
+				if (visited.insert(call.callee).second)
+					pending.push_back(call.callee);
+			}
+		}
+
+		return false;
+	}
+
+	// Each parameter that all direct recursive calls decrease (n - k, or n / k) bounds the depth when it starts
+	// from a literal.
+	optional<unsigned> RecursionAnalysis::estimateDepth(const Function& callee, const CallNode* entry) const
+	{
+		const auto parameterCount = callee.scope->getParameterCount();
+		optional<unsigned> depth;
+
+		if (entry->arguments.size() != parameterCount)
+			return std::nullopt;
+
+		for (unsigned i = 0; i < parameterCount; ++i)
+		{
+			const auto literalNode = nodeAs<LiteralNode>(entry->arguments[i]);
+			const auto initial = literalNode ? std::get_if<IntValue>(&literalNode.value()->value) : nullptr;
+
+			if (!initial || initial->getValue() <= 0)
+				continue;
+
+			optional<unsigned> parameterDepth;
+
+			for (const auto& call : callee.calls)
+			{
+				if (call.callee != callee.node)
+					continue;
+
+				const auto binaryOpNode = call.node->arguments.size() == parameterCount ?
+					nodeAs<BinaryOpNode>(call.node->arguments[i]) :
+					std::nullopt;
+				const auto varNode = binaryOpNode ? nodeAs<VarNode>(binaryOpNode.value()->first) : std::nullopt;
+				const auto stepNode = binaryOpNode ? nodeAs<LiteralNode>(binaryOpNode.value()->second) : std::nullopt;
+				const auto step = stepNode ? std::get_if<IntValue>(&stepNode.value()->value) : nullptr;
+				const auto& candidates =
+					varNode ? scopeAnalysis.getCandidates(varNode.value()) : std::vector<VarSlot>();
+
+				if (!step || candidates.empty() || candidates[0].hops != 0 || candidates[0].index != i)
+				{
+					parameterDepth.reset();
+					break;
+				}
+
+				unsigned callDepth;
+
+				if (binaryOpNode.value()->op == BinaryOpNode::Op::SUB && step->getValue() > 0)
+					callDepth = unsigned(initial->getValue()) / unsigned(step->getValue()) + 1;
+				else if (binaryOpNode.value()->op == BinaryOpNode::Op::DIV && step->getValue() > 1)
+				{
+					callDepth = 1;
+
+					for (auto value = initial->getValue(); value > 0; value /= step->getValue())
+						++callDepth;
+				}
+				else
+				{
+					parameterDepth.reset();
+					break;
+				}
+
+				parameterDepth = std::max(parameterDepth.value_or(0), callDepth);
+			}
+
+			if (parameterDepth)
+				depth = std::max(depth.value_or(0), parameterDepth.value());
+		}
+
+		return depth;
+	}
+}  // namespace rinha::interpreter
@@ -0,0 +1,85 @@
+#ifndef RINHA_INTERPRETER_RECURSION_ANALYSIS_H
+#define RINHA_INTERPRETER_RECURSION_ANALYSIS_H
+
+#include "./Nodes.h"
+#include "./ScopeAnalysis.h"
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rinha::interpreter
+{
+	// Static estimate of how a program recurses, resolving calls to functions bound by lets.
+	class RecursionAnalysis final
+	{
+	public:
+		explicit RecursionAnalysis(const TermNode* root);
+
+		RecursionAnalysis(const RecursionAnalysis&) = delete;
+		RecursionAnalysis& operator=(const RecursionAnalysis&) = delete;
+
+	public:
+		bool isRecursive() const noexcept
+		{
+			return recursive;
+		}
+
+		// Whether some activation of a recursive function may recurse more than once (like fib).
+		bool isTreeShaped() const noexcept
+		{
+			return treeShaped;
+		}
+
+		// Whether all recursive calls are in tail position.
+		bool isTailOnly() const noexcept
+		{
+			return tailOnly;
+		}
+
+		// Maximum recursion depth, estimated from the literal arguments passed to recursive functions and how their
+		// recursive calls decrease them. Unknown when some recursion can't be estimated.
+		std::optional<unsigned> getEstimatedDepth() const noexcept
+		{
+			return estimatedDepth;
+		}
+
+		std::string describe() const;
+
+	private:
+		struct Call final
+		{
+			const CallNode* node;
+			bool tail;
+			const FnNode* callee = nullptr;
+		};
+
+		struct Function final
+		{
+			const FnNode* node;
+			const Scope* scope;
+			std::vector<Call> calls;
+		};
+
+	private:
+		void collect(Function& function, const TermNode* node, bool tail);
+		const FnNode* resolveCallee(const Function& function, const TermNode* callee) const;
+		bool reaches(const FnNode* from, const FnNode* to) const;
+		std::optional<unsigned> estimateDepth(const Function& callee, const CallNode* entry) const;
+
+	private:
+		ScopeAnalysis scopeAnalysis;
+		std::deque<Function> functions;
+		std::unordered_map<const FnNode*, const Function*> functionsByNode;
+		// Function bound to each let slot, or nullptr when the slot may hold different things.
+		std::unordered_map<const Scope*, std::unordered_map<unsigned, const FnNode*>> bindings;
+		bool recursive = false;
+		bool treeShaped = false;
+		bool tailOnly = true;
+		std::optional<unsigned> estimatedDepth;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_RECURSION_ANALYSIS_H
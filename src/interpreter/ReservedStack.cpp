@@ -0,0 +1,112 @@
+#include "./ReservedStack.h"
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <ostream>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// exception
+using std::exception_ptr;
+
+// iostream
+using std::clog;
+
+// ostream
+using std::endl;
+
+
+namespace rinha::interpreter
+{
+	ReservedStack::ReservedStack(std::size_t requestedSize)
+	{
+		const auto pageSize = (std::size_t) sysconf(_SC_PAGESIZE);
+		const auto size = (requestedSize + pageSize - 1) / pageSize * pageSize;
+		this->size = size;
+
+		const auto memory =
+			mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+
+		if (memory == MAP_FAILED)
+		{
+			error = errno;
+			return;
+		}
+
+		// The stack grows down, so the guard page is the lowest one.
+		if (mprotect(memory, pageSize, PROT_NONE) != 0)
+		{
+			error = errno;
+			munmap(memory, size);
+			return;
+		}
+
+		base = memory;
+		limit = (std::uintptr_t) memory + pageSize + MARGIN;
+	}
+
+	ReservedStack::~ReservedStack()
+	{
+		if (base)
+			munmap(base, size);
+	}
+
+	void ReservedStack::run(const std::function<void()>& function)
+	{
+		struct Job
+		{
+			const std::function<void()>& function;
+			exception_ptr exception;
+		} job{function};
+
+		const auto start = [](void* arg) -> void* {
+			const auto job = static_cast<Job*>(arg);
+
+			try
+			{
+				job->function();
+			}
+			catch (...)
+			{
+				job->exception = std::current_exception();
+			}
+
+			return nullptr;
+		};
+
+		pthread_attr_t attr;
+		pthread_t thread;
+		bool started = false;
+
+		int threadError = 0;
+
+		if (base && (threadError = pthread_attr_init(&attr)) == 0)
+		{
+			if ((threadError = pthread_attr_setstack(&attr, base, size)) == 0)
+				threadError = pthread_create(&thread, &attr, start, &job);
+
+			started = threadError == 0;
+			pthread_attr_destroy(&attr);
+		}
+
+		if (started)
+			pthread_join(thread, nullptr);
+		else
+		{
+			// The limit is an address of the reservation, which the calling thread doesn't use.
+			limit = 0;
+
+			clog << "Warning: cannot " << (base ? "start a thread on" : "reserve") << " a stack of " << size
+				 << " bytes (" << std::strerror(base ? threadError : error)
+				 << "); running without a stack depth check in the calling thread." << endl;
+
+			start(&job);
+		}
+
+		if (job.exception)
+			std::rethrow_exception(job.exception);
+	}
+}  // namespace rinha::interpreter
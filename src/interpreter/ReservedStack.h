@@ -0,0 +1,50 @@
+#ifndef RINHA_INTERPRETER_RESERVED_STACK_H
+#define RINHA_INTERPRETER_RESERVED_STACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace rinha::interpreter
+{
+	// Large native stack, reserved as address space and committed by the kernel only as it's touched, with a
+	// guard page at its end.
+	class ReservedStack final
+	{
+	public:
+		// Space kept free above the guard page, so code checking getLimit() can throw before touching it.
+		static constexpr std::size_t MARGIN = 1024 * 1024;
+
+	public:
+		explicit ReservedStack(std::size_t size);
+		~ReservedStack();
+
+		ReservedStack(const ReservedStack&) = delete;
+		ReservedStack& operator=(const ReservedStack&) = delete;
+
+	public:
+		// Whether the reservation succeeded. If not, run() uses the calling thread, with a warning on stderr.
+		bool isReserved() const noexcept
+		{
+			return base != nullptr;
+		}
+
+		// Lowest address the stack should grow to, or 0 if not reserved or running in the calling thread.
+		std::uintptr_t getLimit() const noexcept
+		{
+			return limit;
+		}
+
+		// Runs the function in a new thread using this stack, rethrowing its exception.
+		void run(const std::function<void()>& function);
+
+	private:
+		void* base = nullptr;
+		std::size_t size = 0;
+		std::uintptr_t limit = 0;
+		// Why the reservation failed.
+		int error = 0;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_RESERVED_STACK_H
@@ -0,0 +1,90 @@
+#ifndef RINHA_INTERPRETER_RESOURCE_GOVERNOR_H
+#define RINHA_INTERPRETER_RESOURCE_GOVERNOR_H
+
+#include "./Exceptions.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace rinha::interpreter
+{
+	// Budgets of a run. 0 means unlimited.
+	struct ResourceLimits final
+	{
+		std::uint64_t maxCalls = 0;
+		// Approximate bytes of contexts, tuples and strings created or copied, not taking frees into account.
+		std::uint64_t maxAllocatedBytes = 0;
+		std::chrono::milliseconds timeout{0};
+
+		bool isUnlimited() const noexcept
+		{
+			return !maxCalls && !maxAllocatedBytes && !timeout.count();
+		}
+	};
+
+	// Enforces ResourceLimits. `check` is called once per call, so a loop (always a recursion in Rinha) can't escape
+	// it, and is cheap enough for that: two comparisons, and a clock read every CLOCK_CHECK_INTERVAL calls.
+	class ResourceGovernor final
+	{
+	public:
+		static constexpr std::uint64_t CLOCK_CHECK_INTERVAL = 1024;
+
+	public:
+		explicit ResourceGovernor(const ResourceLimits& limits)
+			: maxCalls(limits.maxCalls ? limits.maxCalls : std::numeric_limits<std::uint64_t>::max()),
+			  maxAllocatedBytes(limits.maxAllocatedBytes ? allocatedBytes + limits.maxAllocatedBytes :
+														   std::numeric_limits<std::uint64_t>::max()),
+			  hasDeadline(limits.timeout.count() != 0),
+			  deadline(std::chrono::steady_clock::now() + limits.timeout),
+			  countsAllocations(limits.maxAllocatedBytes != 0)
+		{
+			if (countsAllocations)
+				++countingGovernors;
+		}
+
+		~ResourceGovernor()
+		{
+			if (countsAllocations)
+				--countingGovernors;
+		}
+
+		ResourceGovernor(const ResourceGovernor&) = delete;
+		ResourceGovernor& operator=(const ResourceGovernor&) = delete;
+
+	public:
+		// Counts allocations of the current thread while a governor with an allocation limit exists in it. Called by
+		// the constructors of the counted objects.
+		static void countAllocation(std::size_t bytes) noexcept
+		{
+			if (countingGovernors)
+				allocatedBytes += bytes;
+		}
+
+		void check()
+		{
+			if (++calls > maxCalls)
+				throw CallLimitException("call limit exceeded");
+
+			if (allocatedBytes > maxAllocatedBytes)
+				throw AllocationLimitException("allocation limit exceeded");
+
+			if (hasDeadline && calls % CLOCK_CHECK_INTERVAL == 0 && std::chrono::steady_clock::now() > deadline)
+				throw TimeLimitException("time limit exceeded");
+		}
+
+	private:
+		// Never reset, so each governor compares against its value at construction.
+		static inline thread_local std::uint64_t allocatedBytes = 0;
+		static inline thread_local unsigned countingGovernors = 0;
+
+		const std::uint64_t maxCalls;
+		const std::uint64_t maxAllocatedBytes;
+		const bool hasDeadline;
+		const std::chrono::steady_clock::time_point deadline;
+		const bool countsAllocations;
+		std::uint64_t calls = 0;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_RESOURCE_GOVERNOR_H
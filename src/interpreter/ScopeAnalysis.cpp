@@ -0,0 +1,267 @@
+#include "./ScopeAnalysis.h"
+#include "./Exceptions.h"
+#include "./Nodes.h"
+#include "./ParallelFor.h"
+#include "./SemanticAnalysis.h"
+#include <algorithm>
+#include <cstddef>
+
+// algorithm
+namespace ranges = std::ranges;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		// Functions of the root term taken at once by a thread.
+		constexpr std::size_t CHUNK_SIZE = 64;
+	}  // namespace
+
+	ScopeAnalysis::ScopeAnalysis(const TermNode* root)
+		: ScopeAnalysis(root, SemanticAnalysis::getThreadCountFromEnvironment())
+	{
+	}
+
+	ScopeAnalysis::ScopeAnalysis(const TermNode* root, unsigned threadCount)
+	{
+		const auto& rootScope = analyzeScope(parts.emplace_back(), nullptr, nullptr, root);
+		const auto chunkCount = (rootFns.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+		for (std::size_t i = 0; i < chunkCount; ++i)
+			parts.emplace_back();
+
+		parallelForChunks(rootFns.size(), CHUNK_SIZE, threadCount,
+			[&](std::size_t chunk, std::size_t start, std::size_t end)
+			{
+				auto& part = parts[chunk + 1];
+
+				for (auto i = start; i < end; ++i)
+					analyzeScope(part, rootFns[i], &rootScope, rootFns[i]->getBody());
+			});
+
+		for (auto& part : parts)
+		{
+			for (const auto& scope : part.scopes)
+				scopes.push_back(&scope);
+
+			fnScopes.merge(part.fnScopes);
+			varCandidates.merge(part.varCandidates);
+			letSlots.merge(part.letSlots);
+		}
+	}
+
+	Scope& ScopeAnalysis::analyzeScope(Part& part, const FnNode* fnNode, const Scope* parent, const TermNode* body)
+	{
+		auto& scope = part.scopes.emplace_back();
+		scope.fnNode = fnNode;
+		scope.parent = parent;
+
+		if (fnNode)
+		{
+			part.fnScopes[fnNode] = &scope;
+
+			for (const auto parameter : fnNode->getParameters())
+			{
+				if (scope.slotsByName.contains(parameter->name))
+					throw RinhaException("Duplicate parameter '" + parameter->name + "'.");
+
+				scope.slotsByName[parameter->name] = scope.getSlotCount();
+				scope.slotNames.push_back(parameter->name);
+			}
+		}
+
+		declare(part, scope, body);
+		resolve(part, scope, body);
+
+		return scope;
+	}
+
+	void ScopeAnalysis::declare(Part& part, Scope& scope, const TermNode* node)
+	{
+		switch (node->getType())
+		{
+			case TermNode::Type::LITERAL:
+			case TermNode::Type::VAR:
+				break;
+
+			case TermNode::Type::FN:
+				// Function bodies are separate scopes, but their closures capture this one.
+				scope.capturing = true;
+				break;
+
+			case TermNode::Type::TUPLE:
+			{
+				const auto tupleNode = static_cast<const TupleNode*>(node);
+				declare(part, scope, tupleNode->first);
+				declare(part, scope, tupleNode->second);
+				break;
+			}
+
+			case TermNode::Type::CALL:
+			{
+				const auto callNode = static_cast<const CallNode*>(node);
+				declare(part, scope, callNode->callee);
+
+				for (const auto argument : callNode->arguments)
+					declare(part, scope, argument);
+
+				break;
+			}
+
+			case TermNode::Type::BINARY_OP:
+			{
+				const auto binaryOpNode = static_cast<const BinaryOpNode*>(node);
+				declare(part, scope, binaryOpNode->first);
+				declare(part, scope, binaryOpNode->second);
+				break;
+			}
+
+			case TermNode::Type::IF:
+			{
+				const auto ifNode = static_cast<const IfNode*>(node);
+				declare(part, scope, ifNode->condition);
+				declare(part, scope, ifNode->then);
+				declare(part, scope, ifNode->otherwise);
+				break;
+			}
+
+			case TermNode::Type::TUPLE_INDEX:
+				declare(part, scope, static_cast<const TupleIndexNode*>(node)->arg);
+				break;
+
+			case TermNode::Type::LET:
+			{
+				const auto letNode = static_cast<const LetNode*>(node);
+				const auto& name = letNode->reference->name;
+				unsigned slot;
+
+				if (const auto it = scope.slotsByName.find(name); it != scope.slotsByName.end())
+				{
+					slot = it->second;
+
+					if (slot < scope.getParameterCount() && ranges::find(scope.resetSlots, slot) == scope.resetSlots.end())
+						scope.resetSlots.push_back(slot);
+				}
+				else
+				{
+					slot = scope.getSlotCount();
+					scope.slotsByName[name] = slot;
+					scope.slotNames.push_back(name);
+				}
+
+				if (ranges::find(scope.letSlots, slot) == scope.letSlots.end())
+					scope.letSlots.push_back(slot);
+
+				part.letSlots[letNode] = slot;
+
+				declare(part, scope, letNode->value);
+				declare(part, scope, letNode->next);
+				break;
+			}
+
+			case TermNode::Type::PRINT:
+				declare(part, scope, static_cast<const PrintNode*>(node)->arg);
+				break;
+		}
+	}
+
+	void ScopeAnalysis::resolve(Part& part, Scope& scope, const TermNode* node)
+	{
+		switch (node->getType())
+		{
+			case TermNode::Type::LITERAL:
+				break;
+
+			case TermNode::Type::VAR:
+			{
+				const auto varNode = static_cast<const VarNode*>(node);
+				const auto& name = varNode->reference->name;
+				auto& candidates = part.varCandidates[varNode];
+				unsigned hops = 0;
+
+				for (const Scope* current = &scope; current; current = current->parent, ++hops)
+				{
+					if (const auto it = current->slotsByName.find(name); it != current->slotsByName.end())
+					{
+						candidates.push_back({hops, it->second});
+
+						// Parameters not shadowed by lets are always assigned, so outer scopes are never reached.
+						if (it->second < current->getParameterCount() &&
+							ranges::find(current->resetSlots, it->second) == current->resetSlots.end())
+						{
+							break;
+						}
+					}
+				}
+
+				break;
+			}
+
+			case TermNode::Type::FN:
+			{
+				const auto fnNode = static_cast<const FnNode*>(node);
+
+				// Those of the root term are analyzed once it's resolved.
+				if (scope.parent || scope.fnNode)
+					analyzeScope(part, fnNode, &scope, fnNode->getBody());
+				else
+					rootFns.push_back(fnNode);
+
+				break;
+			}
+
+			case TermNode::Type::TUPLE:
+			{
+				const auto tupleNode = static_cast<const TupleNode*>(node);
+				resolve(part, scope, tupleNode->first);
+				resolve(part, scope, tupleNode->second);
+				break;
+			}
+
+			case TermNode::Type::CALL:
+			{
+				const auto callNode = static_cast<const CallNode*>(node);
+				resolve(part, scope, callNode->callee);
+
+				for (const auto argument : callNode->arguments)
+					resolve(part, scope, argument);
+
+				break;
+			}
+
+			case TermNode::Type::BINARY_OP:
+			{
+				const auto binaryOpNode = static_cast<const BinaryOpNode*>(node);
+				resolve(part, scope, binaryOpNode->first);
+				resolve(part, scope, binaryOpNode->second);
+				break;
+			}
+
+			case TermNode::Type::IF:
+			{
+				const auto ifNode = static_cast<const IfNode*>(node);
+				resolve(part, scope, ifNode->condition);
+				resolve(part, scope, ifNode->then);
+				resolve(part, scope, ifNode->otherwise);
+				break;
+			}
+
+			case TermNode::Type::TUPLE_INDEX:
+				resolve(part, scope, static_cast<const TupleIndexNode*>(node)->arg);
+				break;
+
+			case TermNode::Type::LET:
+			{
+				const auto letNode = static_cast<const LetNode*>(node);
+				resolve(part, scope, letNode->value);
+				resolve(part, scope, letNode->next);
+				break;
+			}
+
+			case TermNode::Type::PRINT:
+				resolve(part, scope, static_cast<const PrintNode*>(node)->arg);
+				break;
+		}
+	}
+}  // namespace rinha::interpreter
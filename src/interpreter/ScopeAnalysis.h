@@ -0,0 +1,118 @@
+#ifndef RINHA_INTERPRETER_SCOPE_ANALYSIS_H
+#define RINHA_INTERPRETER_SCOPE_ANALYSIS_H
+
+#include "./Nodes.h"
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rinha::interpreter
+{
+	// Location of a variable relative to the scope that references it: `hops` outer contexts away, at `index`.
+	struct VarSlot final
+	{
+		unsigned hops;
+		unsigned index;
+	};
+
+	// Static layout of a function activation (or of the root term).
+	// Parameters and all lets of the body (hoisted, like TermNode::compile does) get a slot each.
+	class Scope final
+	{
+	public:
+		const FnNode* fnNode = nullptr;
+		const Scope* parent = nullptr;
+		std::vector<std::string> slotNames;
+		std::unordered_map<std::string, unsigned> slotsByName;
+		std::vector<unsigned> letSlots;
+		// Parameters shadowed by a let are reset when the body is entered, as compile() does with createVariable().
+		std::vector<unsigned> resetSlots;
+		// Whether a closure may capture this scope, requiring its activation to live in a heap Context.
+		bool capturing = false;
+
+	public:
+		unsigned getSlotCount() const noexcept
+		{
+			return (unsigned) slotNames.size();
+		}
+
+		unsigned getParameterCount() const noexcept
+		{
+			return fnNode ? (unsigned) fnNode->getParameters().size() : 0u;
+		}
+	};
+
+	// Resolves the variables of a term to slots of the scopes of its functions.
+	// Functions of the root term only depend on its scope, so they are spread across threads in chunks, each one
+	// analyzing the functions nested in those it takes. Chunks are merged in order, so the result doesn't depend on
+	// the number of threads.
+	class ScopeAnalysis final
+	{
+	private:
+		// Scopes and slots found by one thread.
+		struct Part final
+		{
+			std::deque<Scope> scopes;
+			std::unordered_map<const FnNode*, const Scope*> fnScopes;
+			std::unordered_map<const VarNode*, std::vector<VarSlot>> varCandidates;
+			std::unordered_map<const LetNode*, unsigned> letSlots;
+		};
+
+	public:
+		// With SemanticAnalysis::getThreadCountFromEnvironment() threads.
+		explicit ScopeAnalysis(const TermNode* root);
+
+		ScopeAnalysis(const TermNode* root, unsigned threadCount);
+
+		ScopeAnalysis(const ScopeAnalysis&) = delete;
+		ScopeAnalysis& operator=(const ScopeAnalysis&) = delete;
+
+	public:
+		const Scope& getRootScope() const noexcept
+		{
+			return *scopes.front();
+		}
+
+		const Scope& getScope(const FnNode* node) const
+		{
+			return *fnScopes.at(node);
+		}
+
+		// Candidate slots in lookup order. Lookup picks the first one already assigned, like Context::getVariable.
+		const std::vector<VarSlot>& getCandidates(const VarNode* node) const
+		{
+			return varCandidates.at(node);
+		}
+
+		unsigned getLetSlot(const LetNode* node) const
+		{
+			return letSlots.at(node);
+		}
+
+		// The root scope, followed by those of the functions in preorder.
+		const std::vector<const Scope*>& getScopes() const noexcept
+		{
+			return scopes;
+		}
+
+	private:
+		Scope& analyzeScope(Part& part, const FnNode* fnNode, const Scope* parent, const TermNode* body);
+		void declare(Part& part, Scope& scope, const TermNode* node);
+		void resolve(Part& part, Scope& scope, const TermNode* node);
+
+	private:
+		// The root one, and then one per chunk of functions of the root term. Never moved, as scopes point to the
+		// root one.
+		std::deque<Part> parts;
+		// Functions of the root term, collected while resolving it instead of being analyzed right away.
+		std::vector<const FnNode*> rootFns;
+
+		std::vector<const Scope*> scopes;
+		std::unordered_map<const FnNode*, const Scope*> fnScopes;
+		std::unordered_map<const VarNode*, std::vector<VarSlot>> varCandidates;
+		std::unordered_map<const LetNode*, unsigned> letSlots;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_SCOPE_ANALYSIS_H
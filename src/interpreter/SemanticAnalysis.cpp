@@ -0,0 +1,250 @@
+#include "./SemanticAnalysis.h"
+#include "./Diagnostic.h"
+#include "./Nodes.h"
+#include "./ParallelFor.h"
+#include "./ParsedSource.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// string
+using std::string;
+
+// string_view
+using std::string_view;
+
+// vector
+using std::vector;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		// Functions of the root term taken at once by a thread.
+		constexpr std::size_t CHUNK_SIZE = 64;
+
+		// Names bound by the parameters and lets of a function, or of the root term.
+		struct Scope final
+		{
+			const Scope* parent = nullptr;
+			std::unordered_set<string_view> names;
+
+			bool resolves(string_view name) const
+			{
+				for (auto scope = this; scope; scope = scope->parent)
+				{
+					if (scope->names.contains(name))
+						return true;
+				}
+
+				return false;
+			}
+		};
+
+		// Positions are found when merging, as SourcePositions sorts itself on the first lookup.
+		struct PendingDiagnostic final
+		{
+			const Node* node;
+			Diagnostic::Type type;
+			string message;
+		};
+
+		struct Result final
+		{
+			vector<PendingDiagnostic> diagnostics;
+			vector<std::pair<const FnNode*, vector<string_view>>> freeVariables;
+		};
+
+		// Declares the lets of a body in its scope and collects, in source order, its variable references and the
+		// functions directly nested in it, whose bodies are separate scopes.
+		void collect(const TermNode* body, Scope& scope, vector<const VarNode*>& vars, vector<const FnNode*>& fns)
+		{
+			vector<const TermNode*> pending{body};
+
+			while (!pending.empty())
+			{
+				const auto node = pending.back();
+				pending.pop_back();
+
+				switch (node->getType())
+				{
+					case TermNode::Type::LITERAL:
+						break;
+
+					case TermNode::Type::VAR:
+						vars.push_back(static_cast<const VarNode*>(node));
+						break;
+
+					case TermNode::Type::FN:
+						fns.push_back(static_cast<const FnNode*>(node));
+						break;
+
+					case TermNode::Type::TUPLE:
+						pending.push_back(static_cast<const TupleNode*>(node)->second);
+						pending.push_back(static_cast<const TupleNode*>(node)->first);
+						break;
+
+					case TermNode::Type::CALL:
+					{
+						const auto callNode = static_cast<const CallNode*>(node);
+						pending.insert(pending.end(), callNode->arguments.rbegin(), callNode->arguments.rend());
+						pending.push_back(callNode->callee);
+						break;
+					}
+
+					case TermNode::Type::BINARY_OP:
+						pending.push_back(static_cast<const BinaryOpNode*>(node)->second);
+						pending.push_back(static_cast<const BinaryOpNode*>(node)->first);
+						break;
+
+					case TermNode::Type::IF:
+						pending.push_back(static_cast<const IfNode*>(node)->otherwise);
+						pending.push_back(static_cast<const IfNode*>(node)->then);
+						pending.push_back(static_cast<const IfNode*>(node)->condition);
+						break;
+
+					case TermNode::Type::TUPLE_INDEX:
+						pending.push_back(static_cast<const TupleIndexNode*>(node)->arg);
+						break;
+
+					case TermNode::Type::LET:
+					{
+						const auto letNode = static_cast<const LetNode*>(node);
+						scope.names.insert(letNode->reference->name);
+						pending.push_back(letNode->next);
+						pending.push_back(letNode->value);
+						break;
+					}
+
+					case TermNode::Type::PRINT:
+						pending.push_back(static_cast<const PrintNode*>(node)->arg);
+						break;
+				}
+			}
+		}
+
+		void checkVars(const Scope& scope, const vector<const VarNode*>& vars, Result& result)
+		{
+			for (const auto varNode : vars)
+			{
+				const auto& name = varNode->reference->name;
+
+				if (!scope.resolves(name))
+				{
+					result.diagnostics.push_back(
+						{varNode, Diagnostic::Type::WARNING, "Variable '" + name + "' is not defined."});
+				}
+			}
+		}
+
+		// Returns the function's free variables, after adding them and those of its nested functions to the result.
+		vector<string_view> analyzeFn(const FnNode* fnNode, const Scope* parent, Result& result)
+		{
+			Scope scope{parent};
+
+			for (const auto parameter : fnNode->parameters)
+			{
+				if (!scope.names.insert(parameter->name).second)
+				{
+					result.diagnostics.push_back(
+						{parameter, Diagnostic::Type::ERROR, "Duplicate parameter '" + parameter->name + "'."});
+				}
+			}
+
+			vector<const VarNode*> vars;
+			vector<const FnNode*> fns;
+			collect(fnNode->body, scope, vars, fns);
+			checkVars(scope, vars, result);
+
+			vector<string_view> freeVariables;
+			std::unordered_set<string_view> seen;
+
+			const auto addFree = [&](string_view name)
+			{
+				if (!scope.names.contains(name) && parent->resolves(name) && seen.insert(name).second)
+					freeVariables.push_back(name);
+			};
+
+			for (const auto varNode : vars)
+				addFree(varNode->reference->name);
+
+			for (const auto nested : fns)
+			{
+				for (const auto name : analyzeFn(nested, &scope, result))
+					addFree(name);
+			}
+
+			result.freeVariables.emplace_back(fnNode, freeVariables);
+
+			return freeVariables;
+		}
+	}  // namespace
+
+	SemanticAnalysis::SemanticAnalysis(const ParsedSource& parsedSource, unsigned threadCount)
+		: diagnostics(make_local_shared<Diagnostics>())
+	{
+		Scope rootScope;
+		vector<const VarNode*> rootVars;
+		vector<const FnNode*> rootFns;
+		collect(parsedSource.getTerm(), rootScope, rootVars, rootFns);
+
+		Result rootResult;
+		checkVars(rootScope, rootVars, rootResult);
+
+		// One result per function of the root term, so merging them in order doesn't depend on the threads.
+		vector<Result> results(rootFns.size());
+
+		parallelForChunks(rootFns.size(), CHUNK_SIZE, threadCount,
+			[&](std::size_t, std::size_t start, std::size_t end)
+			{
+				for (auto i = start; i < end; ++i)
+					analyzeFn(rootFns[i], &rootScope, results[i]);
+			});
+
+		vector<Diagnostic> list;
+
+		const auto merge = [&](Result& result)
+		{
+			for (auto& pending : result.diagnostics)
+			{
+				const auto position = parsedSource.getPosition(pending.node).value_or(SourcePosition());
+				list.push_back({pending.type, position.line, position.column, std::move(pending.message)});
+			}
+
+			for (auto& [fnNode, names] : result.freeVariables)
+				freeVariables.emplace(fnNode, std::move(names));
+		};
+
+		merge(rootResult);
+
+		for (auto& result : results)
+			merge(result);
+
+		std::ranges::stable_sort(list,
+			[](const auto& a, const auto& b) { return std::pair(a.line, a.column) < std::pair(b.line, b.column); });
+
+		for (auto& diagnostic : list)
+			diagnostics->add(std::move(diagnostic));
+	}
+
+	unsigned SemanticAnalysis::getThreadCountFromEnvironment()
+	{
+		const auto env = std::getenv("RINHA_ANALYSIS_THREADS");
+		const auto threadCount =
+			env ? unsigned(std::strtoul(env, nullptr, 10)) : std::max(std::thread::hardware_concurrency(), 1u);
+
+		return std::max(threadCount, 1u);
+	}
+}  // namespace rinha::interpreter
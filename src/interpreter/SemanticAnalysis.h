@@ -0,0 +1,49 @@
+#ifndef RINHA_INTERPRETER_SEMANTIC_ANALYSIS_H
+#define RINHA_INTERPRETER_SEMANTIC_ANALYSIS_H
+
+#include "./Diagnostic.h"
+#include "./Nodes.h"
+#include "./ParsedSource.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace rinha::interpreter
+{
+	// Checks a parsed source without running it, for `rinha --check` and IncrementalParser: repeated parameter names
+	// are errors, and variables that no enclosing parameter or let (hoisted, like TermNode::compile does) binds are
+	// warnings, as they only fail if evaluated. Also finds the free variables of each function. It's only a lint:
+	// running a program resolves its variables with ScopeAnalysis instead.
+	//
+	// Functions of the root term don't depend on each other, so they are spread across threads, each one analyzing
+	// the functions nested in those it takes. Diagnostics are sorted by position, so they don't depend on the number
+	// of threads.
+	class SemanticAnalysis final
+	{
+	public:
+		explicit SemanticAnalysis(const ParsedSource& parsedSource, unsigned threadCount = 1);
+
+		// From RINHA_ANALYSIS_THREADS, defaulting to one per core.
+		static unsigned getThreadCountFromEnvironment();
+
+	public:
+		boost::local_shared_ptr<Diagnostics> getDiagnostics() const
+		{
+			return diagnostics;
+		}
+
+		// Names referenced in the function, including its nested ones, that it doesn't bind, in order of first
+		// reference. They are views of the names in the nodes.
+		const std::vector<std::string_view>& getFreeVariables(const FnNode* node) const
+		{
+			return freeVariables.at(node);
+		}
+
+	private:
+		boost::local_shared_ptr<Diagnostics> diagnostics;
+		std::unordered_map<const FnNode*, std::vector<std::string_view>> freeVariables;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_SEMANTIC_ANALYSIS_H
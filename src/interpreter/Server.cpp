@@ -0,0 +1,384 @@
+#include "./Server.h"
+#include "./Diagnostic.h"
+#include "./Environment.h"
+#include "./Exceptions.h"
+#include "./NativeParser.h"
+#include "./Parser.h"
+#include "./ResourceGovernor.h"
+#include "./TreeWalkerExecutionStrategy.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
+
+// boost/smart_ptr/make_local_shared
+using boost::make_local_shared;
+
+// chrono
+namespace chrono = std::chrono;
+
+// memory
+using std::make_shared;
+using std::shared_ptr;
+
+// mutex
+using std::lock_guard;
+using std::mutex;
+using std::unique_lock;
+
+// stdexcept
+using std::runtime_error;
+
+// string
+using std::string;
+
+
+namespace rinha::interpreter
+{
+	namespace
+	{
+		// Streams the output of a program to the client, buffered like BufferedEnvironment. Unlike it, it's not
+		// flushed on destruction, as sending fails once the client is gone.
+		class SocketEnvironment final : public Environment
+		{
+		public:
+			explicit SocketEnvironment(int connection, const BufferedEnvironmentOptions& options)
+				: connection(connection),
+				  options(options),
+				  lastFlush(chrono::steady_clock::now())
+			{
+				buffer.reserve(options.capacity + 256);
+			}
+
+		public:
+			void printLine(std::string_view s) override
+			{
+				buffer.append(s);
+				buffer += '\n';
+
+				if (buffer.size() >= options.capacity ||
+					(options.flushInterval.count() != 0 &&
+						chrono::steady_clock::now() - lastFlush >= options.flushInterval))
+				{
+					flush();
+				}
+			}
+
+			void write(std::string_view s)
+			{
+				buffer.append(s);
+			}
+
+			void flush()
+			{
+				for (std::size_t sent = 0; sent < buffer.size();)
+				{
+					const auto count = send(connection, buffer.data() + sent, buffer.size() - sent, MSG_NOSIGNAL);
+
+					if (count < 0)
+					{
+						if (errno == EINTR)
+							continue;
+
+						// Stops the program, as nobody is reading its output anymore.
+						throw runtime_error("Client disconnected");
+					}
+
+					sent += std::size_t(count);
+				}
+
+				buffer.clear();
+				lastFlush = chrono::steady_clock::now();
+			}
+
+		private:
+			const int connection;
+			const BufferedEnvironmentOptions options;
+			string buffer;
+			chrono::steady_clock::time_point lastFlush;
+		};
+	}  // namespace
+
+	Server::Server(const string& socketPath, const ServerOptions& options)
+		: socketPath(socketPath),
+		  options(options)
+	{
+		if (!this->options.limits.timeout.count())
+			this->options.limits.timeout = DEFAULT_TIMEOUT;
+
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+
+		if (socketPath.size() >= sizeof(address.sun_path))
+			throw runtime_error("Socket path too long: " + socketPath);
+
+		std::strcpy(address.sun_path, socketPath.c_str());
+
+		listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+		if (listener < 0)
+			throw runtime_error("Cannot create socket: " + string(std::strerror(errno)));
+
+		unlink(socketPath.c_str());
+
+		if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+			listen(listener, SOMAXCONN) != 0)
+		{
+			const auto error = string(std::strerror(errno));
+			close(listener);
+			throw runtime_error("Cannot listen on " + socketPath + ": " + error);
+		}
+	}
+
+	Server::~Server()
+	{
+		{
+			unique_lock lock(mutex);
+			connectionEnded.wait(lock, [&] { return connections == 0; });
+		}
+
+		close(listener);
+		unlink(socketPath.c_str());
+	}
+
+	void Server::run()
+	{
+		while (true)
+			serveNext();
+	}
+
+	void Server::serveNext()
+	{
+		{
+			unique_lock lock(mutex);
+			connectionEnded.wait(lock, [&] { return connections < std::max(options.maxConnections, 1u); });
+		}
+
+		int connection;
+
+		while ((connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC)) < 0)
+		{
+			if (errno != EINTR && errno != ECONNABORTED)
+				throw runtime_error("Cannot accept connection: " + string(std::strerror(errno)));
+		}
+
+		{
+			lock_guard lock(mutex);
+			++connections;
+		}
+
+		std::thread(
+			[this, connection]
+			{
+				handle(connection);
+				close(connection);
+
+				// Notified under the lock, so the destructor can't finish before this thread stops using the server.
+				lock_guard lock(mutex);
+				--connections;
+				connectionEnded.notify_all();
+			})
+			.detach();
+	}
+
+	void Server::handle(int connection)
+	{
+		const auto start = chrono::steady_clock::now();
+		SocketEnvironment environment(connection, {.flushInterval = FLUSH_INTERVAL});
+		bool failed = false;
+
+		try
+		{
+			string source;
+
+			try
+			{
+				source = readSource(connection);
+			}
+			catch (const std::exception& ex)
+			{
+				failed = true;
+				environment.write("Error: " + string(ex.what()) + "\n");
+			}
+
+			if (!failed && (source == ":stats" || source == ":stats\n"))
+			{
+				environment.write(getStats());
+				environment.flush();
+				return;
+			}
+
+			if (!failed)
+			{
+				const auto program = getProgram(source);
+				environment.write(program->diagnostics);
+
+				if (!program->parsedSource)
+					failed = true;
+				else
+				{
+					// Doesn't own the program, which the cache entry keeps alive, so copies don't touch its count.
+					const local_shared_ptr<ParsedSource> parsedSource(
+						local_shared_ptr<ParsedSource>(), program->parsedSource.get());
+					// Also doesn't own the environment, which outlives the run.
+					const local_shared_ptr<Environment> environmentPtr(
+						local_shared_ptr<Environment>(), &environment);
+
+					try
+					{
+						constexpr auto stackSize = TreeWalkerExecutionStrategy::DEFAULT_RESERVED_STACK_SIZE;
+						TreeWalkerExecutionStrategy executionStrategy(
+							{.reservedStackSize = stackSize, .limits = options.limits});
+						executionStrategy.run(environmentPtr, parsedSource);
+					}
+					catch (const std::exception& ex)
+					{
+						failed = true;
+						environment.write("Error: " + string(ex.what()) + "\n");
+					}
+				}
+			}
+
+			environment.flush();
+		}
+		catch (const std::exception&)
+		{
+			// The client went away.
+			failed = true;
+		}
+
+		const auto latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+		lock_guard lock(mutex);
+
+		++requests;
+
+		if (failed)
+			++failedRequests;
+
+		totalLatency += latency;
+		maxLatency = std::max(maxLatency, latency);
+	}
+
+	string Server::readSource(int connection) const
+	{
+		const auto timeoutUs = chrono::duration_cast<chrono::microseconds>(options.receiveTimeout).count();
+		const timeval timeout{.tv_sec = time_t(timeoutUs / 1000000), .tv_usec = suseconds_t(timeoutUs % 1000000)};
+
+		if (setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0)
+			throw runtime_error("Cannot set the receive timeout: " + string(std::strerror(errno)));
+
+		string data;
+		char buffer[64 * 1024];
+
+		while (true)
+		{
+			const auto count = recv(connection, buffer, sizeof(buffer), 0);
+
+			if (count < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				else if (errno == EAGAIN || errno == EWOULDBLOCK)
+					throw runtime_error("Timed out reading the source");
+				else
+					throw runtime_error("Cannot read the source: " + string(std::strerror(errno)));
+			}
+
+			if (count == 0)
+				return data;
+
+			if (data.size() + std::size_t(count) > options.maxSourceSize)
+				throw runtime_error("Source larger than " + std::to_string(options.maxSourceSize) + " bytes");
+
+			data.append(buffer, std::size_t(count));
+		}
+	}
+
+	shared_ptr<const Server::CachedProgram> Server::getProgram(const string& source)
+	{
+		lock_guard lock(mutex);
+
+		if (const auto it = cache.find(source); it != cache.end())
+		{
+			++cacheHits;
+			return it->second;
+		}
+
+		if (cache.size() >= MAX_CACHED_PROGRAMS)
+		{
+			cache.erase(cacheOrder.front());
+			cacheOrder.pop_front();
+		}
+
+		local_shared_ptr<ParsedSource> parsedSource;
+		local_shared_ptr<Diagnostics> diagnostics;
+
+		if (NativeParser::isSelected())
+		{
+			const NativeParser parser(source);
+			parsedSource = parser.getParsedSource();
+			diagnostics = parser.getDiagnostics();
+		}
+		else
+		{
+			const Parser parser(source);
+			parsedSource = parser.getParsedSource();
+			diagnostics = parser.getDiagnostics();
+		}
+
+		const auto program = make_shared<CachedProgram>();
+		std::ostringstream diagnosticsStream;
+
+		for (const auto& diagnostic : diagnostics->getList())
+		{
+			diagnosticsStream << "(" << diagnostic.line << ", " << diagnostic.column
+							  << "): " << (diagnostic.type == Diagnostic::Type::ERROR ? "Error" : "Warning") << ": "
+							  << diagnostic.message << "\n";
+		}
+
+		program->diagnostics = diagnosticsStream.str();
+
+		if (!diagnostics->hasError())
+			program->parsedSource = std::move(parsedSource);
+
+		cacheOrder.push_back(source);
+		cache.emplace(source, program);
+
+		return program;
+	}
+
+	string Server::getStats()
+	{
+		lock_guard lock(mutex);
+
+		const auto uptime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+		std::ostringstream stats;
+
+		stats << "requests: " << requests << "\n"
+			  << "failed requests: " << failedRequests << "\n"
+			  << "cache hits: " << cacheHits << "\n"
+			  << "cached programs: " << cache.size() << "\n"
+			  << "average latency (us): " << (requests ? totalLatency.count() / requests : 0) << "\n"
+			  << "max latency (us): " << maxLatency.count() << "\n"
+			  << "throughput (requests/s): " << (uptime > 0 ? double(requests) / uptime : 0) << "\n";
+
+		return stats.str();
+	}
+}  // namespace rinha::interpreter
@@ -0,0 +1,102 @@
+#ifndef RINHA_INTERPRETER_SERVER_H
+#define RINHA_INTERPRETER_SERVER_H
+
+#include "./ParsedSource.h"
+#include "./ResourceGovernor.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace rinha::interpreter
+{
+	struct ServerOptions final
+	{
+		// Limits of each program. Without a timeout, Server::DEFAULT_TIMEOUT is used.
+		ResourceLimits limits;
+
+		// Larger sources are rejected.
+		std::size_t maxSourceSize = std::size_t(16) << 20;
+
+		// How long reading a source may wait for more data.
+		std::chrono::milliseconds receiveTimeout{10000};
+
+		// Connections served at once. Further ones wait in the listen backlog.
+		unsigned maxConnections = 64;
+	};
+
+	// Long-running process serving programs over a Unix domain socket. A client sends the program source and shuts
+	// down its side of the connection; the server streams back what the program prints, followed by "Error: ..." if
+	// it fails. Sending ":stats" instead returns the counters.
+	// Each connection is served by its own thread, so long programs don't hold up short ones. Programs run with the
+	// tree walker under the given limits, so one that doesn't end can't take a thread forever.
+	// Parsed programs are cached by their source, and the parser's own caches stay warm between requests.
+	class Server final
+	{
+	public:
+		static constexpr std::size_t MAX_CACHED_PROGRAMS = 256;
+		static constexpr std::chrono::seconds DEFAULT_TIMEOUT{10};
+
+		// Output is buffered, but sent at least this often while a program prints.
+		static constexpr std::chrono::milliseconds FLUSH_INTERVAL{100};
+
+	private:
+		// Shared by the threads running it, so its ParsedSource's reference count, which isn't atomic, is never
+		// changed by them.
+		struct CachedProgram final
+		{
+			// Null when the source has errors.
+			boost::local_shared_ptr<ParsedSource> parsedSource;
+			std::string diagnostics;
+		};
+
+	public:
+		explicit Server(const std::string& socketPath, const ServerOptions& options = {});
+
+		// Waits for the connections being served.
+		~Server();
+
+		Server(const Server&) = delete;
+		Server& operator=(const Server&) = delete;
+
+	public:
+		[[noreturn]] void run();
+
+		// Accepts one connection and starts serving it, after waiting while maxConnections are being served.
+		void serveNext();
+
+	private:
+		void handle(int connection);
+		std::string readSource(int connection) const;
+		std::shared_ptr<const CachedProgram> getProgram(const std::string& source);
+		std::string getStats();
+
+	private:
+		const std::string socketPath;
+		ServerOptions options;
+		int listener = -1;
+
+		// Guards everything below. Parsing also happens under it, as the parsers' caches are shared.
+		std::mutex mutex;
+		std::condition_variable connectionEnded;
+		unsigned connections = 0;
+		std::unordered_map<std::string, std::shared_ptr<const CachedProgram>> cache;
+		// Sources in the order they were cached, for eviction.
+		std::deque<std::string> cacheOrder;
+
+		const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		std::uint64_t requests = 0;
+		std::uint64_t failedRequests = 0;
+		std::uint64_t cacheHits = 0;
+		std::chrono::microseconds totalLatency{0};
+		std::chrono::microseconds maxLatency{0};
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_SERVER_H
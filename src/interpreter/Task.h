@@ -2,15 +2,146 @@
 #define RINHA_INTERPRETER_TASK_H
 
 #include "./Values.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <coroutine>
+#include <cstddef>
+#include <deque>
 #include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <optional>
+#include <thread>
 #include <utility>
 #include <variant>
+#include <vector>
 
 
 namespace rinha::interpreter
 {
+	// Coroutine frame allocator: bump allocation from chunks, with a free list per size class. Frames are prefixed
+	// with the pool that allocated them (or nullptr, when allocated while no pool was active), so they can be freed
+	// from anywhere.
+	class FramePool final
+	{
+	private:
+		static constexpr std::size_t HEADER_SIZE = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+		static constexpr std::size_t GRANULARITY = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+		static constexpr std::size_t MAX_POOLED_SIZE = 2048;
+		static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+		struct FreeFrame final
+		{
+			FreeFrame* next;
+		};
+
+	public:
+		// Makes a pool current for the calling thread while in scope, then releases all its memory.
+		class Scope final
+		{
+		public:
+			explicit Scope(FramePool& pool) noexcept
+				: pool(pool),
+				  previous(std::exchange(current(), &pool))
+			{
+			}
+
+			~Scope()
+			{
+				current() = previous;
+				pool.release();
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			FramePool& pool;
+			FramePool* const previous;
+		};
+
+	public:
+		FramePool() = default;
+		FramePool(const FramePool&) = delete;
+		FramePool& operator=(const FramePool&) = delete;
+
+	public:
+		static void* allocateFrame(std::size_t size)
+		{
+			const auto pool = size <= MAX_POOLED_SIZE - HEADER_SIZE ? current() : nullptr;
+			const auto frame = pool ? pool->allocate(size + HEADER_SIZE) : ::operator new(size + HEADER_SIZE);
+
+			*static_cast<FramePool**>(frame) = pool;
+
+			return static_cast<std::byte*>(frame) + HEADER_SIZE;
+		}
+
+		static void deallocateFrame(void* pointer, std::size_t size) noexcept
+		{
+			const auto frame = static_cast<std::byte*>(pointer) - HEADER_SIZE;
+
+			if (const auto pool = *reinterpret_cast<FramePool**>(frame))
+				pool->deallocate(frame, size + HEADER_SIZE);
+			else
+				::operator delete(frame);
+		}
+
+	private:
+		static FramePool*& current() noexcept
+		{
+			thread_local FramePool* pool = nullptr;
+			return pool;
+		}
+
+		static std::size_t sizeClass(std::size_t size) noexcept
+		{
+			return (size + GRANULARITY - 1) / GRANULARITY;
+		}
+
+		void* allocate(std::size_t size)
+		{
+			auto& freeList = freeLists[sizeClass(size)];
+
+			if (const auto frame = freeList)
+			{
+				freeList = frame->next;
+				return frame;
+			}
+
+			size = sizeClass(size) * GRANULARITY;
+
+			if (std::size_t(chunkEnd - chunkPosition) < size)
+			{
+				chunks.push_back(std::make_unique<std::byte[]>(CHUNK_SIZE));
+				chunkPosition = chunks.back().get();
+				chunkEnd = chunkPosition + CHUNK_SIZE;
+			}
+
+			return std::exchange(chunkPosition, chunkPosition + size);
+		}
+
+		void deallocate(void* frame, std::size_t size) noexcept
+		{
+			auto& freeList = freeLists[sizeClass(size)];
+			freeList = new (frame) FreeFrame{freeList};
+		}
+
+		void release() noexcept
+		{
+			freeLists.fill(nullptr);
+			chunks.clear();
+			chunkPosition = chunkEnd = nullptr;
+		}
+
+	private:
+		std::array<FreeFrame*, MAX_POOLED_SIZE / GRANULARITY + 1> freeLists{};
+		std::vector<std::unique_ptr<std::byte[]>> chunks;
+		std::byte* chunkPosition = nullptr;
+		std::byte* chunkEnd = nullptr;
+	};
+
 	class Task
 	{
 	public:
@@ -33,6 +164,17 @@ namespace rinha::interpreter
 				void await_resume() noexcept { }
 			};
 
+		public:
+			static void* operator new(std::size_t size)
+			{
+				return FramePool::allocateFrame(size);
+			}
+
+			static void operator delete(void* pointer, std::size_t size) noexcept
+			{
+				FramePool::deallocateFrame(pointer, size);
+			}
+
 		public:
 			Task get_return_object() noexcept
 			{
@@ -70,7 +212,7 @@ namespace rinha::interpreter
 		public:
 			bool await_ready() noexcept
 			{
-				return false;
+				return !coroHandle;
 			}
 
 			std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
@@ -86,6 +228,9 @@ namespace rinha::interpreter
 
 			Value await_resume()
 			{
+				if (!coroHandle)
+					return std::move(readyValue.value());
+
 				const auto& promise = coroHandle.promise();
 
 				if (auto value = std::get_if<Value>(&promise.result))
@@ -97,18 +242,21 @@ namespace rinha::interpreter
 		private:
 			friend Task;
 
-			explicit Awaiter(std::coroutine_handle<Promise> coroHandle) noexcept
-				: coroHandle(coroHandle)
+			explicit Awaiter(std::coroutine_handle<Promise> coroHandle, std::optional<Value>&& readyValue) noexcept
+				: coroHandle(coroHandle),
+				  readyValue(std::move(readyValue))
 			{
 			}
 
 		private:
 			std::coroutine_handle<Promise> coroHandle;
+			std::optional<Value> readyValue;
 		};
 
 	public:
 		Task(Task&& t) noexcept
-			: coroHandle(std::exchange(t.coroHandle, {}))
+			: coroHandle(std::exchange(t.coroHandle, {})),
+			  readyValue(std::move(t.readyValue))
 		{
 		}
 
@@ -118,9 +266,15 @@ namespace rinha::interpreter
 				coroHandle.destroy();
 		}
 
+		// Task already completed with a value, so awaiting it neither allocates a frame nor suspends.
+		static Task ready(Value value) noexcept
+		{
+			return Task{std::move(value)};
+		}
+
 		Awaiter operator co_await() && noexcept
 		{
-			return Awaiter{coroHandle};
+			return Awaiter{coroHandle, std::move(readyValue)};
 		}
 
 	private:
@@ -129,8 +283,14 @@ namespace rinha::interpreter
 		{
 		}
 
+		explicit Task(Value&& value) noexcept
+			: readyValue(std::move(value))
+		{
+		}
+
 	private:
 		std::coroutine_handle<Promise> coroHandle;
+		std::optional<Value> readyValue;
 	};
 
 	class SyncWaitTask
@@ -139,6 +299,7 @@ namespace rinha::interpreter
 		class Promise
 		{
 			friend class ManualExecutor;
+			friend SyncWaitTask;
 
 		public:
 			SyncWaitTask get_return_object() noexcept
@@ -202,6 +363,17 @@ namespace rinha::interpreter
 			return coroHandle.done();
 		}
 
+		// Value of the completed task, or rethrows its exception.
+		Value getResult() const
+		{
+			const auto& promise = coroHandle.promise();
+
+			if (auto value = std::get_if<Value>(&promise.result))
+				return *value;
+
+			std::rethrow_exception(std::get<std::exception_ptr>(promise.result));
+		}
+
 	public:
 		std::coroutine_handle<Promise> coroHandle;
 	};
@@ -226,8 +398,14 @@ namespace rinha::interpreter
 			void await_suspend(std::coroutine_handle<> aContinuation) noexcept
 			{
 				continuation = aContinuation;
-				next = executor.head;
-				executor.head = this;
+
+				// FIFO, so tasks yielding with schedule() take turns.
+				if (executor.tail)
+					executor.tail->next = this;
+				else
+					executor.head = this;
+
+				executor.tail = this;
 			}
 
 			void await_resume() noexcept { }
@@ -250,18 +428,212 @@ namespace rinha::interpreter
 			{
 				auto* item = head;
 				head = item->next;
+
+				if (!head)
+					tail = nullptr;
+
 				item->continuation.resume();
 			}
 		}
 
+		// Frames allocated by tasks started while waiting come from this executor's pool, released when it returns.
 		Value syncWait(Task&& task)
 		{
+			const FramePool::Scope framePoolScope(framePool);
 			auto syncWaitTask = SyncWaitTask::start(std::move(task));
 
 			while (!syncWaitTask.done())
 				drain();
 
-			const auto& promise = syncWaitTask.coroHandle.promise();
+			return syncWaitTask.getResult();
+		}
+
+		// Runs the tasks interleaved on the calling thread, switching between them when they yield with schedule().
+		// The returned tasks are done, with their results.
+		std::vector<SyncWaitTask> syncWaitAll(std::vector<Task>&& tasks)
+		{
+			const FramePool::Scope framePoolScope(framePool);
+			std::vector<SyncWaitTask> syncWaitTasks;
+			syncWaitTasks.reserve(tasks.size());
+
+			for (auto& task : tasks)
+				syncWaitTasks.push_back(SyncWaitTask::start(std::move(task)));
+
+			drain();
+
+			return syncWaitTasks;
+		}
+
+	private:
+		ScheduleOp* head = nullptr;
+		ScheduleOp* tail = nullptr;
+		FramePool framePool;
+	};
+
+	// Runs coroutines on a fixed set of threads. Each thread has its own deque of work: it pushes and pops at the
+	// back, and idle threads steal from the front of the others.
+	class ThreadPoolExecutor
+	{
+	private:
+		struct Worker final
+		{
+			std::mutex mutex;
+			std::deque<std::coroutine_handle<>> handles;
+		};
+
+		// Task run by syncWait, notifying the waiting thread when it completes.
+		class RootTask final
+		{
+		public:
+			class Promise final
+			{
+			public:
+				class FinalAwaiter final
+				{
+				public:
+					bool await_ready() noexcept
+					{
+						return false;
+					}
+
+					void await_suspend(std::coroutine_handle<Promise> coroHandle) noexcept
+					{
+						auto& promise = coroHandle.promise();
+						std::lock_guard lock(promise.mutex);
+						promise.finished = true;
+						promise.finishedCondition.notify_all();
+					}
+
+					void await_resume() noexcept { }
+				};
+
+			public:
+				RootTask get_return_object() noexcept
+				{
+					return RootTask{std::coroutine_handle<Promise>::from_promise(*this)};
+				}
+
+				std::suspend_always initial_suspend() noexcept
+				{
+					return {};
+				}
+
+				FinalAwaiter final_suspend() noexcept
+				{
+					return {};
+				}
+
+				void return_value(Value value) noexcept
+				{
+					result = std::move(value);
+				}
+
+				void unhandled_exception() noexcept
+				{
+					result = std::current_exception();
+				}
+
+				std::variant<std::monostate, Value, std::exception_ptr> result;
+				std::mutex mutex;
+				std::condition_variable finishedCondition;
+				bool finished = false;
+			};
+
+			using promise_type = Promise;
+
+		public:
+			explicit RootTask(std::coroutine_handle<Promise> coroHandle) noexcept
+				: coroHandle(coroHandle)
+			{
+			}
+
+			RootTask(RootTask&& task) noexcept
+				: coroHandle(std::exchange(task.coroHandle, {}))
+			{
+			}
+
+			~RootTask()
+			{
+				if (coroHandle)
+					coroHandle.destroy();
+			}
+
+		public:
+			static RootTask start(Task&& task)
+			{
+				co_return co_await std::move(task);
+			}
+
+		public:
+			std::coroutine_handle<Promise> coroHandle;
+		};
+
+	public:
+		explicit ThreadPoolExecutor(unsigned threadCount)
+		{
+			for (unsigned i = 0; i < threadCount; ++i)
+				workers.push_back(std::make_unique<Worker>());
+
+			for (unsigned i = 0; i < threadCount; ++i)
+				threads.emplace_back([this, i] { work(i); });
+		}
+
+		~ThreadPoolExecutor()
+		{
+			{
+				std::lock_guard lock(sleepMutex);
+				stopping = true;
+			}
+
+			wakeUp.notify_all();
+
+			for (auto& thread : threads)
+				thread.join();
+		}
+
+		ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+		ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+
+	public:
+		// Queues the coroutine in the calling worker's deque, or spreads it over the workers when called from outside.
+		void schedule(std::coroutine_handle<> coroHandle)
+		{
+			auto& worker = currentPool == this ? *workers[currentIndex] : *workers[nextWorker++ % workers.size()];
+
+			// Counted before it's visible, so take() never makes the counter wrap.
+			++queued;
+
+			{
+				std::lock_guard lock(worker.mutex);
+				worker.handles.push_back(coroHandle);
+			}
+
+			{
+				// Pairs with the predicate check in work(), so the notification is not lost.
+				std::lock_guard lock(sleepMutex);
+			}
+
+			wakeUp.notify_one();
+		}
+
+		// Whether there's less queued work than threads, so forking more is worthwhile.
+		bool isHungry() const noexcept
+		{
+			return queued.load(std::memory_order_relaxed) < workers.size();
+		}
+
+		// Runs the task in the pool, blocking the calling thread until it completes.
+		Value syncWait(Task&& task)
+		{
+			auto rootTask = RootTask::start(std::move(task));
+			auto& promise = rootTask.coroHandle.promise();
+
+			schedule(rootTask.coroHandle);
+
+			{
+				std::unique_lock lock(promise.mutex);
+				promise.finishedCondition.wait(lock, [&] { return promise.finished; });
+			}
 
 			if (auto value = std::get_if<Value>(&promise.result))
 				return *value;
@@ -270,7 +642,220 @@ namespace rinha::interpreter
 		}
 
 	private:
-		ScheduleOp* head = nullptr;
+		void work(unsigned index)
+		{
+			currentPool = this;
+			currentIndex = index;
+
+			while (true)
+			{
+				if (const auto coroHandle = take(index))
+				{
+					coroHandle.resume();
+					continue;
+				}
+
+				std::unique_lock lock(sleepMutex);
+				wakeUp.wait(lock, [&] { return stopping || queued.load() != 0; });
+
+				if (stopping)
+					return;
+			}
+		}
+
+		std::coroutine_handle<> take(unsigned index)
+		{
+			for (unsigned i = 0; i < workers.size(); ++i)
+			{
+				auto& worker = *workers[(index + i) % workers.size()];
+				std::lock_guard lock(worker.mutex);
+
+				if (worker.handles.empty())
+					continue;
+
+				std::coroutine_handle<> coroHandle;
+
+				if (i == 0)
+				{
+					coroHandle = worker.handles.back();
+					worker.handles.pop_back();
+				}
+				else
+				{
+					coroHandle = worker.handles.front();
+					worker.handles.pop_front();
+				}
+
+				--queued;
+				return coroHandle;
+			}
+
+			return {};
+		}
+
+	private:
+		static inline thread_local ThreadPoolExecutor* currentPool = nullptr;
+		static inline thread_local unsigned currentIndex = 0;
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::vector<std::thread> threads;
+		std::atomic<unsigned> queued = 0;
+		std::atomic<unsigned> nextWorker = 0;
+		std::mutex sleepMutex;
+		std::condition_variable wakeUp;
+		bool stopping = false;
+	};
+
+	// Awaits several tasks at once: the first one runs in the awaiting thread and the others are scheduled in the
+	// pool. Results are returned in order, each being the value or the exception of its task. When a task fails,
+	// the given flag is set, so the others can stop early instead of being waited for until they end.
+	class WhenAll
+	{
+	public:
+		using Result = std::variant<Value, std::exception_ptr>;
+
+	private:
+		class Child final
+		{
+		public:
+			class Promise final
+			{
+			public:
+				class FinalAwaiter final
+				{
+				public:
+					bool await_ready() noexcept
+					{
+						return false;
+					}
+
+					// The last child to complete resumes the awaiting coroutine.
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> coroHandle) noexcept
+					{
+						const auto whenAll = coroHandle.promise().whenAll;
+
+						if (whenAll->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+							return whenAll->continuation;
+
+						return std::noop_coroutine();
+					}
+
+					void await_resume() noexcept { }
+				};
+
+			public:
+				Child get_return_object() noexcept
+				{
+					return Child{std::coroutine_handle<Promise>::from_promise(*this)};
+				}
+
+				std::suspend_always initial_suspend() noexcept
+				{
+					return {};
+				}
+
+				FinalAwaiter final_suspend() noexcept
+				{
+					return {};
+				}
+
+				void return_value(Value value) noexcept
+				{
+					result = std::move(value);
+				}
+
+				void unhandled_exception() noexcept
+				{
+					result = std::current_exception();
+
+					if (whenAll->cancelled)
+						whenAll->cancelled->store(true, std::memory_order_relaxed);
+				}
+
+				WhenAll* whenAll = nullptr;
+				Result result = std::exception_ptr();
+			};
+
+			using promise_type = Promise;
+
+		public:
+			explicit Child(std::coroutine_handle<Promise> coroHandle) noexcept
+				: coroHandle(coroHandle)
+			{
+			}
+
+			Child(Child&& child) noexcept
+				: coroHandle(std::exchange(child.coroHandle, {}))
+			{
+			}
+
+			~Child()
+			{
+				if (coroHandle)
+					coroHandle.destroy();
+			}
+
+		public:
+			static Child start(Task task)
+			{
+				co_return co_await std::move(task);
+			}
+
+		public:
+			std::coroutine_handle<Promise> coroHandle;
+		};
+
+	public:
+		WhenAll(ThreadPoolExecutor& executor, std::vector<Task>&& tasks, std::atomic<bool>* cancelled = nullptr)
+			: executor(executor),
+			  cancelled(cancelled)
+		{
+			children.reserve(tasks.size());
+
+			for (auto& task : tasks)
+				children.push_back(Child::start(std::move(task)));
+		}
+
+		WhenAll(const WhenAll&) = delete;
+		WhenAll& operator=(const WhenAll&) = delete;
+
+	public:
+		bool await_ready() noexcept
+		{
+			return children.empty();
+		}
+
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> aContinuation) noexcept
+		{
+			continuation = aContinuation;
+			remaining.store(children.size(), std::memory_order_relaxed);
+
+			for (auto& child : children)
+				child.coroHandle.promise().whenAll = this;
+
+			for (std::size_t i = 1; i < children.size(); ++i)
+				executor.schedule(children[i].coroHandle);
+
+			return children[0].coroHandle;
+		}
+
+		std::vector<Result> await_resume()
+		{
+			std::vector<Result> results;
+			results.reserve(children.size());
+
+			for (auto& child : children)
+				results.push_back(std::move(child.coroHandle.promise().result));
+
+			return results;
+		}
+
+	private:
+		ThreadPoolExecutor& executor;
+		std::atomic<bool>* const cancelled;
+		std::vector<Child> children;
+		std::coroutine_handle<> continuation;
+		std::atomic<std::size_t> remaining = 0;
 	};
 }  // namespace rinha::interpreter
 
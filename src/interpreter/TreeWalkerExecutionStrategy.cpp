@@ -1,42 +1,72 @@
 #include "./TreeWalkerExecutionStrategy.h"
+#include "./ClosureCompiler.h"
+#include "./CoroutineExecutionStrategy.h"
 #include "./Environment.h"
 #include "./Nodes.h"
 #include "./ParsedSource.h"
-#include "./Runtime.h"
-#include "./TermNodeVisitor.h"
+#include "./ReservedStack.h"
+#include "./ResourceGovernor.h"
+#include "./ScopeAnalysis.h"
+#include "./ValueTermNodeVisitor.h"
 #include "./Values.h"
 #include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 // boost/smart_ptr/local_shared_ptr
 using boost::local_shared_ptr;
 
+// memory
+using std::make_unique;
+using std::unique_ptr;
+
+// vector
+using std::vector;
+
 
 namespace rinha::interpreter
 {
 	namespace
 	{
-		class TreeWalkerExecuteVisitor final : public TermNodeVisitor<TreeWalkerExecuteVisitor, Value>
+		// Calls after which a function is promoted from the tree walker to the closure compiler, when tiered.
+		constexpr unsigned TIER_UP_THRESHOLD = 100;
+
+		// State of tiered execution. Contexts are slot-based but accessible by name, so closures can be called by
+		// either tier. Once a function is hot, the whole program is compiled, and its calls go to compiled code.
+		struct Tiering final
+		{
+			const TermNode* root;
+			unique_ptr<ScopeAnalysis> scopeAnalysis;
+			const ScopeAnalysis* scopes;
+			std::unordered_map<const FnNode*, unsigned> callCounts;
+			unique_ptr<ClosureProgram> program;
+		};
+
+		class TreeWalkerExecuteVisitor final : public ValueTermNodeVisitor<TreeWalkerExecuteVisitor>
 		{
 		public:
-			Value visitLiteralNode(boost::local_shared_ptr<Context>& context, const LiteralNode* node)
+			explicit TreeWalkerExecuteVisitor(
+				Tiering* tiering, std::uintptr_t stackLimit, unsigned coroutineDepth, ResourceGovernor* governor)
+				: tiering(tiering),
+				  stackLimit(stackLimit),
+				  coroutineDepth(coroutineDepth),
+				  governor(governor)
 			{
-				return node->value;
 			}
 
-			Value visitTupleNode(boost::local_shared_ptr<Context>& context, const TupleNode* node)
+		public:
+			Value visitCallNode(boost::local_shared_ptr<Context>& context, const CallNode* node)
 			{
-				const auto& firstValue = visit(context, node->first);
-				const auto& secondValue = visit(context, node->second);
-				return TupleValue(firstValue, secondValue);
-			}
+				// Checked before the guard page is reached, as a segmentation fault can't be turned into an exception.
+				if ((std::uintptr_t) __builtin_frame_address(0) < stackLimit)
+					throw RinhaException("stack depth exceeded");
 
-			Value visitFnNode(boost::local_shared_ptr<Context>& context, const FnNode* node)
-			{
-				return FnValue(node, context);
-			}
+				if (governor)
+					governor->check();
 
-			Value visitCallNode(boost::local_shared_ptr<Context>& context, const CallNode* node)
-			{
 				const auto& calleeValue = visit(context, node->callee);
 
 				if (const auto calleeValueFn = std::get_if<FnValue>(&calleeValue))
@@ -46,7 +76,15 @@ namespace rinha::interpreter
 					if (fnNode->getParameters().size() != node->arguments.size())
 						throw RinhaException("Arguments and parameters count do not match.");
 
-					auto calleeContext = boost::make_local_shared<Context>(calleeValueFn->getContext());
+					if (tiering)
+					{
+						if (auto& callCount = tiering->callCounts[fnNode]; callCount > TIER_UP_THRESHOLD)
+							return callCompiled(context, *calleeValueFn, node);
+						else
+							++callCount;
+					}
+
+					auto calleeContext = createContext(calleeValueFn->getContext(), fnNode);
 					auto argumentIt = node->arguments.begin();
 
 					for (const auto parameter : fnNode->getParameters())
@@ -58,77 +96,105 @@ namespace rinha::interpreter
 
 					fnNode->getBody()->compile(calleeContext);
 
-					return visit(calleeContext, fnNode->getBody());
+					if (coroutineDepth && depth >= coroutineDepth)
+					{
+						return CoroutineExecutionStrategy::evaluate(
+							std::move(calleeContext), fnNode->getBody(), governor);
+					}
+
+					++depth;
+					auto result = visit(calleeContext, fnNode->getBody());
+					--depth;
+
+					return result;
 				}
 
 				throw RinhaException("Cannot call a non-function.");
 			}
 
-			Value visitBinaryOpNode(boost::local_shared_ptr<Context>& context, const BinaryOpNode* node)
+		private:
+			local_shared_ptr<Context> createContext(local_shared_ptr<Context> outer, const FnNode* fnNode)
 			{
-				const auto& firstValue = visit(context, node->first);
-				const auto& secondValue = visit(context, node->second);
+				if (!tiering)
+					return boost::make_local_shared<Context>(std::move(outer));
 
-				return Runtime::binaryOp(node->op, firstValue, secondValue);
+				const auto& scope = tiering->scopes->getScope(fnNode);
+				return boost::make_local_shared<Context>(std::move(outer), scope.getSlotCount(), &scope.slotsByName);
 			}
 
-			Value visitIfNode(boost::local_shared_ptr<Context>& context, const IfNode* node)
+			Value callCompiled(local_shared_ptr<Context>& context, const FnValue& callee, const CallNode* node)
 			{
-				const auto& conditionValue = visit(context, node->condition);
-
-				if (const auto conditionValueBool = std::get_if<BoolValue>(&conditionValue))
+				if (!tiering->program)
 				{
-					if (conditionValueBool->getValue())
-						return visit(context, node->then);
-					else
-						return visit(context, node->otherwise);
+					tiering->program = ClosureCompiler::compile(tiering->root, std::move(tiering->scopeAnalysis));
+					tiering->program->governor = governor;
+					tiering->program->stackLimit = stackLimit;
 				}
 
-				throw RinhaException("Invalid datatype in if.");
-			}
-
-			Value visitTupleIndexNode(boost::local_shared_ptr<Context>& context, const TupleIndexNode* node)
-			{
-				const auto& value = visit(context, node->arg);
+				vector<Value> arguments;
+				arguments.reserve(node->arguments.size());
 
-				if (const auto conditionValueTuple = std::get_if<TupleValue>(&value))
-					return node->index == 0 ? conditionValueTuple->getFirst() : conditionValueTuple->getSecond();
+				for (const auto argument : node->arguments)
+					arguments.push_back(visit(context, argument));
 
-				throw RinhaException("Invalid datatype in tuple function.");
+				return tiering->program->call(callee, arguments, context->getEnvironment().get());
 			}
 
-			Value visitVarNode(boost::local_shared_ptr<Context>& context, const VarNode* node)
-			{
-				return context->getVariable(node->reference->name);
-			}
-
-			Value visitLetNode(boost::local_shared_ptr<Context>& context, const LetNode* node)
-			{
-				context->setVariable(node->reference->name, visit(context, node->value));
+		private:
+			Tiering* const tiering;
+			// Lowest address of the native stack the visitor may use, or 0 for no limit.
+			const std::uintptr_t stackLimit;
+			// Call depth after which bodies are evaluated by the coroutine strategy, or 0 to never switch.
+			const unsigned coroutineDepth;
+			unsigned depth = 0;
+			// Null when running without limits.
+			ResourceGovernor* const governor;
+		};
+	}  // namespace
 
-				return visit(context, node->next);
-			}
+	Value TreeWalkerExecutionStrategy::run(
+		local_shared_ptr<Environment> environment, local_shared_ptr<ParsedSource> parsedSource)
+	{
+		if (!options.reservedStackSize)
+			return run(std::move(environment), parsedSource->getTerm(), 0);
 
-			Value visitPrintNode(boost::local_shared_ptr<Context>& context, const PrintNode* node)
-			{
-				const auto& value = visit(context, node->arg);
+		ReservedStack stack(options.reservedStackSize);
+		std::optional<Value> result;
 
-				std::visit([&](auto&& arg) { context->getEnvironment()->printLine(arg.toString()); }, value);
+		stack.run([&] { result = run(std::move(environment), parsedSource->getTerm(), stack.getLimit()); });
 
-				return value;
-			}
-		};
-	}  // namespace
+		return std::move(result.value());
+	}
 
 	Value TreeWalkerExecutionStrategy::run(
-		local_shared_ptr<Environment> environment, local_shared_ptr<ParsedSource> parsedSource)
+		local_shared_ptr<Environment> environment, const TermNode* term, std::uintptr_t stackLimit)
 	{
-		const auto term = parsedSource->getTerm();
+		// Created in the thread running the program, whose allocations it counts.
+		std::optional<ResourceGovernor> governor;
+
+		if (!options.limits.isUnlimited())
+			governor.emplace(options.limits);
+
+		const auto governorPtr = governor ? &governor.value() : nullptr;
+
+		if (options.tiered)
+		{
+			Tiering tiering{term, make_unique<ScopeAnalysis>(term)};
+			tiering.scopes = tiering.scopeAnalysis.get();
+
+			const auto& rootScope = tiering.scopes->getRootScope();
+			auto context = make_local_shared<Context>(environment, rootScope.getSlotCount(), &rootScope.slotsByName);
+			term->compile(context);
+
+			TreeWalkerExecuteVisitor visitor(&tiering, stackLimit, 0, governorPtr);
+
+			return visitor.visit(context, term);
+		}
 
 		auto context = make_local_shared<Context>(environment);
 		term->compile(context);
 
-		TreeWalkerExecuteVisitor visitor;
+		TreeWalkerExecuteVisitor visitor(nullptr, stackLimit, options.coroutineDepth, governorPtr);
 
 		return visitor.visit(context, term);
 	}
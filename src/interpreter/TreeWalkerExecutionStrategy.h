@@ -2,14 +2,55 @@
 #define RINHA_INTERPRETER_TREE_WALKER_EXECUTION_STRATEGY_H
 
 #include "./ExecutionStrategy.h"
+#include "./Nodes.h"
+#include "./ResourceGovernor.h"
+#include <cstddef>
+#include <cstdint>
 
 namespace rinha::interpreter
 {
+	struct TreeWalkerOptions final
+	{
+		// Each function is interpreted until it gets hot, and is then run by the closure compiler.
+		bool tiered = false;
+
+		// When not 0, the program runs in a thread with a stack of this size, and recursing past it fails with
+		// "stack depth exceeded".
+		std::size_t reservedStackSize = 0;
+
+		// When not 0, calls nested deeper than this run their body with the coroutine strategy, which doesn't use the
+		// native stack. Ignored when tiered.
+		unsigned coroutineDepth = 0;
+
+		// Checked on each call, including those made by compiled code (when tiered) and by coroutines (past
+		// coroutineDepth).
+		ResourceLimits limits;
+	};
+
 	class TreeWalkerExecutionStrategy final : public ExecutionStrategy
 	{
+	public:
+		// Reservation used by default: address space only, committed as the recursion gets deeper.
+		static constexpr std::size_t DEFAULT_RESERVED_STACK_SIZE = std::size_t(32) << 30;
+
+		// Call depth after which the hybrid strategy switches to coroutines, well within an 8 MB native stack.
+		static constexpr unsigned DEFAULT_COROUTINE_DEPTH = 1000;
+
+	public:
+		explicit TreeWalkerExecutionStrategy(const TreeWalkerOptions& options = {})
+			: options(options)
+		{
+		}
+
 	public:
 		Value run(boost::local_shared_ptr<Environment> environment,
 			boost::local_shared_ptr<ParsedSource> parsedSource) override;
+
+	private:
+		Value run(boost::local_shared_ptr<Environment> environment, const TermNode* term, std::uintptr_t stackLimit);
+
+	private:
+		const TreeWalkerOptions options;
 	};
 }  // namespace rinha::interpreter
 
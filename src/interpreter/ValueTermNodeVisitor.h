@@ -0,0 +1,95 @@
+#ifndef RINHA_INTERPRETER_VALUE_TERM_NODE_VISITOR_H
+#define RINHA_INTERPRETER_VALUE_TERM_NODE_VISITOR_H
+
+#include "./Context.h"
+#include "./Environment.h"
+#include "./Exceptions.h"
+#include "./Nodes.h"
+#include "./Runtime.h"
+#include "./TermNodeVisitor.h"
+#include "./Values.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
+#include <variant>
+
+namespace rinha::interpreter
+{
+	// Node handlers shared by the visitors that evaluate terms recursively to a Value. Only calls differ between
+	// them, so `This` implements visitCallNode.
+	template <typename This>
+	class ValueTermNodeVisitor : public TermNodeVisitor<This, Value>
+	{
+	public:
+		Value visitLiteralNode(boost::local_shared_ptr<Context>& context, const LiteralNode* node)
+		{
+			return node->value;
+		}
+
+		Value visitTupleNode(boost::local_shared_ptr<Context>& context, const TupleNode* node)
+		{
+			const auto& firstValue = this->visit(context, node->first);
+			const auto& secondValue = this->visit(context, node->second);
+			return TupleValue(firstValue, secondValue);
+		}
+
+		Value visitFnNode(boost::local_shared_ptr<Context>& context, const FnNode* node)
+		{
+			return FnValue(node, context);
+		}
+
+		Value visitBinaryOpNode(boost::local_shared_ptr<Context>& context, const BinaryOpNode* node)
+		{
+			const auto& firstValue = this->visit(context, node->first);
+			const auto& secondValue = this->visit(context, node->second);
+
+			return Runtime::binaryOp(node->op, firstValue, secondValue);
+		}
+
+		Value visitIfNode(boost::local_shared_ptr<Context>& context, const IfNode* node)
+		{
+			const auto& conditionValue = this->visit(context, node->condition);
+
+			if (const auto conditionValueBool = std::get_if<BoolValue>(&conditionValue))
+			{
+				if (conditionValueBool->getValue())
+					return this->visit(context, node->then);
+				else
+					return this->visit(context, node->otherwise);
+			}
+
+			throw RinhaException("Invalid datatype in if.");
+		}
+
+		Value visitTupleIndexNode(boost::local_shared_ptr<Context>& context, const TupleIndexNode* node)
+		{
+			const auto& value = this->visit(context, node->arg);
+
+			if (const auto conditionValueTuple = std::get_if<TupleValue>(&value))
+				return node->index == 0 ? conditionValueTuple->getFirst() : conditionValueTuple->getSecond();
+
+			throw RinhaException("Invalid datatype in tuple function.");
+		}
+
+		Value visitVarNode(boost::local_shared_ptr<Context>& context, const VarNode* node)
+		{
+			return context->getVariable(node->reference->name);
+		}
+
+		Value visitLetNode(boost::local_shared_ptr<Context>& context, const LetNode* node)
+		{
+			context->setVariable(node->reference->name, this->visit(context, node->value));
+
+			return this->visit(context, node->next);
+		}
+
+		Value visitPrintNode(boost::local_shared_ptr<Context>& context, const PrintNode* node)
+		{
+			const auto& value = this->visit(context, node->arg);
+
+			context->getEnvironment()->print(value);
+
+			return value;
+		}
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_VALUE_TERM_NODE_VISITOR_H
@@ -1,6 +1,7 @@
 #ifndef RINHA_INTERPRETER_VALUES_H
 #define RINHA_INTERPRETER_VALUES_H
 
+#include "./ResourceGovernor.h"
 #include <boost/smart_ptr/local_shared_ptr.hpp>
 #include <boost/smart_ptr/make_local_shared.hpp>
 #include <cstdint>
@@ -66,14 +67,34 @@ namespace rinha::interpreter
 		explicit StrValue(std::string&& value) noexcept
 			: value(std::move(value))
 		{
+			ResourceGovernor::countAllocation(this->value.size());
 		}
 
 		explicit StrValue(const std::string& value)
 			: value(value)
 		{
+			ResourceGovernor::countAllocation(value.size());
 		}
 
-		auto getValue() const noexcept
+		// Copies are counted too, as each variable lookup or argument copies the string.
+		StrValue(const StrValue& other)
+			: value(other.value)
+		{
+			ResourceGovernor::countAllocation(value.size());
+		}
+
+		StrValue(StrValue&& other) noexcept = default;
+
+		StrValue& operator=(const StrValue& other)
+		{
+			value = other.value;
+			ResourceGovernor::countAllocation(value.size());
+			return *this;
+		}
+
+		StrValue& operator=(StrValue&& other) noexcept = default;
+
+		const std::string& getValue() const noexcept
 		{
 			return value;
 		}
@@ -123,20 +144,22 @@ namespace rinha::interpreter
 			: first(boost::make_local_shared<Value>(std::move(first))),
 			  second(boost::make_local_shared<Value>(std::move(second)))
 		{
+			ResourceGovernor::countAllocation(2 * sizeof(Value));
 		}
 
 		explicit TupleValue(const Value& first, const Value& second)
 			: first(boost::make_local_shared<Value>(first)),
 			  second(boost::make_local_shared<Value>(second))
 		{
+			ResourceGovernor::countAllocation(2 * sizeof(Value));
 		}
 
-		auto getFirst() const noexcept
+		const Value& getFirst() const noexcept
 		{
 			return *first;
 		}
 
-		auto getSecond() const noexcept
+		const Value& getSecond() const noexcept
 		{
 			return *second;
 		}
@@ -0,0 +1,241 @@
+#ifndef RINHA_INTERPRETER_X86_ASSEMBLER_H
+#define RINHA_INTERPRETER_X86_ASSEMBLER_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+namespace rinha::interpreter
+{
+	// Minimal x86-64 encoder with just the instructions the JIT needs.
+	// Values are computed in eax (32-bit operations wrap like the interpreter's int32_t), with ecx as scratch.
+	class X86Assembler final
+	{
+	public:
+		class Label final
+		{
+		private:
+			friend X86Assembler;
+
+			int32_t position = -1;
+			std::vector<uint32_t> fixups;
+		};
+
+		enum class Condition : uint8_t
+		{
+			BELOW = 0x2,
+			EQUAL = 0x4,
+			NOT_EQUAL = 0x5,
+			LESS = 0xC,
+			GREATER_EQUAL = 0xD,
+			LESS_EQUAL = 0xE,
+			GREATER = 0xF
+		};
+
+	public:
+		const auto& getCode() const noexcept
+		{
+			return code;
+		}
+
+		void bind(Label& label)
+		{
+			assert(label.position < 0);
+			label.position = (int32_t) code.size();
+
+			for (const auto fixup : label.fixups)
+				patch32(fixup, label.position - (int32_t) (fixup + 4));
+		}
+
+		// Prologue of the entry trampoline: save callee-saved registers, keep rsp in rbx for bail outs and the
+		// native stack limit (rsi) in r12.
+		void enterTrampoline()
+		{
+			emit({0x53, 0x55, 0x41, 0x54});  // push rbx; push rbp; push r12
+			emit({0x48, 0x89, 0xE3});  // mov rbx, rsp
+			emit({0x49, 0x89, 0xF4});  // mov r12, rsi
+		}
+
+		// Restore rsp from rbx and return to the C++ caller, with edx as the status.
+		void leaveTrampoline(bool bailOut)
+		{
+			if (bailOut)
+				emit({0xBA, 0x01, 0x00, 0x00, 0x00});  // mov edx, 1
+			else
+				emit({0x31, 0xD2});  // xor edx, edx
+
+			emit({0x48, 0x89, 0xDC});  // mov rsp, rbx
+			emit({0x41, 0x5C, 0x5D, 0x5B, 0xC3});  // pop r12; pop rbp; pop rbx; ret
+		}
+
+		void pushArgumentFromRdi(uint32_t index)
+		{
+			emit({0xFF, 0xB7});  // push qword [rdi + disp32]
+			emit32(index * 8);
+		}
+
+		void enterFunction(Label& stackOverflow, uint32_t localsSize)
+		{
+			emit({0x55, 0x48, 0x89, 0xE5});  // push rbp; mov rbp, rsp
+			emit({0x4C, 0x39, 0xE4});  // cmp rsp, r12
+			jump(Condition::BELOW, stackOverflow);
+
+			if (localsSize)
+			{
+				emit({0x48, 0x81, 0xEC});  // sub rsp, imm32
+				emit32(localsSize);
+			}
+		}
+
+		void leaveFunction()
+		{
+			emit({0x48, 0x89, 0xEC, 0x5D, 0xC3});  // mov rsp, rbp; pop rbp; ret
+		}
+
+		void loadImmediate(int32_t value)
+		{
+			emit({0xB8});  // mov eax, imm32
+			emit32((uint32_t) value);
+		}
+
+		void loadFrame(int32_t offset)
+		{
+			emit({0x48, 0x8B, 0x85});  // mov rax, [rbp + disp32]
+			emit32((uint32_t) offset);
+		}
+
+		void storeFrame(int32_t offset)
+		{
+			emit({0x48, 0x89, 0x85});  // mov [rbp + disp32], rax
+			emit32((uint32_t) offset);
+		}
+
+		void pushResult()
+		{
+			emit({0x50});  // push rax
+		}
+
+		// Moves the result to ecx and restores the previously pushed value to eax.
+		void popFirstOperand()
+		{
+			emit({0x89, 0xC1, 0x58});  // mov ecx, eax; pop rax
+		}
+
+		void dropStack(uint32_t size)
+		{
+			emit({0x48, 0x81, 0xC4});  // add rsp, imm32
+			emit32(size);
+		}
+
+		void add()
+		{
+			emit({0x01, 0xC8});  // add eax, ecx
+		}
+
+		void sub()
+		{
+			emit({0x29, 0xC8});  // sub eax, ecx
+		}
+
+		void mul()
+		{
+			emit({0x0F, 0xAF, 0xC1});  // imul eax, ecx
+		}
+
+		void bitwiseAnd()
+		{
+			emit({0x21, 0xC8});  // and eax, ecx
+		}
+
+		void bitwiseOr()
+		{
+			emit({0x09, 0xC8});  // or eax, ecx
+		}
+
+		// Division that jumps to `trap` for the operands that make idiv fault.
+		void divide(Label& trap, bool remainder)
+		{
+			Label safe;
+
+			emit({0x85, 0xC9});  // test ecx, ecx
+			jump(Condition::EQUAL, trap);
+			emit({0x83, 0xF9, 0xFF});  // cmp ecx, -1
+			jump(Condition::NOT_EQUAL, safe);
+			emit({0x3D});  // cmp eax, imm32
+			emit32(0x80000000u);
+			jump(Condition::EQUAL, trap);
+			bind(safe);
+			emit({0x99, 0xF7, 0xF9});  // cdq; idiv ecx
+
+			if (remainder)
+				emit({0x89, 0xD0});  // mov eax, edx
+		}
+
+		void compare(Condition condition)
+		{
+			emit({0x39, 0xC8});  // cmp eax, ecx
+			emit({0x0F, uint8_t(0x90 | uint8_t(condition)), 0xC0});  // setcc al
+			emit({0x0F, 0xB6, 0xC0});  // movzx eax, al
+		}
+
+		void jumpIfZero(Label& label)
+		{
+			emit({0x85, 0xC0});  // test eax, eax
+			jump(Condition::EQUAL, label);
+		}
+
+		void jump(Condition condition, Label& label)
+		{
+			emit({0x0F, uint8_t(0x80 | uint8_t(condition))});  // jcc rel32
+			emitLabel(label);
+		}
+
+		void jump(Label& label)
+		{
+			emit({0xE9});  // jmp rel32
+			emitLabel(label);
+		}
+
+		void call(Label& label)
+		{
+			emit({0xE8});  // call rel32
+			emitLabel(label);
+		}
+
+	private:
+		void emit(std::initializer_list<uint8_t> bytes)
+		{
+			code.insert(code.end(), bytes);
+		}
+
+		void emit32(uint32_t value)
+		{
+			const auto position = code.size();
+			code.resize(position + 4);
+			memcpy(&code[position], &value, 4);
+		}
+
+		void patch32(uint32_t position, int32_t value)
+		{
+			memcpy(&code[position], &value, 4);
+		}
+
+		void emitLabel(Label& label)
+		{
+			const auto position = (uint32_t) code.size();
+			emit32(0);
+
+			if (label.position >= 0)
+				patch32(position, label.position - (int32_t) (position + 4));
+			else
+				label.fixups.push_back(position);
+		}
+
+	private:
+		std::vector<uint8_t> code;
+	};
+}  // namespace rinha::interpreter
+
+#endif  // RINHA_INTERPRETER_X86_ASSEMBLER_H
@@ -1,15 +1,44 @@
+#include "./CppGenerator.h"
 #include "./Environment.h"
 #include "./EnvVarExecutionStrategy.h"
+#include "./JsonAstLoader.h"
+#include "./MappedFile.h"
+#include "./NativeParser.h"
 #include "./ParsedSource.h"
 #include "./Parser.h"
+#include "./ProgramCache.h"
+#include "./SemanticAnalysis.h"
+#include "./Server.h"
+#include <boost/smart_ptr/local_shared_ptr.hpp>
 #include <boost/smart_ptr/make_local_shared.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <optional>
 #include <ostream>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#ifndef RINHA_AOT_CXXFLAGS
+#define RINHA_AOT_CXXFLAGS ""
+#endif
+
+// boost/smart_ptr/local_shared_ptr
+using boost::local_shared_ptr;
 
 // boost/smart_ptr/make_local_shared
 using boost::make_local_shared;
@@ -21,45 +50,340 @@ using std::exception;
 namespace fs = std::filesystem;
 
 // fostream
-using std::ifstream;
+using std::ofstream;
 
 // iostream
 using std::cerr;
 using std::cout;
 
+// optional
+using std::optional;
+
 // ostream
 using std::endl;
+using std::ostream;
+
+// sstream
+using std::ostringstream;
 
 // stdexcept
 using std::runtime_error;
 
+// string
+using std::string;
+
+// vector
+using std::vector;
+
 
 namespace rinha::interpreter
 {
-	static int run(const fs::path& file)
+	// Collects the output of a program, for batch mode.
+	class BufferEnvironment final : public Environment
+	{
+	public:
+		void printLine(std::string_view s) override
+		{
+			output += s;
+			output += '\n';
+		}
+
+		const auto& getOutput() const noexcept
+		{
+			return output;
+		}
+
+	private:
+		string output;
+	};
+
+	static void printDiagnostics(const Diagnostics& diagnostics, ostream& stream)
+	{
+		for (const auto& diagnostic : diagnostics.getList())
+		{
+			stream << "(" << diagnostic.line << ", " << diagnostic.column
+				   << "): " << (diagnostic.type == Diagnostic::Type::ERROR ? "Error" : "Warning") << ": "
+				   << diagnostic.message << endl;
+		}
+	}
+
+	static local_shared_ptr<ParsedSource> parse(const fs::path& file, ostream& diagnosticsStream = cout)
 	{
-		ifstream stream(file);
+		const MappedFile mappedFile(file);
+		const auto source = mappedFile.getData();
+		const auto cache = ProgramCache::fromEnvironment();
+		const auto isJsonAst = file.extension() == ".json";
+		const auto sourceFormat = isJsonAst ? ProgramCache::SourceFormat::JSON_AST : ProgramCache::SourceFormat::RINHA;
 
-		if (stream.fail())
-			throw runtime_error("Cannot open " + file.string());
+		if (cache)
+		{
+			if (auto parsedSource = cache->load(source, sourceFormat))
+				return parsedSource;
+		}
 
-		Parser parser(std::make_unique<ifstream>(std::move(stream)));
+		local_shared_ptr<ParsedSource> parsedSource;
+		local_shared_ptr<Diagnostics> diagnostics;
 
-		for (const auto& diagnostic : parser.getDiagnostics()->getList())
+		if (isJsonAst)
+		{
+			const JsonAstLoader loader(source);
+			parsedSource = loader.getParsedSource();
+			diagnostics = loader.getDiagnostics();
+		}
+		else if (NativeParser::isSelected())
+		{
+			const NativeParser parser(source);
+			parsedSource = parser.getParsedSource();
+			diagnostics = parser.getDiagnostics();
+		}
+		else
 		{
-			cout << "(" << diagnostic.line << ", " << diagnostic.column
-				 << "): " << (diagnostic.type == Diagnostic::Type::ERROR ? "Error" : "Warning") << ": "
-				 << diagnostic.message << endl;
+			Parser parser{string(source)};
+			parsedSource = parser.getParsedSource();
+			diagnostics = parser.getDiagnostics();
 		}
 
-		if (parser.getDiagnostics()->hasError())
+		if (cache && !diagnostics->hasError())
+			cache->store(source, sourceFormat, *parsedSource);
+
+		printDiagnostics(*diagnostics, diagnosticsStream);
+
+		if (diagnostics->hasError())
+			return nullptr;
+
+		return parsedSource;
+	}
+
+	// Lints the program with the semantic analysis, without running it. The analysis only reports, so it's kept out
+	// of the other modes, which fail on such errors only when evaluating them.
+	static int check(const fs::path& file)
+	{
+		const auto parsedSource = parse(file);
+
+		if (!parsedSource)
 			return 1;
 
-		const auto parsedSource = parser.getParsedSource();
-		const auto environment = make_local_shared<StdEnvironment>();
+		const SemanticAnalysis analysis(*parsedSource, SemanticAnalysis::getThreadCountFromEnvironment());
+		printDiagnostics(*analysis.getDiagnostics(), cout);
+
+		return analysis.getDiagnostics()->hasError() ? 1 : 0;
+	}
+
+	static int run(const fs::path& file)
+	{
+		const auto parsedSource = parse(file);
+
+		if (!parsedSource)
+			return 1;
+
+		BufferedEnvironmentOptions options;
+
+		if (const auto flushIntervalEnv = std::getenv("RINHA_FLUSH_INTERVAL_MS"))
+			options.flushInterval = std::chrono::milliseconds(std::strtoull(flushIntervalEnv, nullptr, 10));
+
+		const auto environment = make_local_shared<BufferedEnvironment>(cout, options);
 
 		EnvVarExecutionStrategy executionStrategy;
-		executionStrategy.run(std::move(environment), std::move(parsedSource));
+
+		try
+		{
+			executionStrategy.run(environment, std::move(parsedSource));
+		}
+		catch (...)
+		{
+			environment->flush();
+			throw;
+		}
+
+		environment->flush();
+
+		return 0;
+	}
+
+	// Runs a program of a batch, writing its diagnostics, output and error to the stream.
+	static bool runBuffered(const fs::path& file, ostream& stream)
+	{
+		const auto environment = make_local_shared<BufferEnvironment>();
+
+		try
+		{
+			const auto parsedSource = parse(file, stream);
+
+			if (!parsedSource)
+				return false;
+
+			EnvVarExecutionStrategy executionStrategy;
+			executionStrategy.run(environment, std::move(parsedSource));
+
+			stream << environment->getOutput();
+			return true;
+		}
+		catch (const exception& ex)
+		{
+			stream << environment->getOutput() << "Error: " << ex.what() << endl;
+			return false;
+		}
+	}
+
+	// The .rinha files of a directory, sorted by name.
+	static vector<fs::path> listPrograms(const fs::path& directory)
+	{
+		vector<fs::path> files;
+
+		for (const auto& entry : fs::directory_iterator(directory))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".rinha")
+				files.push_back(entry.path());
+		}
+
+		std::ranges::sort(files);
+
+		return files;
+	}
+
+	// Runs the .rinha files of a directory in `jobs` threads. Each program is parsed and run entirely by one thread,
+	// so its objects (reference counted by local_shared_ptr, which is not atomic) are never shared. Outputs are
+	// written in file name order, each one after a header with its file name, as soon as the previous ones are done.
+	static int batch(const fs::path& directory, unsigned jobs)
+	{
+		const auto files = listPrograms(directory);
+
+		vector<optional<string>> outputs(files.size());
+		std::size_t nextOutput = 0;
+		std::mutex outputMutex;
+		std::atomic<std::size_t> nextFile = 0;
+		std::atomic<bool> failed = false;
+
+		const auto work = [&] {
+			for (std::size_t i; (i = nextFile++) < files.size();)
+			{
+				ostringstream stream;
+				stream << "==> " << files[i].string() << " <==" << endl;
+
+				if (!runBuffered(files[i], stream))
+					failed = true;
+
+				std::lock_guard lock(outputMutex);
+				outputs[i] = stream.str();
+
+				for (; nextOutput < outputs.size() && outputs[nextOutput]; ++nextOutput)
+				{
+					cout << outputs[nextOutput].value();
+					outputs[nextOutput].reset();
+				}
+
+				cout.flush();
+			}
+		};
+
+		vector<std::thread> threads;
+
+		for (unsigned i = 1; i < jobs; ++i)
+			threads.emplace_back(work);
+
+		work();
+
+		for (auto& thread : threads)
+			thread.join();
+
+		return failed ? 1 : 0;
+	}
+
+	// Prints the average time to parse each .rinha file of a directory with ANTLR in full LL mode, with ANTLR in SLL
+	// mode falling back to LL, and with the native parser. Each parser runs once untimed first, so ANTLR's static
+	// initialization and prediction caches don't count.
+	static int benchmarkParsers(const fs::path& directory, unsigned iterations)
+	{
+		const auto files = listPrograms(directory);
+
+		const auto measure = [&](const auto& parseSource)
+		{
+			parseSource();
+
+			const auto start = std::chrono::steady_clock::now();
+
+			for (unsigned i = 0; i < iterations; ++i)
+				parseSource();
+
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+				iterations;
+		};
+
+		std::array<double, 3> totals{};
+		unsigned reparsedCount = 0;
+
+		cout << std::fixed << std::setprecision(3) << "file\tLL ms\tSLL+LL ms\tnative ms" << endl;
+
+		for (const auto& file : files)
+		{
+			const MappedFile mappedFile(file);
+			const string source(mappedFile.getData());
+
+			const std::array<double, 3> times = {
+				measure([&] { const Parser parser(source, Parser::Mode::LL); }),
+				measure([&] { const Parser parser(source, Parser::Mode::SLL_THEN_LL); }),
+				measure([&] { const NativeParser parser(source); }),
+			};
+
+			const auto reparsed = Parser(source).wasReparsed();
+			reparsedCount += reparsed;
+
+			cout << file.filename().string() << "\t" << times[0] << "\t" << times[1] << (reparsed ? " (LL)" : "")
+				 << "\t" << times[2] << endl;
+
+			for (std::size_t i = 0; i < times.size(); ++i)
+				totals[i] += times[i];
+		}
+
+		cout << "total\t" << totals[0] << "\t" << totals[1] << "\t" << totals[2] << endl;
+		cout << "SLL+LL vs LL: " << std::setprecision(2) << totals[0] / totals[1] << "x; " << reparsedCount << " of "
+			 << files.size() << " files fell back to LL" << endl;
+
+		return 0;
+	}
+
+	static string shellQuote(const string& s)
+	{
+		string result = "'";
+
+		for (const auto c : s)
+		{
+			if (c == '\'')
+				result += "'\\''";
+			else
+				result += c;
+		}
+
+		return result + "'";
+	}
+
+	// Translates the program to C++ (kept as output.cpp) and builds it with $CXX (or c++) into a native executable.
+	static int compile(const fs::path& file, const fs::path& output)
+	{
+		const auto parsedSource = parse(file);
+
+		if (!parsedSource)
+			return 1;
+
+		auto sourceFile = output;
+		sourceFile += ".cpp";
+
+		{
+			ofstream stream(sourceFile);
+			stream << CppGenerator::generate(parsedSource->getTerm());
+
+			if (stream.fail())
+				throw runtime_error("Cannot write " + sourceFile.string());
+		}
+
+		const auto compiler = std::getenv("CXX");
+		const auto flags = std::getenv("RINHA_AOT_CXXFLAGS");
+		const auto command = string(compiler && *compiler ? compiler : "c++") + " -std=c++20 -O2 " +
+			RINHA_AOT_CXXFLAGS + " " + (flags ? flags : "") + " " + shellQuote(sourceFile.string()) + " -o " +
+			shellQuote(output.string());
+
+		if (std::system(command.c_str()) != 0)
+			throw runtime_error("Cannot compile " + sourceFile.string());
 
 		return 0;
 	}
@@ -71,9 +395,37 @@ int main(int argc, const char* argv[])
 
 	try
 	{
+		if (argc == 4 && strcmp(argv[1], "compile") == 0)
+			return compile(argv[2], argv[3]);
+
+		if ((argc == 3 || (argc == 5 && strcmp(argv[3], "-j") == 0)) && strcmp(argv[1], "--batch") == 0)
+		{
+			const auto jobs = argc == 5 ? unsigned(std::strtoul(argv[4], nullptr, 10)) :
+										  std::max(std::thread::hardware_concurrency(), 1u);
+
+			return batch(argv[2], std::max(jobs, 1u));
+		}
+
+		if ((argc == 3 || argc == 4) && strcmp(argv[1], "--parse-benchmark") == 0)
+		{
+			const auto iterations = argc == 4 ? unsigned(std::strtoul(argv[3], nullptr, 10)) : 10u;
+			return benchmarkParsers(argv[2], std::max(iterations, 1u));
+		}
+
+		if (argc == 3 && strcmp(argv[1], "--serve") == 0)
+			Server(argv[2], {.limits = EnvVarExecutionStrategy::getLimitsFromEnvironment()}).run();
+
+		if (argc == 3 && strcmp(argv[1], "--check") == 0)
+			return check(argv[2]);
+
 		if (argc != 2)
 		{
 			cerr << "Syntax: " << argv[0] << " filename.rinha" << endl;
+			cerr << "        " << argv[0] << " compile filename.rinha executable" << endl;
+			cerr << "        " << argv[0] << " --batch directory [-j jobs]" << endl;
+			cerr << "        " << argv[0] << " --serve socket-path" << endl;
+			cerr << "        " << argv[0] << " --check filename.rinha" << endl;
+			cerr << "        " << argv[0] << " --parse-benchmark directory [iterations]" << endl;
 			return 1;
 		}
 
@@ -0,0 +1,111 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_SUITE(InterpreterSuite)
+BOOST_AUTO_TEST_SUITE(BatchSuite)
+
+struct BatchResult final
+{
+	int exitStatus;
+	std::string output;
+};
+
+// Runs `rinha --batch` on a directory holding the given files, like a user would.
+static BatchResult runBatch(const std::vector<std::pair<std::string, std::string>>& files, unsigned jobs)
+{
+	const auto directory = std::filesystem::temp_directory_path() / ("rinha-batch-test-" + std::to_string(getpid()));
+	const auto programs = directory / "programs";
+	const auto outputFile = directory / "output.txt";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(programs);
+
+	for (const auto& [name, source] : files)
+		std::ofstream(programs / name) << source;
+
+	const auto command = std::string("'") + RINHA_EXECUTABLE + "' --batch '" + programs.string() + "' -j " +
+		std::to_string(jobs) + " > '" + outputFile.string() + "'";
+	const auto status = std::system(command.c_str());
+	BOOST_REQUIRE(WIFEXITED(status));
+
+	std::ifstream stream(outputFile);
+	BatchResult result{WEXITSTATUS(status), std::string(std::istreambuf_iterator<char>(stream), {})};
+
+	std::filesystem::remove_all(directory);
+
+	// Headers hold the full path, which depends on the process.
+	for (std::size_t start; (start = result.output.find(programs.string() + "/")) != std::string::npos;)
+		result.output.erase(start, programs.string().size() + 1);
+
+	return result;
+}
+
+static unsigned fib(unsigned n)
+{
+	return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+BOOST_AUTO_TEST_CASE(outputInNameOrder)
+{
+	// The first programs take the longest, so later ones end first when there are several jobs.
+	std::vector<std::pair<std::string, std::string>> files;
+	std::string expected;
+
+	for (unsigned i = 0; i < 12; ++i)
+	{
+		const auto name = std::string(i < 10 ? "p0" : "p") + std::to_string(i) + ".rinha";
+		const auto n = std::to_string(i < 3 ? 25 - i : i);
+
+		files.emplace_back(name, "let fib = fn (n) => if (n < 2) { n } else { fib(n - 1) + fib(n - 2) };\n"
+								 "let _ = print(" + std::to_string(i) + ");\n"
+								 "print(fib(" + n + "))");
+
+		expected += "==> " + name + " <==\n" + std::to_string(i) + "\n" + std::to_string(fib(std::stoul(n))) + "\n";
+	}
+
+	// Not a program.
+	files.emplace_back("notes.txt", "print(1)");
+
+	for (const auto jobs : {1u, 4u})
+	{
+		const auto result = runBatch(files, jobs);
+		BOOST_CHECK_EQUAL(result.exitStatus, 0);
+		BOOST_CHECK_EQUAL(result.output, expected);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(failures)
+{
+	const auto result = runBatch({
+		{"a.rinha", "print(1)"},
+		{"b.rinha", "let _ = print(2);\nprint(3)(4)"},
+		{"c.rinha", "print("},
+		{"d.rinha", "print(5)"},
+	}, 2);
+
+	BOOST_CHECK_EQUAL(result.exitStatus, 1);
+
+	// The output before the error, then the error, and the following programs still run.
+	const auto cStart = result.output.find("==> c.rinha <==\n");
+	const auto dStart = result.output.find("==> d.rinha <==\n");
+	BOOST_REQUIRE(cStart != std::string::npos && dStart != std::string::npos);
+
+	BOOST_CHECK_EQUAL(result.output.substr(0, cStart),
+		"==> a.rinha <==\n1\n==> b.rinha <==\n2\n3\nError: Cannot call a non-function.\n");
+	BOOST_CHECK_EQUAL(result.output.substr(dStart), "==> d.rinha <==\n5\n");
+
+	// The parse error's diagnostics, instead of an output.
+	const auto parseOutput = result.output.substr(cStart, dStart - cStart);
+	BOOST_CHECK(parseOutput.find("): Error: ") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,272 @@
+#include "../TestUtil.test.h"
+#include "../AutoExecutionStrategy.h"
+#include "../CekExecutionStrategy.h"
+#include "../Exceptions.h"
+#include "../TreeWalkerExecutionStrategy.h"
+#include <string>
+#include <variant>
+#include <boost/test/unit_test.hpp>
+
+using namespace rinha::interpreter;
+
+
+BOOST_AUTO_TEST_SUITE(InterpreterSuite)
+BOOST_AUTO_TEST_SUITE(CallSuite)
+
+BOOST_AUTO_TEST_CASE(recursion)
+{
+	const auto result = TestUtil::run(R"###(
+		let fib = fn (n) => {
+			if (n < 2) {
+				n
+			} else {
+				fib(n - 1) + fib(n - 2)
+			}
+		};
+		fib(15)
+	)###");
+
+	BOOST_CHECK(std::get<IntValue>(result.value.value()).getValue() == 610);
+}
+
+BOOST_AUTO_TEST_CASE(multipleParameters)
+{
+	const auto result = TestUtil::run(R"###(
+		let combination = fn (n, k) => {
+			let a = k == 0;
+			let b = k == n;
+			if (a || b) {
+				1
+			} else {
+				combination(n - 1, k - 1) + combination(n - 1, k)
+			}
+		};
+		combination(10, 2)
+	)###");
+
+	BOOST_CHECK(std::get<IntValue>(result.value.value()).getValue() == 45);
+}
+
+BOOST_AUTO_TEST_CASE(closureCapturesParameter)
+{
+	const auto result = TestUtil::run(R"###(
+		let makeAdder = fn (x) => fn (y) => x + y;
+		let add3 = makeAdder(3);
+		let add5 = makeAdder(5);
+		(add3(1), add5(1))
+	)###");
+
+	const auto tuple = std::get<TupleValue>(result.value.value());
+
+	BOOST_CHECK(std::get<IntValue>(tuple.getFirst()).getValue() == 4);
+	BOOST_CHECK(std::get<IntValue>(tuple.getSecond()).getValue() == 6);
+}
+
+BOOST_AUTO_TEST_CASE(parameterShadowedByLet)
+{
+	const auto result = TestUtil::run(R"###(
+		let f = fn (x) => {
+			let x = 5;
+			x
+		};
+		f(1)
+	)###");
+
+	BOOST_CHECK(std::get<IntValue>(result.value.value()).getValue() == 5);
+}
+
+BOOST_AUTO_TEST_CASE(printInArguments)
+{
+	const auto result = TestUtil::run(R"###(
+		let f = fn (a, b) => a + b;
+		f(print(1), print(2))
+	)###");
+
+	BOOST_CHECK(std::get<IntValue>(result.value.value()).getValue() == 3);
+	BOOST_CHECK(result.environment->getLines().size() == 2);
+	BOOST_CHECK(result.environment->getLines()[0] == "1");
+	BOOST_CHECK(result.environment->getLines()[1] == "2");
+}
+
+BOOST_AUTO_TEST_CASE(hotFunctionsWithChangingTypes)
+{
+	const auto result = TestUtil::run(R"###(
+		let isEven = fn (n, acc) => {
+			if (n == 0) {
+				acc
+			} else {
+				let next = n - 1;
+				isEven(next, acc == false)
+			}
+		};
+		let countEven = fn (i, total) => {
+			if (i == 0) {
+				total
+			} else {
+				let add = if (isEven(i % 7, true)) { 1 } else { 0 };
+				countEven(i - 1, total + add)
+			}
+		};
+		let same = fn (a, b) => if (a == b) { 1 } else { 0 };
+		let sameTotal = fn (i) => if (i == 0) { 0 } else { same(i, i) + sameTotal(i - 1) };
+		(countEven(100, 0), (sameTotal(50), (same("a", "a"), same(true, false))))
+	)###");
+
+	const auto tuple = std::get<TupleValue>(result.value.value());
+	const auto rest = std::get<TupleValue>(tuple.getSecond());
+	const auto last = std::get<TupleValue>(rest.getSecond());
+
+	BOOST_CHECK(std::get<IntValue>(tuple.getFirst()).getValue() == 57);
+	BOOST_CHECK(std::get<IntValue>(rest.getFirst()).getValue() == 50);
+	BOOST_CHECK(std::get<IntValue>(last.getFirst()).getValue() == 1);
+	BOOST_CHECK(std::get<IntValue>(last.getSecond()).getValue() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(closuresCalledManyTimes)
+{
+	const auto result = TestUtil::run(R"###(
+		let makeAdder = fn (x) => fn (y) => x + y;
+		let loop = fn (i, acc) => {
+			if (i == 0) {
+				acc
+			} else {
+				let adder = makeAdder(i);
+				loop(i - 1, adder(acc))
+			}
+		};
+		let total = loop(300, 0);
+		let add = makeAdder(1000);
+		add(total)
+	)###");
+
+	BOOST_CHECK(std::get<IntValue>(result.value.value()).getValue() == 46150);
+}
+
+BOOST_AUTO_TEST_CASE(argumentsCountMismatch)
+{
+	BOOST_CHECK_THROW(TestUtil::run(R"###(
+		let f = fn (a, b) => a + b;
+		f(1)
+	)###"),
+		RinhaException);
+}
+
+BOOST_AUTO_TEST_CASE(callNonFunction)
+{
+	BOOST_CHECK_THROW(TestUtil::run(R"###(
+		let f = 1;
+		f(1)
+	)###"),
+		RinhaException);
+}
+
+BOOST_AUTO_TEST_CASE(duplicateParameter)
+{
+	BOOST_CHECK_THROW(TestUtil::run(R"###(
+		let f = fn (a, a) => a;
+		f(1, 2)
+	)###"),
+		RinhaException);
+}
+
+BOOST_AUTO_TEST_CASE(undefinedVariable)
+{
+	BOOST_CHECK_THROW(TestUtil::run(R"###(
+		let f = fn () => x;
+		f()
+	)###"),
+		RinhaException);
+}
+
+BOOST_AUTO_TEST_CASE(stackDepthExceeded)
+{
+	Parser parser(R"###(
+		let f = fn (n) => 1 + f(n + 1);
+		f(0)
+	)###");
+
+	TreeWalkerExecutionStrategy executionStrategy({.reservedStackSize = 8 * 1024 * 1024});
+
+	BOOST_CHECK_EXCEPTION(
+		executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()), RinhaException,
+		[](const auto& ex) { return std::string(ex.what()) == "stack depth exceeded"; });
+}
+
+BOOST_AUTO_TEST_CASE(stackDepthExceededTiered)
+{
+	// Hot after a few calls, so most of the recursion is in compiled code.
+	Parser parser(R"###(
+		let f = fn (n) => 1 + f(n + 1);
+		f(0)
+	)###");
+
+	TreeWalkerExecutionStrategy executionStrategy({.tiered = true, .reservedStackSize = 8 * 1024 * 1024});
+
+	BOOST_CHECK_EXCEPTION(
+		executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()), RinhaException,
+		[](const auto& ex) { return std::string(ex.what()) == "stack depth exceeded"; });
+}
+
+BOOST_AUTO_TEST_CASE(stackReservationFailure)
+{
+	// More than the address space, so the program runs in the calling thread without a depth check.
+	Parser parser(R"###(
+		let sum = fn (n) => if (n == 0) { 0 } else { n + sum(n - 1) };
+		sum(100)
+	)###");
+
+	TreeWalkerExecutionStrategy executionStrategy({.reservedStackSize = std::size_t(1) << 62});
+	const auto result =
+		executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource());
+
+	BOOST_CHECK(std::get<IntValue>(result).getValue() == 5050);
+}
+
+BOOST_AUTO_TEST_CASE(deepRecursionSwitchingToCoroutines)
+{
+	Parser parser(R"###(
+		let sum = fn (n) => if (n == 0) { 0 } else { n + sum(n - 1) };
+		sum(50000)
+	)###");
+
+	TreeWalkerExecutionStrategy executionStrategy({.coroutineDepth = 10});
+	const auto result =
+		executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource());
+
+	// Fits in 32 bits, as signed overflow is undefined.
+	BOOST_CHECK(std::get<IntValue>(result).getValue() == 1250025000);
+}
+
+BOOST_AUTO_TEST_CASE(deepRecursionCek)
+{
+	// Far deeper than the native stack of the test thread allows a recursive evaluator to go.
+	Parser parser(R"###(
+		let count = fn (n) => if (n == 0) { 0 } else { 1 + count(n - 1) };
+		count(1000000)
+	)###");
+
+	CekExecutionStrategy executionStrategy;
+	const auto result =
+		executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource());
+
+	BOOST_CHECK(std::get<IntValue>(result).getValue() == 1000000);
+}
+
+BOOST_AUTO_TEST_CASE(deepRecursionAutoUnknownDepth)
+{
+	// Linear, but taken as tree-shaped, and too deep for the native stack of the test thread.
+	Parser parser(R"###(
+		let f = fn (n) => if (n == 0) { 0 } else { if (n % 2 == 0) { 1 + f(n - 1) } else { 2 + f(n - 1) } };
+		let n = 1000000;
+		f(n)
+	)###");
+
+	AutoExecutionStrategy executionStrategy;
+	const auto result =
+		executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource());
+
+	BOOST_CHECK(std::get<IntValue>(result).getValue() == 1500000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // CallSuite
+BOOST_AUTO_TEST_SUITE_END()  // InterpreterSuite
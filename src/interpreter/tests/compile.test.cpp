@@ -0,0 +1,108 @@
+#include "../CppGenerator.h"
+#include "../Parser.h"
+#include "../TestUtil.test.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+
+using namespace rinha::interpreter;
+
+
+BOOST_AUTO_TEST_SUITE(InterpreterSuite)
+BOOST_AUTO_TEST_SUITE(CompileSuite)
+
+// Builds the program like `rinha compile` does, runs it and returns what it prints, one line per print.
+static std::string compileAndRun(const std::string& source)
+{
+	Parser parser(source);
+	BOOST_REQUIRE(!parser.getDiagnostics()->hasError());
+
+	const auto directory =
+		std::filesystem::temp_directory_path() / ("rinha-compile-test-" + std::to_string(getpid()));
+	std::filesystem::create_directories(directory);
+
+	const auto sourceFile = directory / "program.cpp";
+	const auto executable = directory / "program";
+	const auto outputFile = directory / "output.txt";
+
+	std::ofstream(sourceFile) << CppGenerator::generate(parser.getParsedSource()->getTerm());
+
+	const auto compiler = std::getenv("CXX");
+	const auto command = std::string(compiler && *compiler ? compiler : "c++") + " -std=c++20 -O0 " +
+		RINHA_AOT_CXXFLAGS + " '" + sourceFile.string() + "' -o '" + executable.string() + "' && '" +
+		executable.string() + "' > '" + outputFile.string() + "'";
+
+	BOOST_REQUIRE_EQUAL(std::system(command.c_str()), 0);
+
+	std::ifstream stream(outputFile);
+	std::string output(std::istreambuf_iterator<char>(stream), {});
+
+	std::filesystem::remove_all(directory);
+
+	return output;
+}
+
+// The interpreter's output, in the same form as compileAndRun's.
+static std::string interpret(const std::string& source)
+{
+	const auto result = TestUtil::run(source);
+	std::string output;
+
+	for (const auto& line : result.environment->getLines())
+		output += line + "\n";
+
+	return output;
+}
+
+BOOST_AUTO_TEST_CASE(closures)
+{
+	const std::string source = R"###(
+		let makeAdder = fn (a) => { fn (b) => { a + b } };
+		let add2 = makeAdder(2);
+		let compose = fn (f, g) => { fn (x) => { f(g(x)) } };
+		let twice = fn (f) => { compose(f, f) };
+		let fib = fn (n) => if (n < 2) { n } else { fib(n - 1) + fib(n - 2) };
+		let map = fn (f, list, n) => if (n == 0) { list } else { (f(first(list)), map(f, second(list), n - 1)) };
+		let _ = print(add2(40));
+		let _ = print(twice(add2)(1));
+		let _ = print(twice(twice(makeAdder(3)))(0));
+		let _ = print(fib(20));
+		let _ = print(map(makeAdder(10), (1, (2, (3, 0))), 3));
+		print(makeAdder)
+	)###";
+
+	BOOST_CHECK_EQUAL(compileAndRun(source), interpret(source));
+}
+
+BOOST_AUTO_TEST_CASE(tuples)
+{
+	const std::string source = R"###(
+		let swap = fn (pair) => { (second(pair), first(pair)) };
+		let nested = ((1, true), ("a", (false, 0 - 2)));
+		let _ = print(nested);
+		let _ = print(swap(nested));
+		let _ = print(first(second(second(nested))));
+		let _ = print((swap, 1));
+		print(first(swap((1, 2))) + second(swap(("x", "y"))))
+	)###";
+
+	BOOST_CHECK_EQUAL(compileAndRun(source), interpret(source));
+}
+
+BOOST_AUTO_TEST_CASE(stringEscapes)
+{
+	// Quotes, backslashes, control characters, DEL, '?' (as in trigraphs) and digits following an escape.
+	const std::string source = "let s = \"q\\\"b\\\\t\tn\nd\x7F?\?=?\?/\x01" "0\";\n"
+							   "let _ = print(s);\n"
+							   "let _ = print(s + 1);\n"
+							   "print((s, \"\\\\\"))";
+
+	BOOST_CHECK_EQUAL(compileAndRun(source), interpret(source));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
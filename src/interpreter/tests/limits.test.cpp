@@ -0,0 +1,131 @@
+#include "../Environment.test.h"
+#include "../Exceptions.h"
+#include "../Parser.h"
+#include "../ResourceGovernor.h"
+#include "../TreeWalkerExecutionStrategy.h"
+#include <boost/smart_ptr/make_local_shared.hpp>
+#include <chrono>
+#include <variant>
+#include <boost/test/unit_test.hpp>
+
+using namespace rinha::interpreter;
+
+
+BOOST_AUTO_TEST_SUITE(InterpreterSuite)
+BOOST_AUTO_TEST_SUITE(LimitsSuite)
+
+static const char* const FIB_SOURCE = R"###(
+	let fib = fn (n) => if (n < 2) { n } else { fib(n - 1) + fib(n - 2) };
+	fib(40)
+)###";
+
+BOOST_AUTO_TEST_CASE(withinLimits)
+{
+	Parser parser(R"###(
+		let fib = fn (n) => if (n < 2) { n } else { fib(n - 1) + fib(n - 2) };
+		fib(10)
+	)###");
+
+	TreeWalkerExecutionStrategy executionStrategy(
+		{.limits = {.maxCalls = 1000, .maxAllocatedBytes = 1024 * 1024, .timeout = std::chrono::seconds(60)}});
+	const auto result = executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource());
+
+	BOOST_CHECK(std::get<IntValue>(result).getValue() == 55);
+}
+
+BOOST_AUTO_TEST_CASE(callLimit)
+{
+	Parser parser(FIB_SOURCE);
+	TreeWalkerExecutionStrategy executionStrategy({.limits = {.maxCalls = 1000}});
+
+	BOOST_CHECK_THROW(executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()),
+		CallLimitException);
+}
+
+BOOST_AUTO_TEST_CASE(allocationLimit)
+{
+	Parser parser(R"###(
+		let repeat = fn (s, n) => if (n == 0) { s } else { repeat(s + s, n - 1) };
+		repeat("x", 30)
+	)###");
+
+	TreeWalkerExecutionStrategy executionStrategy({.limits = {.maxAllocatedBytes = 1024 * 1024}});
+
+	BOOST_CHECK_THROW(executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()),
+		AllocationLimitException);
+}
+
+BOOST_AUTO_TEST_CASE(copiedStringAllocationLimit)
+{
+	// Creates 128 KB of strings, but each call copies the 64 KB one.
+	Parser parser(R"###(
+		let repeat = fn (s, n) => if (n == 0) { s } else { repeat(s + s, n - 1) };
+		let pass = fn (s, n) => if (n == 0) { 0 } else { pass(s, n - 1) };
+		pass(repeat("x", 16), 1000)
+	)###");
+
+	TreeWalkerExecutionStrategy executionStrategy({.limits = {.maxAllocatedBytes = 1024 * 1024}});
+
+	BOOST_CHECK_THROW(executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()),
+		AllocationLimitException);
+}
+
+BOOST_AUTO_TEST_CASE(timeLimit)
+{
+	Parser parser(FIB_SOURCE);
+	TreeWalkerExecutionStrategy executionStrategy({.limits = {.timeout = std::chrono::milliseconds(10)}});
+
+	BOOST_CHECK_THROW(executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()),
+		TimeLimitException);
+}
+
+BOOST_AUTO_TEST_CASE(tieredCallLimit)
+{
+	// Hot after a few calls, so the loop continues in compiled code.
+	Parser parser(R"###(
+		let loop = fn (n) => loop(n + 1);
+		loop(0)
+	)###");
+
+	TreeWalkerExecutionStrategy executionStrategy({.tiered = true, .limits = {.maxCalls = 10000}});
+
+	BOOST_CHECK_THROW(executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()),
+		CallLimitException);
+}
+
+BOOST_AUTO_TEST_CASE(tieredTimeLimit)
+{
+	Parser parser(FIB_SOURCE);
+	TreeWalkerExecutionStrategy executionStrategy(
+		{.tiered = true, .limits = {.timeout = std::chrono::milliseconds(10)}});
+
+	BOOST_CHECK_THROW(executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()),
+		TimeLimitException);
+}
+
+BOOST_AUTO_TEST_CASE(hybridCallLimit)
+{
+	// Calls past the coroutine depth are evaluated by the coroutine strategy.
+	Parser parser(R"###(
+		let deep = fn (n) => 1 + deep(n + 1);
+		deep(0)
+	)###");
+
+	TreeWalkerExecutionStrategy executionStrategy({.coroutineDepth = 10, .limits = {.maxCalls = 10000}});
+
+	BOOST_CHECK_THROW(executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()),
+		CallLimitException);
+}
+
+BOOST_AUTO_TEST_CASE(hybridTimeLimit)
+{
+	Parser parser(FIB_SOURCE);
+	TreeWalkerExecutionStrategy executionStrategy(
+		{.coroutineDepth = 10, .limits = {.timeout = std::chrono::milliseconds(10)}});
+
+	BOOST_CHECK_THROW(executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()),
+		TimeLimitException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // LimitsSuite
+BOOST_AUTO_TEST_SUITE_END()  // InterpreterSuite
@@ -0,0 +1,670 @@
+#include "../IncrementalParser.h"
+#include "../JsonAstLoader.h"
+#include "../NativeParser.h"
+#include "../Nodes.h"
+#include "../ParsedSource.h"
+#include "../Parser.h"
+#include "../ProgramCache.h"
+#include "../ScopeAnalysis.h"
+#include "../SemanticAnalysis.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <boost/test/unit_test.hpp>
+
+using namespace rinha::interpreter;
+
+
+// Prints the tree with the position of each node.
+static std::string dumpPosition(const ParsedSource& parsedSource, const Node* node, bool withPositions)
+{
+	if (!withPositions)
+		return "";
+
+	const auto position = parsedSource.getPosition(node);
+	return position ? std::to_string(position->line) + ":" + std::to_string(position->column) : "?";
+}
+
+static std::string dump(const ParsedSource& parsedSource, const TermNode* node, bool withPositions = true)
+{
+	auto result = dumpPosition(parsedSource, node, withPositions) + "(" + std::to_string(int(node->getType()));
+
+	const auto child = [&](const TermNode* childNode)
+	{ result += " " + dump(parsedSource, childNode, withPositions); };
+	const auto reference = [&](const ReferenceNode* referenceNode)
+	{ result += " " + dumpPosition(parsedSource, referenceNode, withPositions) + " " + referenceNode->name; };
+
+	switch (node->getType())
+	{
+		case TermNode::Type::LITERAL:
+			result += " " + std::visit([](auto&& arg) { return arg.toString(); },
+								 static_cast<const LiteralNode*>(node)->value);
+			break;
+
+		case TermNode::Type::TUPLE:
+			child(static_cast<const TupleNode*>(node)->first);
+			child(static_cast<const TupleNode*>(node)->second);
+			break;
+
+		case TermNode::Type::FN:
+			for (const auto parameter : static_cast<const FnNode*>(node)->parameters)
+				reference(parameter);
+
+			child(static_cast<const FnNode*>(node)->body);
+			break;
+
+		case TermNode::Type::CALL:
+			child(static_cast<const CallNode*>(node)->callee);
+
+			for (const auto argument : static_cast<const CallNode*>(node)->arguments)
+				child(argument);
+
+			break;
+
+		case TermNode::Type::BINARY_OP:
+			result += " " + std::to_string(int(static_cast<const BinaryOpNode*>(node)->op));
+			child(static_cast<const BinaryOpNode*>(node)->first);
+			child(static_cast<const BinaryOpNode*>(node)->second);
+			break;
+
+		case TermNode::Type::IF:
+			child(static_cast<const IfNode*>(node)->condition);
+			child(static_cast<const IfNode*>(node)->then);
+			child(static_cast<const IfNode*>(node)->otherwise);
+			break;
+
+		case TermNode::Type::TUPLE_INDEX:
+			result += " " + std::to_string(static_cast<const TupleIndexNode*>(node)->index);
+			child(static_cast<const TupleIndexNode*>(node)->arg);
+			break;
+
+		case TermNode::Type::VAR:
+			reference(static_cast<const VarNode*>(node)->reference);
+			break;
+
+		case TermNode::Type::LET:
+			reference(static_cast<const LetNode*>(node)->reference);
+			child(static_cast<const LetNode*>(node)->value);
+			child(static_cast<const LetNode*>(node)->next);
+			break;
+
+		case TermNode::Type::PRINT:
+			child(static_cast<const PrintNode*>(node)->arg);
+			break;
+	}
+
+	return result + ")";
+}
+
+
+BOOST_AUTO_TEST_SUITE(InterpreterSuite)
+BOOST_AUTO_TEST_SUITE(ParserSuite)
+
+BOOST_AUTO_TEST_CASE(positions)
+{
+	Parser parser(R"###(let x = 1;
+  print(x))###");
+
+	const auto parsedSource = parser.getParsedSource();
+	const auto letNode = nodeAs<LetNode>(parsedSource->getTerm());
+	BOOST_REQUIRE(letNode);
+
+	const auto letPosition = parsedSource->getPosition(letNode.value());
+	BOOST_REQUIRE(letPosition);
+	BOOST_CHECK(letPosition->line == 1 && letPosition->column == 1);
+
+	const auto printPosition = parsedSource->getPosition(letNode.value()->next);
+	BOOST_REQUIRE(printPosition);
+	BOOST_CHECK(printPosition->line == 2 && printPosition->column == 3);
+}
+
+BOOST_AUTO_TEST_CASE(nativeMatchesAntlr)
+{
+	const char* const sources[] = {
+		"let fib = fn (n) => { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; print(fib(10))",
+		"let t = (1, (\"a\\\"b\\\\\", true)); let _ = print(first(t)); second(second(t))",
+		"1 - 2 - 3 * 4 / 5 % 6 + 7 == 8 && 9 != 10 || 11 <= 12 >= 13 < 14 > 15",
+		"(1 + 2) * (3) + ((4, 5))",
+		"let f = fn () => fn (a, b) => a; f()(1, 2)",
+		"print(1)(2)",
+		"/* block\n comment */ let x = 1; // line comment\n\tx + false",
+		"let {x} = 1; let _ = 2; let áé = 3; {x}",
+		"let x = ;",
+		"(1, 2) + 3",
+		"let x = 1 x",
+		"if (true) { 1 }",
+		"1 @ 2",
+		"fn (1) => 2",
+		"\"unterminated",
+	};
+
+	for (const auto source : sources)
+	{
+		BOOST_TEST_CONTEXT(source)
+		{
+			const Parser antlrParser(source);
+			const NativeParser nativeParser(source);
+			const auto& antlrDiagnostics = antlrParser.getDiagnostics()->getList();
+			const auto& nativeDiagnostics = nativeParser.getDiagnostics()->getList();
+
+			BOOST_REQUIRE(antlrDiagnostics.empty() == nativeDiagnostics.empty());
+
+			if (antlrDiagnostics.empty())
+			{
+				const auto antlrSource = antlrParser.getParsedSource();
+				const auto nativeSource = nativeParser.getParsedSource();
+
+				BOOST_CHECK_EQUAL(
+					dump(*antlrSource, antlrSource->getTerm()), dump(*nativeSource, nativeSource->getTerm()));
+			}
+			else
+			{
+				BOOST_CHECK_EQUAL(antlrDiagnostics[0].line, nativeDiagnostics[0].line);
+				BOOST_CHECK_EQUAL(antlrDiagnostics[0].column, nativeDiagnostics[0].column);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(sllThenLl)
+{
+	const char* const sources[] = {
+		"let fib = fn (n) => { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; print(fib(10))",
+		"let t = (1, (\"a\", true)); let _ = print(first(t)); second(second(t))",
+		"(1 + 2) * (3) + ((4, 5))",
+		"let x = ;",
+		"let x = 1 x",
+		"if (true) { 1 }",
+	};
+
+	for (const auto source : sources)
+	{
+		BOOST_TEST_CONTEXT(source)
+		{
+			const Parser llParser(source, Parser::Mode::LL);
+			const Parser twoStageParser(source, Parser::Mode::SLL_THEN_LL);
+			const auto& llDiagnostics = llParser.getDiagnostics()->getList();
+			const auto& twoStageDiagnostics = twoStageParser.getDiagnostics()->getList();
+
+			BOOST_CHECK(!llParser.wasReparsed());
+			BOOST_CHECK_EQUAL(twoStageParser.wasReparsed(), !llDiagnostics.empty());
+			BOOST_REQUIRE_EQUAL(llDiagnostics.size(), twoStageDiagnostics.size());
+
+			for (std::size_t i = 0; i < llDiagnostics.size(); ++i)
+			{
+				BOOST_CHECK_EQUAL(llDiagnostics[i].line, twoStageDiagnostics[i].line);
+				BOOST_CHECK_EQUAL(llDiagnostics[i].column, twoStageDiagnostics[i].column);
+				BOOST_CHECK_EQUAL(llDiagnostics[i].message, twoStageDiagnostics[i].message);
+			}
+
+			if (llDiagnostics.empty())
+			{
+				const auto llSource = llParser.getParsedSource();
+				const auto twoStageSource = twoStageParser.getParsedSource();
+
+				BOOST_CHECK_EQUAL(
+					dump(*llSource, llSource->getTerm()), dump(*twoStageSource, twoStageSource->getTerm()));
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(jsonAst)
+{
+	const JsonAstLoader loader(R"###({
+		"name": "fib.rinha",
+		"expression": {
+			"kind": "Let",
+			"name": {"text": "fib", "location": {"start": 4, "end": 7, "filename": "fib.rinha"}},
+			"value": {
+				"kind": "Function",
+				"parameters": [{"text": "n"}],
+				"value": {
+					"kind": "If",
+					"condition": {"kind": "Binary", "lhs": {"kind": "Var", "text": "n"}, "op": "Lt",
+						"rhs": {"kind": "Int", "value": 2}},
+					"then": {"kind": "Var", "text": "n"},
+					"otherwise": {
+						"kind": "Binary",
+						"op": "Add",
+						"lhs": {"kind": "Call", "callee": {"kind": "Var", "text": "fib"}, "arguments": [
+							{"kind": "Binary", "op": "Sub", "lhs": {"kind": "Var", "text": "n"},
+								"rhs": {"kind": "Int", "value": 1}}
+						]},
+						"rhs": {"kind": "Call", "callee": {"kind": "Var", "text": "fib"}, "arguments": [
+							{"kind": "Binary", "op": "Sub", "lhs": {"kind": "Var", "text": "n"},
+								"rhs": {"kind": "Int", "value": 2}}
+						]}
+					}
+				}
+			},
+			"next": {
+				"kind": "Let",
+				"name": {"text": "_"},
+				"value": {"kind": "Print", "value": {"kind": "Tuple",
+					"first": {"kind": "Str", "value": "a\"\u00e1\ud83d\ude00"},
+					"second": {"kind": "Bool", "value": true}}},
+				"next": {"kind": "Second", "value": {"kind": "Call", "callee": {"kind": "Function", "parameters": [],
+					"value": {"kind": "Tuple", "first": {"kind": "Int", "value": 1},
+					"second": {"kind": "Call", "callee": {"kind": "Var", "text": "fib"},
+					"arguments": [{"kind": "Int", "value": 10}]}}}, "arguments": []}}
+			}
+		},
+		"location": {"start": 0, "end": 1, "filename": "fib.rinha"}
+	})###");
+
+	const NativeParser nativeParser(R"###(
+		let fib = fn (n) => { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+		let _ = print(("a\"á😀", true));
+		second((fn () => (1, fib(10)))())
+	)###");
+
+	BOOST_REQUIRE(loader.getDiagnostics()->getList().empty());
+	BOOST_REQUIRE(nativeParser.getDiagnostics()->getList().empty());
+
+	const auto jsonSource = loader.getParsedSource();
+	const auto nativeSource = nativeParser.getParsedSource();
+
+	BOOST_CHECK_EQUAL(dump(*jsonSource, jsonSource->getTerm(), false),
+		dump(*nativeSource, nativeSource->getTerm(), false));
+}
+
+BOOST_AUTO_TEST_CASE(jsonAstErrors)
+{
+	const char* const sources[] = {
+		R"###({"expression": {"kind": "Int", "value": 1})###",
+		R"###({"expression": {"kind": "Let", "value": {"kind": "Int", "value": 1}}})###",
+		R"###({"expression": {"kind": "Binary", "op": "Pow", "lhs": {"kind": "Int", "value": 1},
+			"rhs": {"kind": "Int", "value": 2}}})###",
+		R"###({"expression": {"kind": "Int", "value": "1"}})###",
+		R"###({"expression": {"kind": "Loop"}})###",
+		R"###({"name": "x"})###",
+		R"###({"expression": {"kind": "Int", "value": 1}} 1)###",
+		// A Call or Function without its array, or with an array of the other kind, inside a Call with arguments.
+		R"###({"expression": {"kind": "Call", "callee": {"kind": "Var", "text": "f"}, "arguments": [
+			{"kind": "Int", "value": 1}, {"kind": "Call", "callee": {"kind": "Var", "text": "g"}}]}})###",
+		R"###({"expression": {"kind": "Call", "callee": {"kind": "Var", "text": "f"}, "arguments": [
+			{"kind": "Int", "value": 1},
+			{"kind": "Call", "callee": {"kind": "Var", "text": "g"}, "parameters": [{"text": "x"}]}]}})###",
+		R"###({"expression": {"kind": "Function", "parameters": [{"text": "x"}], "value":
+			{"kind": "Function", "value": {"kind": "Int", "value": 1}}}})###",
+		R"###({"expression": {"kind": "Function", "parameters": [{"text": "x"}], "value":
+			{"kind": "Function", "parameters": [], "value": {"kind": "Int", "value": 1},
+			"arguments": [{"kind": "Int", "value": 1}]}}})###",
+		R"###({"expression": {"kind": "Call", "callee": {"kind": "Var", "text": "f"}, "arguments": [
+			{"kind": "Let", "name": {"text": "x"}, "value": {"kind": "Int", "value": 1},
+			"next": {"kind": "Var", "text": "x"}, "arguments": [{"kind": "Int", "value": 2}]}]}})###",
+		R"###({"expression": {"kind": "Call", "callee": {"kind": "Var", "text": "f"}, "arguments": [],
+			"arguments": [{"kind": "Int", "value": 1}]}})###",
+		// A high surrogate alone, before something else or before another high one, and a low surrogate alone.
+		R"###({"expression": {"kind": "Str", "value": "\ud83d"}})###",
+		R"###({"expression": {"kind": "Str", "value": "\ud83da"}})###",
+		R"###({"expression": {"kind": "Str", "value": "\ud83d\u0041"}})###",
+		R"###({"expression": {"kind": "Str", "value": "\ud83d\ud83d"}})###",
+		R"###({"expression": {"kind": "Str", "value": "\ude00"}})###",
+	};
+
+	for (const auto source : sources)
+	{
+		BOOST_TEST_CONTEXT(source)
+		{
+			const JsonAstLoader loader(source);
+			BOOST_CHECK(loader.getDiagnostics()->hasError());
+		}
+	}
+}
+
+// Applies an edit to both the incremental parser and the text, then checks the result matches a whole parse.
+static void checkIncrementalEdit(IncrementalParser& incrementalParser, std::string& source, std::size_t offset,
+	std::size_t length, const std::string& text)
+{
+	source.replace(offset, length, text);
+	incrementalParser.edit(offset, length, text);
+	BOOST_REQUIRE_EQUAL(incrementalParser.getSource(), source);
+
+	const NativeParser nativeParser(source);
+	const auto& nativeDiagnostics = nativeParser.getDiagnostics()->getList();
+	const auto incrementalDiagnostics = incrementalParser.getDiagnostics();
+
+	BOOST_REQUIRE_EQUAL(nativeDiagnostics.empty(), incrementalDiagnostics->isEmpty());
+
+	if (nativeDiagnostics.empty())
+	{
+		const auto nativeSource = nativeParser.getParsedSource();
+		const auto incrementalSource = incrementalParser.getParsedSource();
+		BOOST_REQUIRE(incrementalSource);
+
+		BOOST_CHECK_EQUAL(
+			dump(*incrementalSource, incrementalSource->getTerm()), dump(*nativeSource, nativeSource->getTerm()));
+	}
+	else
+	{
+		BOOST_CHECK(!incrementalParser.getParsedSource());
+		BOOST_CHECK_EQUAL(incrementalDiagnostics->getList()[0].line, nativeDiagnostics[0].line);
+		BOOST_CHECK_EQUAL(incrementalDiagnostics->getList()[0].column, nativeDiagnostics[0].column);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(incremental)
+{
+	std::string source = R"###(// Header
+let fib = fn (n) => {
+	if (n < 2) { n } else { fib(n - 1) + fib(n - 2) }
+};
+let wrap = fn (x) => let y = (x, "a;b"); y; let one = 1; /* ; let */
+let s = "áé"; let two = 2;
+print(fib(one + 9)))###";
+
+	IncrementalParser incrementalParser(source);
+	BOOST_CHECK_EQUAL(incrementalParser.getParsedCount(), 6u);
+	checkIncrementalEdit(incrementalParser, source, 0, 0, "");
+
+	const auto fibValue = static_cast<const LetNode*>(incrementalParser.getParsedSource()->getTerm())->value;
+
+	// Inside one let.
+	checkIncrementalEdit(incrementalParser, source, source.find("let one = 1") + 10, 1, "100");
+	BOOST_CHECK_EQUAL(incrementalParser.getParsedCount(), 1u);
+	BOOST_CHECK(static_cast<const LetNode*>(incrementalParser.getParsedSource()->getTerm())->value == fibValue);
+
+	// Lines added above the other lets shift their positions without reparsing them.
+	checkIncrementalEdit(incrementalParser, source, source.find("(n - 1)"), 0, "\n\n");
+	BOOST_CHECK_EQUAL(incrementalParser.getParsedCount(), 1u);
+
+	// Columns of the let following the edit on the same line change, counting code points.
+	checkIncrementalEdit(incrementalParser, source, source.find("let wrap") + 4, 4, "w");
+	BOOST_CHECK_EQUAL(incrementalParser.getParsedCount(), 2u);
+	checkIncrementalEdit(incrementalParser, source, source.find("é"), 2, "");
+	BOOST_CHECK_EQUAL(incrementalParser.getParsedCount(), 2u);
+
+	// Errors come and go.
+	checkIncrementalEdit(incrementalParser, source, source.find("let one"), 0, "let = ;");
+	checkIncrementalEdit(incrementalParser, source, source.find("let = ;"), 7, "");
+
+	// Merging and splitting lets.
+	checkIncrementalEdit(incrementalParser, source, source.find("two = 2;") + 7, 1, "");
+	checkIncrementalEdit(incrementalParser, source, source.find("two = 2") + 7, 0, ";");
+
+	// Comments and strings hiding part of the source.
+	checkIncrementalEdit(incrementalParser, source, source.find("let w"), 0, "/*");
+	checkIncrementalEdit(incrementalParser, source, source.find("/*let w"), 2, "");
+	checkIncrementalEdit(incrementalParser, source, source.find("let w"), 0, "\"");
+	checkIncrementalEdit(incrementalParser, source, source.find("\"let w"), 1, "");
+
+	// The final term.
+	checkIncrementalEdit(incrementalParser, source, source.size() - 1, 1, ") + 1");
+	BOOST_CHECK_EQUAL(incrementalParser.getParsedCount(), 1u);
+
+	incrementalParser.edit(0, source.size(), "let f = fn (a, a) => a; f(1, 2)");
+	BOOST_CHECK(!incrementalParser.getParsedSource());
+	BOOST_REQUIRE_EQUAL(incrementalParser.getDiagnostics()->getList().size(), 1u);
+	BOOST_CHECK_EQUAL(incrementalParser.getDiagnostics()->getList()[0].column, 16u);
+}
+
+static constexpr auto FN_TYPE = TermNode::Type::FN;
+static constexpr auto LITERAL_TYPE = TermNode::Type::LITERAL;
+static constexpr auto TUPLE_INDEX_TYPE = TermNode::Type::TUPLE_INDEX;
+
+BOOST_AUTO_TEST_CASE(programCache)
+{
+	const auto directory = std::filesystem::temp_directory_path() / "rinha-program-cache-test";
+	std::filesystem::remove_all(directory);
+
+	const std::string source = R"###(let fib = fn (n) => { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+let t = ("a\"b", (true, false));
+let _ = print(first(t) + second(second(t)));
+let f = fn () => fn (a, b) => a % b;
+f()(fib(10), 7) >= 1 || 2 != 3)###";
+
+	constexpr auto RINHA = ProgramCache::SourceFormat::RINHA;
+
+	const ProgramCache cache(directory);
+	BOOST_CHECK(!cache.load(source, RINHA));
+
+	const NativeParser parser(source);
+	BOOST_REQUIRE(parser.getDiagnostics()->isEmpty());
+
+	cache.store(source, RINHA, *parser.getParsedSource());
+
+	const auto cachedSource = cache.load(source, RINHA);
+	BOOST_REQUIRE(cachedSource);
+	BOOST_CHECK_EQUAL(dump(*cachedSource, cachedSource->getTerm()),
+		dump(*parser.getParsedSource(), parser.getParsedSource()->getTerm()));
+
+	BOOST_CHECK(!cache.load(source + " ", RINHA));
+	BOOST_CHECK(!cache.load(source, ProgramCache::SourceFormat::JSON_AST));
+
+	// After the 40-byte header, a function whose parameter count is far more than the entry holds.
+	const auto entryPath = std::filesystem::directory_iterator(directory)->path();
+	std::string entry;
+
+	{
+		std::ifstream stream(entryPath, std::ios::binary);
+		entry.assign(std::istreambuf_iterator<char>(stream), {});
+	}
+
+	BOOST_REQUIRE_GT(entry.size(), 40u);
+	entry.resize(40);
+	entry.append(reinterpret_cast<const char*>(&FN_TYPE), sizeof(FN_TYPE));
+	entry += "\x01\x01\xFF\xFF\xFF\xFF\x0F";
+	std::ofstream(entryPath, std::ios::binary) << entry;
+
+	BOOST_CHECK(!cache.load(source, RINHA));
+
+	// `first(true)` or `second(true)`, then an index that is neither.
+	for (const char index : {1, 2})
+	{
+		entry.resize(40);
+		entry.append(reinterpret_cast<const char*>(&LITERAL_TYPE), sizeof(LITERAL_TYPE));
+		entry += {'\x01', '\x01', '\x00', '\x01'};
+		entry.append(reinterpret_cast<const char*>(&TUPLE_INDEX_TYPE), sizeof(TUPLE_INDEX_TYPE));
+		entry += {'\x01', '\x01', index};
+		std::ofstream(entryPath, std::ios::binary) << entry;
+
+		BOOST_CHECK_EQUAL(bool(cache.load(source, RINHA)), index == 1);
+	}
+
+	std::filesystem::remove_all(directory);
+}
+
+BOOST_AUTO_TEST_CASE(semanticAnalysis)
+{
+	const NativeParser parser(R"###(let a = 1;
+let f = fn (x, x) => x + a;
+let g = fn (y) => fn (z) => y + z + a + b;
+let h = fn () => let c = 2; fn () => c + g;
+h())###");
+	BOOST_REQUIRE(parser.getDiagnostics()->isEmpty());
+
+	const auto& parsedSource = *parser.getParsedSource();
+	const SemanticAnalysis analysis(parsedSource);
+	const auto& diagnostics = analysis.getDiagnostics()->getList();
+
+	BOOST_REQUIRE_EQUAL(diagnostics.size(), 2u);
+	BOOST_CHECK(diagnostics[0].type == Diagnostic::Type::ERROR);
+	BOOST_CHECK_EQUAL(diagnostics[0].line, 2u);
+	BOOST_CHECK_EQUAL(diagnostics[0].column, 16u);
+	BOOST_CHECK_EQUAL(diagnostics[0].message, "Duplicate parameter 'x'.");
+	BOOST_CHECK(diagnostics[1].type == Diagnostic::Type::WARNING);
+	BOOST_CHECK_EQUAL(diagnostics[1].line, 3u);
+	BOOST_CHECK_EQUAL(diagnostics[1].column, 41u);
+	BOOST_CHECK_EQUAL(diagnostics[1].message, "Variable 'b' is not defined.");
+
+	const auto getFn = [&](std::size_t index)
+	{
+		auto letNode = static_cast<const LetNode*>(parsedSource.getTerm());
+
+		for (; index > 0; --index)
+			letNode = static_cast<const LetNode*>(letNode->next);
+
+		return static_cast<const FnNode*>(letNode->value);
+	};
+
+	const auto freeVariables = [&](const FnNode* fnNode)
+	{
+		std::string names;
+
+		for (const auto name : analysis.getFreeVariables(fnNode))
+			(names += name) += ' ';
+
+		return names;
+	};
+
+	BOOST_CHECK_EQUAL(freeVariables(getFn(1)), "a ");
+	BOOST_CHECK_EQUAL(freeVariables(getFn(2)), "a ");
+	BOOST_CHECK_EQUAL(freeVariables(static_cast<const FnNode*>(getFn(2)->body)), "y a ");
+	BOOST_CHECK_EQUAL(freeVariables(getFn(3)), "g ");
+	BOOST_CHECK_EQUAL(
+		freeVariables(static_cast<const FnNode*>(static_cast<const LetNode*>(getFn(3)->body)->next)), "c g ");
+}
+
+BOOST_AUTO_TEST_CASE(semanticAnalysisThreads)
+{
+	std::string source;
+
+	for (unsigned i = 0; i < 1000; ++i)
+	{
+		const auto n = std::to_string(i);
+		source += "let f" + n + " = fn (a, " + (i % 300 == 7 ? "a" : "b") + ") => a + b + f" + n + "(a, b)" +
+			(i % 250 == 3 ? " + u" : "") + ";\n";
+	}
+
+	source += "f0(1, 2)";
+
+	const NativeParser parser(source);
+	BOOST_REQUIRE(parser.getDiagnostics()->isEmpty());
+
+	const auto serial = SemanticAnalysis(*parser.getParsedSource(), 1).getDiagnostics()->getList();
+	const auto parallel = SemanticAnalysis(*parser.getParsedSource(), 4).getDiagnostics()->getList();
+
+	// Each function with a repeated parameter also references an undefined `b` twice.
+	BOOST_REQUIRE_EQUAL(serial.size(), 16u);
+	BOOST_REQUIRE_EQUAL(parallel.size(), serial.size());
+
+	for (std::size_t i = 0; i < serial.size(); ++i)
+	{
+		BOOST_CHECK_EQUAL(parallel[i].line, serial[i].line);
+		BOOST_CHECK_EQUAL(parallel[i].column, serial[i].column);
+		BOOST_CHECK_EQUAL(parallel[i].message, serial[i].message);
+
+		if (i > 0)
+			BOOST_CHECK_LE(serial[i - 1].line, serial[i].line);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(scopeAnalysisThreads)
+{
+	const auto generate = [](bool duplicates)
+	{
+		std::string source = "let x = 1;\n";
+
+		for (unsigned i = 0; i < 1000; ++i)
+		{
+			const auto n = std::to_string(i);
+			const auto parameters = duplicates && i == 100 ? "a, a" : duplicates && i == 900 ? "b, b" : "a, b";
+			source += "let f" + n + " = fn (" + parameters + ") => let c = a + b; let g = fn (d) => c + d + x + f" +
+				n + "(a, b); g(c);\n";
+		}
+
+		return source + "f0(1, 2)";
+	};
+
+	const NativeParser parser(generate(false));
+	BOOST_REQUIRE(parser.getDiagnostics()->isEmpty());
+
+	const auto root = parser.getParsedSource()->getTerm();
+	const ScopeAnalysis serial(root, 1);
+	const ScopeAnalysis parallel(root, 4);
+
+	const auto& serialScopes = serial.getScopes();
+	const auto& parallelScopes = parallel.getScopes();
+	BOOST_REQUIRE_EQUAL(serialScopes.size(), 2001u);
+	BOOST_REQUIRE_EQUAL(parallelScopes.size(), serialScopes.size());
+
+	for (std::size_t i = 0; i < serialScopes.size(); ++i)
+	{
+		BOOST_CHECK(parallelScopes[i]->fnNode == serialScopes[i]->fnNode);
+		BOOST_CHECK(parallelScopes[i]->slotNames == serialScopes[i]->slotNames);
+		BOOST_CHECK(parallelScopes[i]->letSlots == serialScopes[i]->letSlots);
+		BOOST_CHECK_EQUAL(parallelScopes[i]->capturing, serialScopes[i]->capturing);
+
+		if (i > 0)
+			BOOST_CHECK(&parallel.getScope(parallelScopes[i]->fnNode) == parallelScopes[i]);
+	}
+
+	std::size_t varCount = 0;
+
+	const auto checkCandidates = [&](const auto& self, const TermNode* node) -> void
+	{
+		switch (node->getType())
+		{
+			case TermNode::Type::VAR:
+			{
+				const auto& serialCandidates = serial.getCandidates(static_cast<const VarNode*>(node));
+				const auto& parallelCandidates = parallel.getCandidates(static_cast<const VarNode*>(node));
+				BOOST_REQUIRE_EQUAL(parallelCandidates.size(), serialCandidates.size());
+
+				for (std::size_t i = 0; i < serialCandidates.size(); ++i)
+				{
+					BOOST_CHECK_EQUAL(parallelCandidates[i].hops, serialCandidates[i].hops);
+					BOOST_CHECK_EQUAL(parallelCandidates[i].index, serialCandidates[i].index);
+				}
+
+				++varCount;
+				break;
+			}
+
+			case TermNode::Type::FN:
+				self(self, static_cast<const FnNode*>(node)->getBody());
+				break;
+
+			case TermNode::Type::CALL:
+				self(self, static_cast<const CallNode*>(node)->callee);
+
+				for (const auto argument : static_cast<const CallNode*>(node)->arguments)
+					self(self, argument);
+
+				break;
+
+			case TermNode::Type::BINARY_OP:
+				self(self, static_cast<const BinaryOpNode*>(node)->first);
+				self(self, static_cast<const BinaryOpNode*>(node)->second);
+				break;
+
+			case TermNode::Type::LET:
+				BOOST_CHECK_EQUAL(parallel.getLetSlot(static_cast<const LetNode*>(node)),
+					serial.getLetSlot(static_cast<const LetNode*>(node)));
+				self(self, static_cast<const LetNode*>(node)->value);
+				self(self, static_cast<const LetNode*>(node)->next);
+				break;
+
+			default:
+				break;
+		}
+	};
+
+	checkCandidates(checkCandidates, root);
+	BOOST_CHECK_EQUAL(varCount, 1000u * 10 + 1);
+
+	// Threads stop at the first repeated parameter of their chunk, and the first chunk's one is reported.
+	const NativeParser duplicatesParser(generate(true));
+	BOOST_REQUIRE(duplicatesParser.getDiagnostics()->isEmpty());
+
+	for (const auto threadCount : {1u, 4u})
+	{
+		try
+		{
+			ScopeAnalysis(duplicatesParser.getParsedSource()->getTerm(), threadCount);
+			BOOST_FAIL("No exception thrown.");
+		}
+		catch (const std::exception& e)
+		{
+			BOOST_CHECK_EQUAL(e.what(), "Duplicate parameter 'a'.");
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // ParserSuite
+BOOST_AUTO_TEST_SUITE_END()  // InterpreterSuite
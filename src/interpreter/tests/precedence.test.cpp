@@ -1,4 +1,5 @@
 #include "../TestUtil.test.h"
+#include <string>
 #include <variant>
 #include <boost/test/unit_test.hpp>
 
@@ -10,12 +11,20 @@ BOOST_AUTO_TEST_SUITE(PrecedenceSuite)
 
 BOOST_AUTO_TEST_CASE(logical)
 {
-	// Weird but accordingly to the language definition
 	const auto result = TestUtil::run(R"###(
 		false && true || true
 	)###");
 
-	BOOST_CHECK(std::get<BoolValue>(result.value.value()).getValue() == false);
+	BOOST_CHECK(std::get<BoolValue>(result.value.value()).getValue() == true);
+}
+
+BOOST_AUTO_TEST_CASE(logicalAndComparison)
+{
+	const auto result = TestUtil::run(R"###(
+		1 + 1 == 2 && 3 < 4 || 1 > 2 && 1 != 1
+	)###");
+
+	BOOST_CHECK(std::get<BoolValue>(result.value.value()).getValue() == true);
 }
 
 BOOST_AUTO_TEST_CASE(logicalWithParenthesis1)
@@ -54,5 +63,29 @@ BOOST_AUTO_TEST_CASE(arithmeticAndFactorWithParenthesis)
 	BOOST_CHECK(std::get<IntValue>(result.value.value()).getValue() == 20);
 }
 
+BOOST_AUTO_TEST_CASE(leftAssociative)
+{
+	const auto result = TestUtil::run(R"###(
+		(10 - 2 - 3, 100 / 10 / 5 % 3 * 4)
+	)###");
+
+	const auto tuple = std::get<TupleValue>(result.value.value());
+
+	BOOST_CHECK(std::get<IntValue>(tuple.getFirst()).getValue() == 5);
+	BOOST_CHECK(std::get<IntValue>(tuple.getSecond()).getValue() == 8);
+}
+
+BOOST_AUTO_TEST_CASE(longChain)
+{
+	std::string source = "0";
+
+	for (int i = 1; i <= 10000; ++i)
+		source += " - " + std::to_string(i % 7);
+
+	const auto result = TestUtil::run(source);
+
+	BOOST_CHECK(std::get<IntValue>(result.value.value()).getValue() == -(10000 / 7 * 21 + 1 + 2 + 3 + 4));
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // PrecedenceSuite
 BOOST_AUTO_TEST_SUITE_END()  // InterpreterSuite
@@ -1,4 +1,8 @@
+#include "../Environment.h"
 #include "../TestUtil.test.h"
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
 #include <variant>
 #include <boost/test/unit_test.hpp>
 
@@ -67,5 +71,75 @@ BOOST_AUTO_TEST_CASE(printFn)
 	BOOST_CHECK(result.environment->getLines()[0] == "<#closure>");
 }
 
+BOOST_AUTO_TEST_CASE(printNested)
+{
+	const auto result = TestUtil::run(R"###(
+		let _ = print(((0 - 2147483647 - 1, "a"), (true, fn() => 1)));
+		print(("", ((false, 10), "b\\c")))
+	)###");
+
+	BOOST_REQUIRE_EQUAL(result.environment->getLines().size(), 2u);
+	BOOST_CHECK_EQUAL(result.environment->getLines()[0], "((-2147483648, a), (true, <#closure>))");
+	BOOST_CHECK_EQUAL(result.environment->getLines()[1], "(, ((false, 10), b\\c))");
+}
+
+BOOST_AUTO_TEST_CASE(bufferedEnvironment)
+{
+	std::ostringstream stream;
+
+	{
+		BufferedEnvironment environment(stream, {.capacity = 8});
+		environment.printLine("abc");
+		BOOST_CHECK(stream.str().empty());
+
+		environment.printLine("defg");
+		BOOST_CHECK_EQUAL(stream.str(), "abc\ndefg\n");
+
+		environment.printLine("h");
+		BOOST_CHECK_EQUAL(stream.str(), "abc\ndefg\n");
+	}
+
+	BOOST_CHECK_EQUAL(stream.str(), "abc\ndefg\nh\n");
+}
+
+BOOST_AUTO_TEST_CASE(bufferedEnvironmentInterval)
+{
+	static std::chrono::steady_clock::time_point now;
+
+	std::ostringstream stream;
+	BufferedEnvironment environment(
+		stream, {.flushInterval = std::chrono::milliseconds(10), .now = [] { return now; }});
+
+	environment.printLine("a");
+	now += std::chrono::milliseconds(9);
+	environment.printLine("b");
+	BOOST_CHECK(stream.str().empty());
+
+	now += std::chrono::milliseconds(1);
+	environment.printLine("c");
+	BOOST_CHECK_EQUAL(stream.str(), "a\nb\nc\n");
+
+	// Measured from the last write.
+	now += std::chrono::milliseconds(5);
+	environment.printLine("d");
+	BOOST_CHECK_EQUAL(stream.str(), "a\nb\nc\n");
+}
+
+BOOST_AUTO_TEST_CASE(bufferedEnvironmentError)
+{
+	std::ostringstream stream;
+
+	try
+	{
+		BufferedEnvironment environment(stream);
+		environment.printLine("before");
+		throw std::runtime_error("error");
+	}
+	catch (const std::runtime_error&)
+	{
+		BOOST_CHECK_EQUAL(stream.str(), "before\n");
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // PrintSuite
 BOOST_AUTO_TEST_SUITE_END()  // InterpreterSuite
@@ -0,0 +1,117 @@
+#include "../Parser.h"
+#include "../RecursionAnalysis.h"
+#include <optional>
+#include <string>
+#include <boost/test/unit_test.hpp>
+
+using namespace rinha::interpreter;
+
+
+BOOST_AUTO_TEST_SUITE(InterpreterSuite)
+BOOST_AUTO_TEST_SUITE(RecursionSuite)
+
+static std::string describe(const std::string& source)
+{
+	Parser parser(source);
+	BOOST_REQUIRE(!parser.getDiagnostics()->hasError());
+
+	return RecursionAnalysis(parser.getParsedSource()->getTerm()).describe();
+}
+
+BOOST_AUTO_TEST_CASE(notRecursive)
+{
+	Parser parser(R"###(
+		let add = fn (a, b) => { a + b };
+		let twice = fn (f, x) => { f(f(x, x), x) };
+		print(twice(add, 1))
+	)###");
+
+	const RecursionAnalysis analysis(parser.getParsedSource()->getTerm());
+
+	BOOST_CHECK(!analysis.isRecursive());
+	BOOST_CHECK(!analysis.isTreeShaped());
+	BOOST_CHECK(!analysis.isTailOnly());
+	BOOST_CHECK(!analysis.getEstimatedDepth());
+	BOOST_CHECK_EQUAL(analysis.describe(), "not recursive");
+}
+
+BOOST_AUTO_TEST_CASE(directLinear)
+{
+	Parser parser(R"###(
+		let sum = fn (n) => if (n == 0) { 0 } else { n + sum(n - 1) };
+		print(sum(100))
+	)###");
+
+	const RecursionAnalysis analysis(parser.getParsedSource()->getTerm());
+
+	BOOST_CHECK(analysis.isRecursive());
+	BOOST_CHECK(!analysis.isTreeShaped());
+	BOOST_CHECK(!analysis.isTailOnly());
+	BOOST_CHECK(analysis.getEstimatedDepth() == std::optional<unsigned>(101));
+	BOOST_CHECK_EQUAL(analysis.describe(), "recursive, linear, non-tail calls, estimated depth 101");
+}
+
+BOOST_AUTO_TEST_CASE(directTail)
+{
+	BOOST_CHECK_EQUAL(describe(R"###(
+		let sum = fn (n, acc) => if (n == 0) { acc } else { sum(n - 1, acc + n) };
+		print(sum(1000, 0))
+	)###"), "recursive, linear, tail calls only, estimated depth 1001");
+
+	BOOST_CHECK_EQUAL(describe(R"###(
+		let halve = fn (n) => if (n == 0) { 0 } else { halve(n / 2) };
+		halve(1024)
+	)###"), "recursive, linear, tail calls only, estimated depth 12");
+}
+
+BOOST_AUTO_TEST_CASE(directTreeShaped)
+{
+	BOOST_CHECK_EQUAL(describe(R"###(
+		let fib = fn (n) => if (n < 2) { n } else { fib(n - 1) + fib(n - 2) };
+		print(fib(20))
+	)###"), "recursive, tree-shaped, non-tail calls, estimated depth 21");
+}
+
+BOOST_AUTO_TEST_CASE(unknownDepth)
+{
+	// The entry argument isn't a literal, and the recursive call doesn't decrease the parameter.
+	BOOST_CHECK_EQUAL(describe(R"###(
+		let count = fn (n) => if (n == 0) { 0 } else { 1 + count(n - 1) };
+		let n = 10;
+		print(count(n))
+	)###"), "recursive, linear, non-tail calls, unknown depth");
+
+	BOOST_CHECK_EQUAL(describe(R"###(
+		let up = fn (n) => if (n > 100) { n } else { up(n + 1) };
+		print(up(1))
+	)###"), "recursive, linear, tail calls only, unknown depth");
+}
+
+BOOST_AUTO_TEST_CASE(mutual)
+{
+	// Only direct recursive calls are used to estimate the depth.
+	BOOST_CHECK_EQUAL(describe(R"###(
+		let isEven = fn (n) => if (n == 0) { true } else { isOdd(n - 1) };
+		let isOdd = fn (n) => if (n == 0) { false } else { isEven(n - 1) };
+		print(isEven(10))
+	)###"), "recursive, linear, tail calls only, unknown depth");
+
+	BOOST_CHECK_EQUAL(describe(R"###(
+		let f = fn (n) => if (n < 2) { n } else { g(n - 1) + g(n - 2) };
+		let g = fn (n) => { f(n) };
+		print(f(10))
+	)###"), "recursive, tree-shaped, non-tail calls, unknown depth");
+}
+
+BOOST_AUTO_TEST_CASE(rebound)
+{
+	// The callee can't be resolved when its let is bound to different things.
+	BOOST_CHECK_EQUAL(describe(R"###(
+		let f = fn (n) => { n };
+		let f = fn (n) => if (n == 0) { 0 } else { f(n - 1) };
+		print(f(10))
+	)###"), "not recursive");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+#include "../TestUtil.test.h"
+#include "../CoroutineExecutionStrategy.h"
+#include "../Exceptions.h"
+#include <exception>
+#include <string>
+#include <variant>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace rinha::interpreter;
+
+
+BOOST_AUTO_TEST_SUITE(InterpreterSuite)
+BOOST_AUTO_TEST_SUITE(SchedulerSuite)
+
+BOOST_AUTO_TEST_CASE(interleavedPrograms)
+{
+	const auto environment = boost::make_local_shared<TestEnvironment>();
+
+	Parser longParser(R"###(
+		let f = fn (n) => if (n == 0) { 0 } else { let _ = print("long"); f(n - 1) };
+		f(3)
+	)###");
+	Parser shortParser(R"###(
+		let f = fn (n) => print("short");
+		f(0)
+	)###");
+	Parser errorParser(R"###(
+		x
+	)###");
+
+	const auto results = CoroutineExecutionStrategy::runInterleaved(
+		{
+			{environment, longParser.getParsedSource()},
+			{environment, shortParser.getParsedSource()},
+			{environment, errorParser.getParsedSource()},
+		},
+		1);
+
+	BOOST_REQUIRE(results.size() == 3);
+	BOOST_CHECK(std::get<IntValue>(std::get<Value>(results[0])).getValue() == 0);
+	BOOST_CHECK(std::get<StrValue>(std::get<Value>(results[1])).getValue() == "short");
+	BOOST_CHECK_THROW(std::rethrow_exception(std::get<std::exception_ptr>(results[2])), RinhaException);
+
+	// Both programs yield on every call, so the short one finishes before the long one's second call.
+	const std::vector<std::string> expectedLines{"long", "short", "long", "long"};
+	BOOST_CHECK(environment->getLines() == expectedLines);
+}
+
+BOOST_AUTO_TEST_CASE(parallelEvaluation)
+{
+	const auto environment = boost::make_local_shared<TestEnvironment>();
+
+	// Operands calling functions that print are evaluated in parallel too, but their output keeps program order.
+	Parser parser(R"###(
+		let fib = fn (n) => if (n < 2) { n } else { fib(n - 1) + fib(n - 2) };
+		let f = fn (x) => print(x);
+		let g = fn (n) => if (n == 0) { 0 } else { f(n) + g(n - 1) };
+		let pair = (fib(18), fib(17));
+		let _ = print(pair);
+		g(3) + g(2)
+	)###");
+
+	CoroutineExecutionStrategy executionStrategy(4);
+	const auto result = executionStrategy.run(environment, parser.getParsedSource());
+
+	BOOST_CHECK(std::get<IntValue>(result).getValue() == 9);
+
+	const std::vector<std::string> expectedLines{"(2584, 1597)", "3", "2", "1", "2", "1"};
+	BOOST_CHECK(environment->getLines() == expectedLines);
+}
+
+BOOST_AUTO_TEST_CASE(parallelFailingFirstOperand)
+{
+	// The second operand never ends, so it must be cancelled when the first one fails, as sequential evaluation
+	// would never reach it.
+	Parser parser(R"###(
+		let fail = fn () => 1 + (fn () => 1);
+		let loop = fn (n) => loop(n + 1);
+		(fail(), loop(0))
+	)###");
+
+	CoroutineExecutionStrategy executionStrategy(4);
+
+	BOOST_CHECK_EXCEPTION(
+		executionStrategy.run(boost::make_local_shared<TestEnvironment>(), parser.getParsedSource()), RinhaException,
+		[](const auto& ex) { return std::string(ex.what()) == "Invalid datatypes with operator '+'."; });
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // SchedulerSuite
+BOOST_AUTO_TEST_SUITE_END()  // InterpreterSuite
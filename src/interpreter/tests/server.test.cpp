@@ -0,0 +1,193 @@
+#include "../Server.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+
+using namespace rinha::interpreter;
+
+
+BOOST_AUTO_TEST_SUITE(InterpreterSuite)
+BOOST_AUTO_TEST_SUITE(ServerSuite)
+
+static std::string getSocketPath()
+{
+	return (std::filesystem::temp_directory_path() / ("rinha-server-test-" + std::to_string(getpid()) + ".sock"))
+		.string();
+}
+
+// Connects and has the server accept the connection, which it serves in another thread.
+static int connectTo(Server& server, const std::string& socketPath)
+{
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, socketPath.c_str());
+
+	const auto connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	BOOST_REQUIRE(connection >= 0);
+	BOOST_REQUIRE(connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+
+	server.serveNext();
+
+	return connection;
+}
+
+static void sendSource(int connection, const std::string& source)
+{
+	BOOST_REQUIRE(send(connection, source.data(), source.size(), MSG_NOSIGNAL) == ssize_t(source.size()));
+	shutdown(connection, SHUT_WR);
+}
+
+// Reads until the server closes the connection, and closes it.
+static std::string receiveAll(int connection)
+{
+	std::string response;
+	char buffer[4096];
+
+	for (ssize_t count; (count = recv(connection, buffer, sizeof(buffer), 0)) > 0;)
+		response.append(buffer, std::size_t(count));
+
+	close(connection);
+
+	return response;
+}
+
+static std::string request(Server& server, const std::string& socketPath, const std::string& source)
+{
+	const auto connection = connectTo(server, socketPath);
+	sendSource(connection, source);
+
+	return receiveAll(connection);
+}
+
+static std::string getStat(Server& server, const std::string& socketPath, const std::string& name)
+{
+	const auto stats = request(server, socketPath, ":stats");
+	const auto start = stats.find(name + ": ");
+	BOOST_REQUIRE(start != std::string::npos);
+
+	const auto valueStart = start + name.size() + 2;
+
+	return stats.substr(valueStart, stats.find('\n', valueStart) - valueStart);
+}
+
+BOOST_AUTO_TEST_CASE(roundTrip)
+{
+	const auto socketPath = getSocketPath();
+	Server server(socketPath);
+
+	BOOST_CHECK_EQUAL(request(server, socketPath, R"###(
+		let add = fn (a, b) => { a + b };
+		print(add(1, 2))
+	)###"), "3\n");
+
+	BOOST_CHECK_EQUAL(request(server, socketPath, R"###(
+		let _ = print("a");
+		let _ = print((1, true));
+		print(2)
+	)###"), "a\n(1, true)\n2\n");
+
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(1)(2)"), "1\nError: Cannot call a non-function.\n");
+	BOOST_CHECK(request(server, socketPath, "print(").find("Error") != std::string::npos);
+
+	BOOST_CHECK_EQUAL(getStat(server, socketPath, "requests"), "4");
+	BOOST_CHECK_EQUAL(getStat(server, socketPath, "failed requests"), "2");
+}
+
+BOOST_AUTO_TEST_CASE(cacheHits)
+{
+	const auto socketPath = getSocketPath();
+	Server server(socketPath);
+
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(1)"), "1\n");
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(2)"), "2\n");
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(1)"), "1\n");
+
+	BOOST_CHECK_EQUAL(getStat(server, socketPath, "cache hits"), "1");
+	BOOST_CHECK_EQUAL(getStat(server, socketPath, "cached programs"), "2");
+}
+
+BOOST_AUTO_TEST_CASE(cacheEviction)
+{
+	const auto socketPath = getSocketPath();
+	Server server(socketPath);
+
+	for (std::size_t i = 0; i <= Server::MAX_CACHED_PROGRAMS; ++i)
+		request(server, socketPath, "print(" + std::to_string(i) + ")");
+
+	BOOST_CHECK_EQUAL(getStat(server, socketPath, "cached programs"), std::to_string(Server::MAX_CACHED_PROGRAMS));
+
+	// The first program was evicted, and caching it again evicts the second one.
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(0)"), "0\n");
+	BOOST_CHECK_EQUAL(getStat(server, socketPath, "cache hits"), "0");
+
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(2)"), "2\n");
+	BOOST_CHECK_EQUAL(getStat(server, socketPath, "cache hits"), "1");
+
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(1)"), "1\n");
+	BOOST_CHECK_EQUAL(getStat(server, socketPath, "cache hits"), "1");
+}
+
+BOOST_AUTO_TEST_CASE(limits)
+{
+	const auto socketPath = getSocketPath();
+	Server server(socketPath, {.limits = {.maxCalls = 1000}});
+
+	BOOST_CHECK_EQUAL(request(server, socketPath, R"###(
+		let loop = fn (n) => { loop(n + 1) };
+		loop(0)
+	)###"), "Error: call limit exceeded\n");
+
+	// The server still serves requests after stopping a program.
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(1)"), "1\n");
+}
+
+BOOST_AUTO_TEST_CASE(concurrentConnections)
+{
+	const auto socketPath = getSocketPath();
+	Server server(socketPath, {.limits = {.timeout = std::chrono::seconds(2)}});
+
+	const auto longConnection = connectTo(server, socketPath);
+	sendSource(longConnection, R"###(
+		let fib = fn (n) => if (n < 2) { n } else { fib(n - 1) + fib(n - 2) };
+		fib(40)
+	)###");
+
+	// Served while the long program runs, which is still going after it.
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(1)"), "1\n");
+
+	char byte;
+	BOOST_CHECK(recv(longConnection, &byte, 1, MSG_DONTWAIT) < 0 && errno == EAGAIN);
+
+	BOOST_CHECK_EQUAL(receiveAll(longConnection), "Error: time limit exceeded\n");
+}
+
+BOOST_AUTO_TEST_CASE(sourceTooLarge)
+{
+	const auto socketPath = getSocketPath();
+	Server server(socketPath, {.maxSourceSize = 16});
+
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(1234567890)"), "Error: Source larger than 16 bytes\n");
+	BOOST_CHECK_EQUAL(request(server, socketPath, "print(123456789)"), "123456789\n");
+	BOOST_CHECK_EQUAL(getStat(server, socketPath, "failed requests"), "1");
+}
+
+BOOST_AUTO_TEST_CASE(receiveTimeout)
+{
+	const auto socketPath = getSocketPath();
+	Server server(socketPath, {.receiveTimeout = std::chrono::milliseconds(100)});
+
+	// Never shuts down its side of the connection.
+	const auto connection = connectTo(server, socketPath);
+	BOOST_REQUIRE(send(connection, "print(1)", 8, MSG_NOSIGNAL) == 8);
+
+	BOOST_CHECK_EQUAL(receiveAll(connection), "Error: Timed out reading the source\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()